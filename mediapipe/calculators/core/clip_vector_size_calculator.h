@@ -59,6 +59,8 @@ class ClipVectorSizeCalculator : public CalculatorBase {
     if (cc->InputSidePackets().NumEntries() > 0) {
       cc->InputSidePackets().Index(0).Set<int>();
     }
+    // Clipping is cheap, so let queued vectors share a scheduler invocation.
+    cc->SetProcessBatchSize(8);
 
     return ::mediapipe::OkStatus();
   }
@@ -14,8 +14,10 @@
 
 #include "mediapipe/calculators/image/mask_overlay_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/stream_handler/sync_set_input_stream_handler.pb.h"
 #include "mediapipe/gpu/gl_calculator_helper.h"
 #include "mediapipe/gpu/gl_simple_shaders.h"
 #include "mediapipe/gpu/shader_util.h"
@@ -32,7 +34,13 @@ using ::mediapipe::MaskOverlayCalculatorOptions_MaskChannel_UNKNOWN;
 //
 // Inputs:
 //   VIDEO:[0,1] (GpuBuffer):
-//     Two inputs should be provided.
+//     Two inputs should be provided, unless the background comes from
+//     BACKGROUND. Then only the foreground is given, as VIDEO:0.
+//   BACKGROUND (ImageFrame):
+//     Optional, as input side packet and/or input stream. Replaces a static
+//     VIDEO:0. The image is uploaded to a texture once and reused for every
+//     frame; each packet on the stream replaces it. The stream is in its own
+//     sync set, so it only needs a packet when the background changes.
 //   MASK (GpuBuffer):
 //     Optional.
 //     Where the mask is 0, VIDEO:0 will be used. Where it is 1, VIDEO:1.
@@ -45,7 +53,7 @@ using ::mediapipe::MaskOverlayCalculatorOptions_MaskChannel_UNKNOWN;
 //
 // Outputs:
 //   OUTPUT (GpuBuffer):
-//     The mix.
+//     The mix, with the dimensions of the background.
 
 class MaskOverlayCalculator : public CalculatorBase {
  public:
@@ -62,9 +70,15 @@ class MaskOverlayCalculator : public CalculatorBase {
   ::mediapipe::Status GlRender(const float mask_const);
 
  private:
+  // Uploads |image| as the cached background. Must run in the GL context.
+  void SetBackground(const ImageFrame& image);
+
   GlCalculatorHelper helper_;
   bool initialized_ = false;
   bool use_mask_tex_ = false;  // Otherwise, use constant float value.
+  // True when the background comes from BACKGROUND instead of VIDEO:0.
+  bool use_cached_background_ = false;
+  GpuBuffer background_;
   GLuint program_ = 0;
   GLint unif_frame1_;
   GLint unif_frame2_;
@@ -75,8 +89,28 @@ REGISTER_CALCULATOR(MaskOverlayCalculator);
 // static
 ::mediapipe::Status MaskOverlayCalculator::GetContract(CalculatorContract* cc) {
   MP_RETURN_IF_ERROR(GlCalculatorHelper::UpdateContract(cc));
-  cc->Inputs().Get("VIDEO", 0).Set<GpuBuffer>();
-  cc->Inputs().Get("VIDEO", 1).Set<GpuBuffer>();
+  if (cc->InputSidePackets().HasTag("BACKGROUND") ||
+      cc->Inputs().HasTag("BACKGROUND")) {
+    RET_CHECK_EQ(cc->Inputs().NumEntries("VIDEO"), 1)
+        << "With BACKGROUND, only the foreground VIDEO input is given.";
+    cc->Inputs().Get("VIDEO", 0).Set<GpuBuffer>();
+    if (cc->InputSidePackets().HasTag("BACKGROUND")) {
+      cc->InputSidePackets().Tag("BACKGROUND").Set<ImageFrame>();
+    }
+    if (cc->Inputs().HasTag("BACKGROUND")) {
+      cc->Inputs().Tag("BACKGROUND").Set<ImageFrame>();
+      // Background updates are sparse and must not hold back the frames.
+      cc->SetInputStreamHandler("SyncSetInputStreamHandler");
+      MediaPipeOptions options;
+      options.MutableExtension(SyncSetInputStreamHandlerOptions::ext)
+          ->add_sync_set()
+          ->add_tag_index("BACKGROUND");
+      cc->SetInputStreamHandlerOptions(options);
+    }
+  } else {
+    cc->Inputs().Get("VIDEO", 0).Set<GpuBuffer>();
+    cc->Inputs().Get("VIDEO", 1).Set<GpuBuffer>();
+  }
   if (cc->Inputs().HasTag("MASK"))
     cc->Inputs().Tag("MASK").Set<GpuBuffer>();
   else if (cc->Inputs().HasTag("CONST_MASK"))
@@ -90,11 +124,33 @@ REGISTER_CALCULATOR(MaskOverlayCalculator);
 }
 
 ::mediapipe::Status MaskOverlayCalculator::Open(CalculatorContext* cc) {
-  cc->SetOffset(TimestampDiff(0));
+  use_cached_background_ = cc->InputSidePackets().HasTag("BACKGROUND") ||
+                           cc->Inputs().HasTag("BACKGROUND");
+  // A BACKGROUND packet may be ahead of the frames still being processed, so
+  // the output bound cannot follow the input timestamp there.
+  if (!cc->Inputs().HasTag("BACKGROUND")) {
+    cc->SetOffset(TimestampDiff(0));
+  }
   if (cc->Inputs().HasTag("MASK")) {
     use_mask_tex_ = true;
   }
-  return helper_.Open(cc);
+  MP_RETURN_IF_ERROR(helper_.Open(cc));
+  if (cc->InputSidePackets().HasTag("BACKGROUND")) {
+    const auto& background =
+        cc->InputSidePackets().Tag("BACKGROUND").Get<ImageFrame>();
+    MP_RETURN_IF_ERROR(helper_.RunInGlContext([this, &background] {
+      SetBackground(background);
+      return ::mediapipe::OkStatus();
+    }));
+  }
+  return ::mediapipe::OkStatus();
+}
+
+void MaskOverlayCalculator::SetBackground(const ImageFrame& image) {
+  auto texture = helper_.CreateSourceTexture(image);
+  background_ = *texture.GetFrame<GpuBuffer>();
+  glFlush();
+  texture.Release();
 }
 
 ::mediapipe::Status MaskOverlayCalculator::Process(CalculatorContext* cc) {
@@ -109,17 +165,29 @@ REGISTER_CALCULATOR(MaskOverlayCalculator);
 
     glDisable(GL_BLEND);
 
-    const Packet& input1_packet = cc->Inputs().Get("VIDEO", 1).Value();
+    if (cc->Inputs().HasTag("BACKGROUND") &&
+        !cc->Inputs().Tag("BACKGROUND").IsEmpty()) {
+      SetBackground(cc->Inputs().Tag("BACKGROUND").Get<ImageFrame>());
+    }
+
+    const Packet& input1_packet =
+        cc->Inputs().Get("VIDEO", use_cached_background_ ? 0 : 1).Value();
+    if (input1_packet.IsEmpty()) {
+      // Only the background changed.
+      return ::mediapipe::OkStatus();
+    }
     const Packet& mask_packet = use_mask_tex_
                                     ? cc->Inputs().Tag("MASK").Value()
                                     : cc->Inputs().Tag("CONST_MASK").Value();
 
-    if (mask_packet.IsEmpty()) {
+    if (mask_packet.IsEmpty() || (use_cached_background_ && !background_)) {
       cc->Outputs().Tag("OUTPUT").AddPacket(input1_packet);
       return ::mediapipe::OkStatus();
     }
 
-    const auto& input0_buffer = cc->Inputs().Get("VIDEO", 0).Get<GpuBuffer>();
+    const auto& input0_buffer =
+        use_cached_background_ ? background_
+                               : cc->Inputs().Get("VIDEO", 0).Get<GpuBuffer>();
     const auto& input1_buffer = input1_packet.Get<GpuBuffer>();
 
     auto src1 = helper_.CreateSourceTexture(input0_buffer);
@@ -18,6 +18,7 @@
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/image_frame_pool.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
@@ -144,6 +145,7 @@ REGISTER_CALCULATOR(RecolorCalculator);
 #endif  //  !MEDIAPIPE_DISABLE_GPU
   if (cc->Outputs().HasTag(kImageFrameTag)) {
     cc->Outputs().Tag(kImageFrameTag).Set<ImageFrame>();
+    cc->UseService(kImageFramePoolService).Optional();
   }
 
   // Confirm only one of the input streams is present.
@@ -231,8 +233,8 @@ REGISTER_CALCULATOR(RecolorCalculator);
   cv::Mat mask_full;
   cv::resize(mask_mat, mask_full, input_mat.size());
 
-  auto output_img = absl::make_unique<ImageFrame>(
-      input_img.Format(), input_mat.cols, input_mat.rows);
+  auto output_img =
+      GetImageFrame(cc, input_img.Format(), input_mat.cols, input_mat.rows);
   cv::Mat output_mat = mediapipe::formats::MatView(output_img.get());
 
   // From GPU shader:
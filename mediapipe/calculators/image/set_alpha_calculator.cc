@@ -20,6 +20,7 @@
 #include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/image_frame_pool.h"
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/status.h"
@@ -158,6 +159,7 @@ REGISTER_CALCULATOR(SetAlphaCalculator);
 #endif  //  !MEDIAPIPE_DISABLE_GPU
   if (cc->Outputs().HasTag(kOutputFrameTag)) {
     cc->Outputs().Tag(kOutputFrameTag).Set<ImageFrame>();
+    cc->UseService(kImageFramePoolService).Optional();
   }
 
   if (use_gpu) {
@@ -245,8 +247,8 @@ REGISTER_CALCULATOR(SetAlphaCalculator);
   }
 
   // Setup destination image
-  auto output_frame = absl::make_unique<ImageFrame>(
-      ImageFormat::SRGBA, input_mat.cols, input_mat.rows);
+  auto output_frame =
+      GetImageFrame(cc, ImageFormat::SRGBA, input_mat.cols, input_mat.rows);
   cv::Mat output_mat = mediapipe::formats::MatView(output_frame.get());
 
   const bool has_alpha_mask = cc->Inputs().HasTag(kInputAlphaTag) &&
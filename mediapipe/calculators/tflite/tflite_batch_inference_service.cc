@@ -0,0 +1,251 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tflite/tflite_batch_inference_service.h"
+
+#include <cstring>
+#include <utility>
+
+#include "mediapipe/framework/port/ret_check.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+
+namespace mediapipe {
+
+const GraphService<TfLiteBatchInferenceService> kTfLiteBatchInferenceService(
+    "kTfLiteBatchInferenceService");
+
+namespace {
+
+// Returns true if |tensor| has a batch dimension of |batch_size|.
+bool HasBatchSize(const TfLiteTensor& tensor, int batch_size) {
+  return tensor.dims && tensor.dims->size >= 1 &&
+         tensor.dims->data[0] == batch_size;
+}
+
+// Checks that the inputs and outputs of |interpreter| have a batch dimension
+// of |batch_size|, and that the outputs can be split along it.
+::mediapipe::Status ValidateBatchSize(const tflite::Interpreter& interpreter,
+                                      int batch_size) {
+  for (int index : interpreter.inputs()) {
+    RET_CHECK(HasBatchSize(*interpreter.tensor(index), batch_size))
+        << "Batched inputs must have a batch dimension of 1.";
+  }
+  for (int index : interpreter.outputs()) {
+    const TfLiteTensor& tensor = *interpreter.tensor(index);
+    TfLiteTensorSpec spec;
+    RET_CHECK(HasBatchSize(tensor, batch_size) &&
+              GetTfLiteTensorSpec(tensor, &spec))
+        << "Batched outputs must have a fixed size type and a batch "
+           "dimension that follows the inputs, but output "
+        << index << " does not for a batch of " << batch_size << ".";
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace
+
+// One caller's inputs and outputs. It lives on the caller's stack, which
+// Run() keeps until the request is done.
+struct TfLiteBatchInferencer::Request {
+  const std::vector<TfLiteTensor>* inputs = nullptr;
+  std::shared_ptr<std::vector<TfLiteTensor>> outputs;
+  ::mediapipe::Status status;
+  bool done = false;
+};
+
+struct TfLiteBatchInferencer::Batch {
+  std::vector<Request*> requests;
+  // True once the batch takes no more requests.
+  bool closed = false;
+};
+
+::mediapipe::StatusOr<std::shared_ptr<TfLiteBatchInferencer>>
+TfLiteBatchInferencer::Create(
+    std::shared_ptr<const tflite::FlatBufferModel> model,
+    const tflite::ops::builtin::BuiltinOpResolver& op_resolver,
+    const TfLiteBatchOptions& options) {
+  RET_CHECK(model);
+  RET_CHECK_GE(options.max_batch_size, 1);
+  std::shared_ptr<TfLiteBatchInferencer> inferencer(
+      new TfLiteBatchInferencer(std::move(model), op_resolver, options));
+  absl::MutexLock lock(&inferencer->invoke_mutex_);
+  ASSIGN_OR_RETURN(tflite::Interpreter * interpreter,
+                   inferencer->GetInterpreter(1));
+  MP_RETURN_IF_ERROR(ValidateBatchSize(*interpreter, 1));
+  // Builds the largest batch up front, so that a model that cannot run
+  // batched fails here rather than on the first full batch.
+  if (options.max_batch_size > 1) {
+    ASSIGN_OR_RETURN(interpreter,
+                     inferencer->GetInterpreter(options.max_batch_size));
+    MP_RETURN_IF_ERROR(ValidateBatchSize(*interpreter, options.max_batch_size));
+  }
+  return inferencer;
+}
+
+TfLiteBatchInferencer::TfLiteBatchInferencer(
+    std::shared_ptr<const tflite::FlatBufferModel> model,
+    const tflite::ops::builtin::BuiltinOpResolver& op_resolver,
+    const TfLiteBatchOptions& options)
+    : model_(std::move(model)),
+      op_resolver_(op_resolver),
+      options_(options),
+      runners_(options.max_batch_size) {}
+
+TfLiteBatchInferencer::~TfLiteBatchInferencer() = default;
+
+::mediapipe::StatusOr<std::shared_ptr<std::vector<TfLiteTensor>>>
+TfLiteBatchInferencer::Run(const std::vector<TfLiteTensor>& inputs) {
+  Request request;
+  request.inputs = &inputs;
+
+  absl::MutexLock lock(&mutex_);
+  // The caller that opens a batch runs it.
+  const bool leader = !open_batch_;
+  if (leader) open_batch_ = std::make_shared<Batch>();
+  std::shared_ptr<Batch> batch = open_batch_;
+  batch->requests.push_back(&request);
+  if (batch->requests.size() == options_.max_batch_size) {
+    batch->closed = true;
+    open_batch_ = nullptr;
+  }
+
+  if (!leader) {
+    mutex_.Await(absl::Condition(&request.done));
+    if (!request.status.ok()) return request.status;
+    return std::move(request.outputs);
+  }
+
+  mutex_.AwaitWithTimeout(absl::Condition(&batch->closed), options_.max_wait);
+  if (!batch->closed) {
+    batch->closed = true;
+    open_batch_ = nullptr;
+  }
+  ++batch_count_;
+
+  // Later requests go to the next batch, which collects meanwhile.
+  mutex_.Unlock();
+  const ::mediapipe::Status status = RunBatch(batch->requests);
+  mutex_.Lock();
+  for (Request* batch_request : batch->requests) {
+    batch_request->status = status;
+    batch_request->done = true;
+  }
+  if (!status.ok()) return status;
+  return std::move(request.outputs);
+}
+
+::mediapipe::Status TfLiteBatchInferencer::RunBatch(
+    const std::vector<Request*>& requests) {
+  absl::MutexLock lock(&invoke_mutex_);
+  const int batch_size = requests.size();
+  ASSIGN_OR_RETURN(tflite::Interpreter * interpreter,
+                   GetInterpreter(batch_size));
+
+  const auto& input_indexes = interpreter->inputs();
+  for (int i = 0; i < input_indexes.size(); ++i) {
+    TfLiteTensor* tensor = interpreter->tensor(input_indexes[i]);
+    const size_t bytes = tensor->bytes / batch_size;
+    for (int r = 0; r < batch_size; ++r) {
+      const std::vector<TfLiteTensor>& inputs = *requests[r]->inputs;
+      RET_CHECK_EQ(inputs.size(), input_indexes.size());
+      RET_CHECK_EQ(inputs[i].type, tensor->type);
+      RET_CHECK_EQ(inputs[i].bytes, bytes);
+      std::memcpy(tensor->data.raw + r * bytes, inputs[i].data.raw, bytes);
+    }
+  }
+
+  RET_CHECK_EQ(interpreter->Invoke(), kTfLiteOk);
+
+  // Splits the outputs along the batch dimension.
+  const auto& output_indexes = interpreter->outputs();
+  std::vector<TfLiteTensorSpec> specs(output_indexes.size());
+  for (int i = 0; i < output_indexes.size(); ++i) {
+    RET_CHECK(GetTfLiteTensorSpec(*interpreter->tensor(output_indexes[i]),
+                                  &specs[i]));
+    RET_CHECK_EQ(specs[i].dims[0], batch_size);
+    specs[i].dims[0] = 1;
+  }
+  for (int r = 0; r < batch_size; ++r) {
+    auto outputs = output_pool_.GetTensors(specs);
+    for (int i = 0; i < output_indexes.size(); ++i) {
+      const TfLiteTensor* tensor = interpreter->tensor(output_indexes[i]);
+      TfLiteTensor& output = (*outputs)[i];
+      std::memcpy(output.data.raw, tensor->data.raw + r * output.bytes,
+                  output.bytes);
+    }
+    requests[r]->outputs = std::move(outputs);
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::StatusOr<tflite::Interpreter*>
+TfLiteBatchInferencer::GetInterpreter(int batch_size) {
+  Runner& runner = runners_[batch_size - 1];
+  if (runner.interpreter) return runner.interpreter.get();
+
+  // Each batch size gets its own interpreter, so that no delegated graph is
+  // ever resized.
+  std::unique_ptr<tflite::Interpreter> interpreter;
+  tflite::InterpreterBuilder(*model_, op_resolver_)(&interpreter);
+  RET_CHECK(interpreter);
+  interpreter->SetNumThreads(options_.num_threads);
+  if (batch_size > 1) {
+    for (int index : interpreter->inputs()) {
+      const TfLiteIntArray* dims = interpreter->tensor(index)->dims;
+      RET_CHECK(dims && dims->size >= 1);
+      std::vector<int> batch_dims(dims->data, dims->data + dims->size);
+      batch_dims[0] = batch_size;
+      RET_CHECK_EQ(interpreter->ResizeInputTensor(index, batch_dims),
+                   kTfLiteOk);
+    }
+  }
+  RET_CHECK_EQ(interpreter->AllocateTensors(), kTfLiteOk);
+  if (options_.xnnpack_num_threads > 0) {
+    TfLiteXNNPackDelegateOptions xnnpack_opts{};
+    xnnpack_opts.num_threads = options_.xnnpack_num_threads;
+    runner.delegate = {TfLiteXNNPackDelegateCreate(&xnnpack_opts),
+                       &TfLiteXNNPackDelegateDelete};
+    RET_CHECK_EQ(interpreter->ModifyGraphWithDelegate(runner.delegate.get()),
+                 kTfLiteOk);
+  }
+  runner.interpreter = std::move(interpreter);
+  return runner.interpreter.get();
+}
+
+int TfLiteBatchInferencer::GetBatchCount() {
+  absl::MutexLock lock(&mutex_);
+  return batch_count_;
+}
+
+::mediapipe::StatusOr<std::shared_ptr<TfLiteBatchInferencer>>
+TfLiteBatchInferenceService::GetBatchInferencer(
+    const std::string& key,
+    std::shared_ptr<const tflite::FlatBufferModel> model,
+    const tflite::ops::builtin::BuiltinOpResolver& op_resolver,
+    const TfLiteBatchOptions& options) {
+  absl::MutexLock lock(&mutex_);
+  std::shared_ptr<TfLiteBatchInferencer>& inferencer = inferencers_[key];
+  if (!inferencer) {
+    auto status_or_inferencer =
+        TfLiteBatchInferencer::Create(std::move(model), op_resolver, options);
+    if (!status_or_inferencer.ok()) {
+      inferencers_.erase(key);
+      return status_or_inferencer.status();
+    }
+    inferencer = std::move(status_or_inferencer).ValueOrDie();
+  }
+  return inferencer;
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,151 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This service lets the TfLiteInferenceCalculators of several streams, in one
+// graph or in several graphs, run the same model as one batched inference
+// instead of one inference each. A model whose inputs and outputs all have a
+// batch dimension of 1 is run with a batch dimension of N, on the inputs of N
+// concurrent requests.
+//
+// The application shares one service object between its graphs:
+//
+//   auto service = std::make_shared<TfLiteBatchInferenceService>();
+//   for (CalculatorGraph* graph : graphs) {
+//     MP_RETURN_IF_ERROR(
+//         graph->SetServiceObject(kTfLiteBatchInferenceService, service));
+//   }
+//
+// and the calculators opt in with the "batching" option. Without the service,
+// the option is ignored.
+//
+// Each TfLiteBatchInferencer collects requests until it has max_batch_size of
+// them or max_wait has passed since the first, then runs them on an
+// interpreter sized for that batch. A caller blocks until its batch has run,
+// so the graphs need a thread per waiting calculator. The next batch collects
+// while one runs.
+
+#ifndef MEDIAPIPE_CALCULATORS_TFLITE_TFLITE_BATCH_INFERENCE_SERVICE_H_
+#define MEDIAPIPE_CALCULATORS_TFLITE_TFLITE_BATCH_INFERENCE_SERVICE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "mediapipe/calculators/tflite/tflite_tensor_pool.h"
+#include "mediapipe/framework/graph_service.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/model.h"
+
+namespace mediapipe {
+
+struct TfLiteBatchOptions {
+  int max_batch_size = 8;
+  // How long the first request of a batch waits for the others.
+  absl::Duration max_wait = absl::Milliseconds(2);
+  // The number of threads of each interpreter, -1 for the default.
+  int num_threads = -1;
+  // If positive, the interpreters use an XNNPACK delegate with this many
+  // threads.
+  int xnnpack_num_threads = 0;
+};
+
+// Runs batches of inferences on one model.
+class TfLiteBatchInferencer {
+ public:
+  // Fails unless every input and output of |model| has a batch dimension of 1
+  // and the model also runs with a batch dimension of max_batch_size.
+  static ::mediapipe::StatusOr<std::shared_ptr<TfLiteBatchInferencer>> Create(
+      std::shared_ptr<const tflite::FlatBufferModel> model,
+      const tflite::ops::builtin::BuiltinOpResolver& op_resolver,
+      const TfLiteBatchOptions& options);
+
+  ~TfLiteBatchInferencer();
+
+  // Runs the model on |inputs|, which must match its inputs with a batch
+  // dimension of 1, as part of a batch. Blocks until the batch has run, and
+  // returns pooled output tensors with a batch dimension of 1. Thread-safe.
+  ::mediapipe::StatusOr<std::shared_ptr<std::vector<TfLiteTensor>>> Run(
+      const std::vector<TfLiteTensor>& inputs);
+
+  // This method is meant for testing. Returns the number of batches run.
+  int GetBatchCount();
+
+ private:
+  struct Request;
+  struct Batch;
+
+  TfLiteBatchInferencer(
+      std::shared_ptr<const tflite::FlatBufferModel> model,
+      const tflite::ops::builtin::BuiltinOpResolver& op_resolver,
+      const TfLiteBatchOptions& options);
+
+  // Returns the interpreter for |batch_size| requests, creating it if needed.
+  ::mediapipe::StatusOr<tflite::Interpreter*> GetInterpreter(int batch_size)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(invoke_mutex_);
+  ::mediapipe::Status RunBatch(const std::vector<Request*>& requests)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  const std::shared_ptr<const tflite::FlatBufferModel> model_;
+  const tflite::ops::builtin::BuiltinOpResolver op_resolver_;
+  const TfLiteBatchOptions options_;
+
+  absl::Mutex mutex_;
+  // The batch collecting requests, if any.
+  std::shared_ptr<Batch> open_batch_ ABSL_GUARDED_BY(mutex_);
+  int batch_count_ ABSL_GUARDED_BY(mutex_) = 0;
+
+  // Serializes the batches, which share the interpreters.
+  absl::Mutex invoke_mutex_;
+  // One interpreter per batch size, the delegate being destroyed after it.
+  struct Runner {
+    std::unique_ptr<TfLiteDelegate, void (*)(TfLiteDelegate*)> delegate{
+        nullptr, nullptr};
+    std::unique_ptr<tflite::Interpreter> interpreter;
+  };
+  std::vector<Runner> runners_ ABSL_GUARDED_BY(invoke_mutex_);
+  TfLiteTensorPool output_pool_;
+};
+
+// The TfLiteBatchInferencers of a process, one per model and options.
+class TfLiteBatchInferenceService {
+ public:
+  TfLiteBatchInferenceService() {}
+
+  // Returns the inferencer registered under |key|, or one created with the
+  // given arguments. The key must identify the model and the options, since
+  // the arguments of a later call with the same key are ignored.
+  ::mediapipe::StatusOr<std::shared_ptr<TfLiteBatchInferencer>>
+  GetBatchInferencer(const std::string& key,
+                     std::shared_ptr<const tflite::FlatBufferModel> model,
+                     const tflite::ops::builtin::BuiltinOpResolver& op_resolver,
+                     const TfLiteBatchOptions& options);
+
+ private:
+  absl::Mutex mutex_;
+  std::map<std::string, std::shared_ptr<TfLiteBatchInferencer>> inferencers_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+extern const GraphService<TfLiteBatchInferenceService>
+    kTfLiteBatchInferenceService;
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TFLITE_TFLITE_BATCH_INFERENCE_SERVICE_H_
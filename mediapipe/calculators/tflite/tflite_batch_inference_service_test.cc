@@ -0,0 +1,102 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tflite/tflite_batch_inference_service.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+// The model outputs three times its [1, 8, 8, 3] input.
+constexpr char kModelPath[] = "mediapipe/calculators/tflite/testdata/add.bin";
+constexpr int kTensorSize = 8 * 8 * 3;
+
+std::shared_ptr<const tflite::FlatBufferModel> LoadModel() {
+  return tflite::FlatBufferModel::BuildFromFile(kModelPath);
+}
+
+// Runs |inferencer| on an input filled with |value| and checks the output.
+void RunAndCheck(TfLiteBatchInferencer* inferencer, float value) {
+  TfLiteTensorPool input_pool;
+  TfLiteTensorSpec spec;
+  spec.dims = {1, 8, 8, 3};
+  auto inputs = input_pool.GetTensors({spec});
+  float* input = (*inputs)[0].data.f;
+  std::fill(input, input + kTensorSize, value);
+
+  auto status_or_outputs = inferencer->Run(*inputs);
+  ASSERT_TRUE(status_or_outputs.ok());
+  const auto& outputs = *status_or_outputs.ValueOrDie();
+  ASSERT_EQ(1, outputs.size());
+  ASSERT_EQ(1, outputs[0].dims->data[0]);
+  for (int i = 0; i < kTensorSize; ++i) {
+    ASSERT_EQ(3 * value, outputs[0].data.f[i]);
+  }
+}
+
+TEST(TfLiteBatchInferenceServiceTest, RunsConcurrentRequestsAsOneBatch) {
+  TfLiteBatchOptions options;
+  options.max_batch_size = 4;
+  // Long enough for the four threads to join the batch.
+  options.max_wait = absl::Seconds(60);
+  auto status_or_inferencer = TfLiteBatchInferencer::Create(
+      LoadModel(), tflite::ops::builtin::BuiltinOpResolver(), options);
+  ASSERT_TRUE(status_or_inferencer.ok());
+  auto inferencer = status_or_inferencer.ValueOrDie();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back(
+        [&inferencer, i] { RunAndCheck(inferencer.get(), i); });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(1, inferencer->GetBatchCount());
+}
+
+TEST(TfLiteBatchInferenceServiceTest, RunsPartialBatchAfterMaxWait) {
+  TfLiteBatchOptions options;
+  options.max_batch_size = 4;
+  options.max_wait = absl::Milliseconds(1);
+  auto status_or_inferencer = TfLiteBatchInferencer::Create(
+      LoadModel(), tflite::ops::builtin::BuiltinOpResolver(), options);
+  ASSERT_TRUE(status_or_inferencer.ok());
+  auto inferencer = status_or_inferencer.ValueOrDie();
+
+  RunAndCheck(inferencer.get(), 1.0f);
+  RunAndCheck(inferencer.get(), 2.0f);
+  EXPECT_EQ(2, inferencer->GetBatchCount());
+}
+
+TEST(TfLiteBatchInferenceServiceTest, SharesInferencersByKey) {
+  TfLiteBatchInferenceService service;
+  auto model = LoadModel();
+  auto first = service.GetBatchInferencer(
+      "add", model, tflite::ops::builtin::BuiltinOpResolver(), {});
+  auto second = service.GetBatchInferencer(
+      "add", model, tflite::ops::builtin::BuiltinOpResolver(), {});
+  auto other = service.GetBatchInferencer(
+      "other", model, tflite::ops::builtin::BuiltinOpResolver(), {});
+  ASSERT_TRUE(first.ok() && second.ok() && other.ok());
+  EXPECT_EQ(first.ValueOrDie(), second.ValueOrDie());
+  EXPECT_NE(first.ValueOrDie(), other.ValueOrDie());
+}
+
+}  // namespace
+}  // namespace mediapipe
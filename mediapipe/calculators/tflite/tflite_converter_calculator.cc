@@ -13,9 +13,11 @@
 // limitations under the License.
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "mediapipe/calculators/tflite/tflite_converter_calculator.pb.h"
+#include "mediapipe/calculators/tflite/tflite_tensor_pool.h"
 #include "mediapipe/calculators/tflite/util.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
@@ -126,6 +128,7 @@ struct GPUData {
 //  No conversion between CPU/GPU is done.
 //  Inputs/outputs must match type: CPU->CPU or GPU->GPU.
 //  GPU tensors are currently only supported on mobile platforms.
+//  CPU tensors own their data, which is reused once their packet is released.
 //  This calculator uses FixedSizeInputStreamHandler by default.
 //
 // Note: Input defines output, so only these type sets are supported:
@@ -151,7 +154,8 @@ class TfLiteConverterCalculator : public CalculatorBase {
   ::mediapipe::Status ProcessCPU(CalculatorContext* cc);
   ::mediapipe::Status ProcessGPU(CalculatorContext* cc);
 
-  std::unique_ptr<tflite::Interpreter> interpreter_ = nullptr;
+  // Hands out the CPU output tensors.
+  TfLiteTensorPool tensor_pool_;
 
 #if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
   mediapipe::GlCalculatorHelper gpu_helper_;
@@ -246,10 +250,6 @@ REGISTER_CALCULATOR(TfLiteConverterCalculator);
     gpu_helper_ = [[MPPMetalHelper alloc] initWithCalculatorContext:cc];
     RET_CHECK(gpu_helper_);
 #endif
-  } else {
-    interpreter_ = absl::make_unique<tflite::Interpreter>();
-    interpreter_->AddTensors(1);
-    interpreter_->SetInputs({0});
   }
 
   return ::mediapipe::OkStatus();
@@ -299,30 +299,18 @@ REGISTER_CALCULATOR(TfLiteConverterCalculator);
             format == mediapipe::ImageFormat::GRAY8 ||
             format == mediapipe::ImageFormat::VEC32F1))
         RET_CHECK_FAIL() << "Unsupported CPU input format.";
-      TfLiteQuantization quant;
       if (use_quantized_tensors_) {
         RET_CHECK(format != mediapipe::ImageFormat::VEC32F1)
             << "Only 8-bit input images are supported for quantization.";
-        quant.type = kTfLiteAffineQuantization;
-        quant.params = nullptr;
-        // Optional: Set 'quant' quantization params here if needed.
-        interpreter_->SetTensorParametersReadWrite(0, kTfLiteUInt8, "",
-                                                   {channels_preserved}, quant);
-      } else {
-        // Initialize structure for no quantization.
-        quant.type = kTfLiteNoQuantization;
-        quant.params = nullptr;
-        interpreter_->SetTensorParametersReadWrite(0, kTfLiteFloat32, "",
-                                                   {channels_preserved}, quant);
       }
       initialized_ = true;
     }
 
-    const int tensor_idx = interpreter_->inputs()[0];
-    TfLiteTensor* tensor = interpreter_->tensor(tensor_idx);
-    interpreter_->ResizeInputTensor(tensor_idx,
-                                    {height, width, channels_preserved});
-    interpreter_->AllocateTensors();
+    TfLiteTensorSpec spec;
+    spec.type = use_quantized_tensors_ ? kTfLiteUInt8 : kTfLiteFloat32;
+    spec.dims = {height, width, channels_preserved};
+    auto output_tensors = tensor_pool_.GetTensors({spec});
+    TfLiteTensor* tensor = &output_tensors->at(0);
 
     // Copy image data into tensor.
     if (use_quantized_tensors_) {
@@ -356,11 +344,8 @@ REGISTER_CALCULATOR(TfLiteConverterCalculator);
       }
     }
 
-    auto output_tensors = absl::make_unique<std::vector<TfLiteTensor>>();
-    output_tensors->emplace_back(*tensor);
-    cc->Outputs()
-        .Tag(kTensorsTag)
-        .Add(output_tensors.release(), cc->InputTimestamp());
+    cc->Outputs().Tag(kTensorsTag).AddPacket(
+        PointToShared(std::move(output_tensors)).At(cc->InputTimestamp()));
   } else if (cc->Inputs().HasTag("MATRIX")) {
     // CPU Matrix to TfLiteTensor conversion.
 
@@ -369,28 +354,17 @@ REGISTER_CALCULATOR(TfLiteConverterCalculator);
     const int width = matrix.cols();
     const int channels = 1;
 
-    if (!initialized_) {
-      interpreter_->SetTensorParametersReadWrite(
-          /*tensor_index=*/0, /*type=*/kTfLiteFloat32, /*name=*/"",
-          /*dims=*/{channels}, /*quantization=*/TfLiteQuantization());
-      initialized_ = true;
-    }
-
-    const int tensor_idx = interpreter_->inputs()[0];
-    TfLiteTensor* tensor = interpreter_->tensor(tensor_idx);
-    interpreter_->ResizeInputTensor(tensor_idx, {height, width, channels});
-    interpreter_->AllocateTensors();
+    TfLiteTensorSpec spec;
+    spec.dims = {height, width, channels};
+    auto output_tensors = tensor_pool_.GetTensors({spec});
 
-    float* tensor_ptr = tensor->data.f;
+    float* tensor_ptr = output_tensors->at(0).data.f;
     RET_CHECK(tensor_ptr);
 
     MP_RETURN_IF_ERROR(CopyMatrixToTensor(matrix, tensor_ptr));
 
-    auto output_tensors = absl::make_unique<std::vector<TfLiteTensor>>();
-    output_tensors->emplace_back(*tensor);
-    cc->Outputs()
-        .Tag(kTensorsTag)
-        .Add(output_tensors.release(), cc->InputTimestamp());
+    cc->Outputs().Tag(kTensorsTag).AddPacket(
+        PointToShared(std::move(output_tensors)).At(cc->InputTimestamp()));
   }
 
   return ::mediapipe::OkStatus();
@@ -12,13 +12,21 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdint>
 #include <cstring>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "mediapipe/calculators/tflite/tflite_batch_inference_service.h"
 #include "mediapipe/calculators/tflite/tflite_inference_calculator.pb.h"
+#include "mediapipe/calculators/tflite/tflite_model_cache.h"
+#include "mediapipe/calculators/tflite/tflite_tensor_pool.h"
 #include "mediapipe/calculators/tflite/util.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/port/ret_check.h"
@@ -140,6 +148,30 @@ int GetXnnpackNumThreads(
 #endif  // !__EMSCRIPTEN__ || __EMSCRIPTEN_PTHREADS__
 }
 
+// Points interpreter tensors at packet data for one Invoke(), and back at the
+// interpreter's arena when destroyed, whichever way the caller returns.
+class BoundTensors {
+ public:
+  BoundTensors() = default;
+  BoundTensors(const BoundTensors&) = delete;
+  BoundTensors& operator=(const BoundTensors&) = delete;
+  ~BoundTensors() {
+    for (const auto& bound_tensor : bound_tensors_) {
+      bound_tensor.first->data.raw = bound_tensor.second;
+    }
+  }
+
+  // Points the interpreter tensor |tensor| at |data|.
+  void Bind(TfLiteTensor* tensor, char* data) {
+    bound_tensors_.emplace_back(tensor, tensor->data.raw);
+    tensor->data.raw = data;
+  }
+
+ private:
+  // The bound tensors, with their arena pointers.
+  std::vector<std::pair<TfLiteTensor*, char*>> bound_tensors_;
+};
+
 // Calculator Header Section
 
 // Runs inference on the provided input TFLite tensors and TFLite model.
@@ -200,10 +232,20 @@ int GetXnnpackNumThreads(
 // IMPORTANT Notes:
 //  Tensors are assumed to be ordered correctly (sequentially added to model).
 //  Input tensors are assumed to be of the correct size and already normalized.
-//  All output TfLiteTensors will be destroyed when the graph closes,
-//  (i.e. after calling graph.WaitUntilDone()).
+//  Unless a delegate keeps the tensor pointers of its first Invoke(), the
+//  interpreter reads the CPU input tensors and writes the CPU output tensors
+//  in place, instead of copying them to and from its arena. Such output
+//  TfLiteTensors own their data, so they stay valid while any copy of their
+//  packet is alive; otherwise they are views into the arena, which the next
+//  Invoke() overwrites.
 //  GPU tensors are currently only supported on Android and iOS.
 //  This calculator uses FixedSizeInputStreamHandler by default.
+//  With num_interpreters > 1 and the node's max_in_flight set to the same
+//  number, up to that many CPU inferences run concurrently on interpreters
+//  sharing one model; the graph still emits the outputs in timestamp order.
+//  With the batching option and the kTfLiteBatchInferenceService, the CPU
+//  inferences of calculators with the same model and options run as batches
+//  (see tflite_batch_inference_service.h).
 //
 class TfLiteInferenceCalculator : public CalculatorBase {
  public:
@@ -224,6 +266,19 @@ class TfLiteInferenceCalculator : public CalculatorBase {
   ::mediapipe::StatusOr<Packet> GetModelAsPacket(const CalculatorContext& cc);
   ::mediapipe::Status LoadDelegate(CalculatorContext* cc);
   ::mediapipe::Status InitTFLiteGPURunner();
+  ::mediapipe::Status LoadBatchInferencer(CalculatorContext* cc);
+  ::mediapipe::Status RunInference(CalculatorContext* cc,
+                                   tflite::Interpreter* interpreter);
+  tflite::Interpreter* AcquireInterpreter();
+  void ReleaseInterpreter(tflite::Interpreter* interpreter);
+  bool HasFreeInterpreter() const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(interpreter_mutex_) {
+    return !free_interpreters_.empty();
+  }
+  bool GetCpuOutputSpecs(const tflite::Interpreter& interpreter,
+                         std::vector<TfLiteTensorSpec>* specs);
+  bool CanBindCpuTensors();
+  bool DelegateReadsBoundTensors();
 
   Packet model_packet_;
   std::unique_ptr<tflite::Interpreter> interpreter_;
@@ -253,6 +308,24 @@ class TfLiteInferenceCalculator : public CalculatorBase {
   bool use_quantized_tensors_ = false;
 
   bool use_advanced_gpu_api_ = false;
+
+  // Hands out the CPU output tensors.
+  TfLiteTensorPool output_pool_;
+  // True if the interpreter can use the CPU input and output tensors in place.
+  bool bind_cpu_tensors_ = false;
+
+  // With num_interpreters > 1, the CPU interpreters beyond interpreter_, which
+  // share its model, and their delegates. Concurrent Process() calls each
+  // take a free interpreter.
+  std::vector<TfLiteDelegatePtr> extra_delegates_;
+  std::vector<std::unique_ptr<tflite::Interpreter>> extra_interpreters_;
+  absl::Mutex interpreter_mutex_;
+  std::vector<tflite::Interpreter*> free_interpreters_
+      ABSL_GUARDED_BY(interpreter_mutex_);
+
+  // With the batching option, runs the CPU inferences instead of the
+  // interpreters above.
+  std::shared_ptr<TfLiteBatchInferencer> batch_inferencer_;
 };
 REGISTER_CALCULATOR(TfLiteInferenceCalculator);
 
@@ -315,6 +388,10 @@ REGISTER_CALCULATOR(TfLiteInferenceCalculator);
 #endif
   }
 
+  if (options.has_batching()) {
+    cc->UseService(kTfLiteBatchInferenceService).Optional();
+  }
+
   // Assign this calculator's default InputStreamHandler.
   cc->SetInputStreamHandler("FixedSizeInputStreamHandler");
 
@@ -353,6 +430,22 @@ REGISTER_CALCULATOR(TfLiteInferenceCalculator);
       cc->Options<mediapipe::TfLiteInferenceCalculatorOptions>();
   use_advanced_gpu_api_ = false;
 
+  RET_CHECK_GE(calculator_opts.num_interpreters(), 1);
+  if (calculator_opts.num_interpreters() > 1) {
+    RET_CHECK(!gpu_inference_ && !gpu_input_ && !gpu_output_)
+        << "num_interpreters > 1 is only supported for CPU inference.";
+#if defined(MEDIAPIPE_EDGE_TPU)
+    RET_CHECK_FAIL() << "num_interpreters > 1 is not supported on Edge TPU.";
+#endif  // MEDIAPIPE_EDGE_TPU
+  }
+
+#if !defined(MEDIAPIPE_EDGE_TPU)
+  if (calculator_opts.has_batching() && !gpu_inference_ && !gpu_input_ &&
+      !gpu_output_ && cc->Service(kTfLiteBatchInferenceService).IsAvailable()) {
+    return LoadBatchInferencer(cc);
+  }
+#endif  // !MEDIAPIPE_EDGE_TPU
+
   MP_RETURN_IF_ERROR(LoadModel(cc));
 
   if (gpu_inference_) {
@@ -374,9 +467,9 @@ REGISTER_CALCULATOR(TfLiteInferenceCalculator);
     MP_RETURN_IF_ERROR(LoadDelegate(cc));
 #endif
   } else {
-#if defined(__EMSCRIPTEN__) || defined(MEDIAPIPE_ANDROID)
+    // Applies the XNNPACK (or NNAPI) delegate when requested in the options.
     MP_RETURN_IF_ERROR(LoadDelegate(cc));
-#endif  // __EMSCRIPTEN__ || ANDROID
+    bind_cpu_tensors_ = !gpu_input_ && CanBindCpuTensors();
   }
   return ::mediapipe::OkStatus();
 }
@@ -402,6 +495,34 @@ REGISTER_CALCULATOR(TfLiteInferenceCalculator);
 }
 
 ::mediapipe::Status TfLiteInferenceCalculator::Process(CalculatorContext* cc) {
+  if (batch_inferencer_) {
+    const auto& input_tensors =
+        cc->Inputs().Tag(kTensorsTag).Get<std::vector<TfLiteTensor>>();
+    RET_CHECK_GT(input_tensors.size(), 0);
+    ASSIGN_OR_RETURN(std::shared_ptr<std::vector<TfLiteTensor>> output_tensors,
+                     batch_inferencer_->Run(input_tensors));
+    cc->Outputs()
+        .Tag(kTensorsTag)
+        .AddPacket(PointToShared(std::move(output_tensors))
+                       .At(cc->InputTimestamp()));
+    return ::mediapipe::OkStatus();
+  }
+  if (extra_interpreters_.empty()) {
+    return RunInference(cc, interpreter_.get());
+  }
+  tflite::Interpreter* interpreter = AcquireInterpreter();
+  const ::mediapipe::Status status = RunInference(cc, interpreter);
+  ReleaseInterpreter(interpreter);
+  return status;
+}
+
+::mediapipe::Status TfLiteInferenceCalculator::RunInference(
+    CalculatorContext* cc, tflite::Interpreter* interpreter) {
+  // The pooled CPU output tensors.
+  std::shared_ptr<std::vector<TfLiteTensor>> cpu_output_tensors;
+  // Unbound when RunInference() returns, before the interpreter is released.
+  BoundTensors bound_tensors;
+
   // 1. Receive pre-processed tensor inputs.
   if (use_advanced_gpu_api_) {
 #if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
@@ -472,18 +593,33 @@ REGISTER_CALCULATOR(TfLiteInferenceCalculator);
     for (int i = 0; i < input_tensors.size(); ++i) {
       const TfLiteTensor* input_tensor = &input_tensors[i];
       RET_CHECK(input_tensor->data.raw);
-      if (use_quantized_tensors_) {
+      TfLiteTensor* local_tensor =
+          interpreter->tensor(interpreter->inputs()[i]);
+      if (bind_cpu_tensors_ && input_tensor->type == local_tensor->type &&
+          input_tensor->bytes == local_tensor->bytes) {
+        // The input packet stays alive until Process() returns.
+        bound_tensors.Bind(local_tensor, input_tensor->data.raw);
+      } else if (use_quantized_tensors_) {
         const uint8* input_tensor_buffer = input_tensor->data.uint8;
-        uint8* local_tensor_buffer = interpreter_->typed_input_tensor<uint8>(i);
+        uint8* local_tensor_buffer = interpreter->typed_input_tensor<uint8>(i);
         std::memcpy(local_tensor_buffer, input_tensor_buffer,
                     input_tensor->bytes);
       } else {
         const float* input_tensor_buffer = input_tensor->data.f;
-        float* local_tensor_buffer = interpreter_->typed_input_tensor<float>(i);
+        float* local_tensor_buffer = interpreter->typed_input_tensor<float>(i);
         std::memcpy(local_tensor_buffer, input_tensor_buffer,
                     input_tensor->bytes);
       }
     }
+    std::vector<TfLiteTensorSpec> output_specs;
+    if (bind_cpu_tensors_ && GetCpuOutputSpecs(*interpreter, &output_specs)) {
+      cpu_output_tensors = output_pool_.GetTensors(output_specs);
+      const auto& tensor_indexes = interpreter->outputs();
+      for (int i = 0; i < tensor_indexes.size(); ++i) {
+        bound_tensors.Bind(interpreter->tensor(tensor_indexes[i]),
+                           cpu_output_tensors->at(i).data.raw);
+      }
+    }
   }
 
   // 2. Run inference.
@@ -502,7 +638,7 @@ REGISTER_CALCULATOR(TfLiteInferenceCalculator);
     RET_CHECK_EQ(interpreter_->Invoke(), kTfLiteOk);
 #endif
   } else {
-    RET_CHECK_EQ(interpreter_->Invoke(), kTfLiteOk);
+    RET_CHECK_EQ(interpreter->Invoke(), kTfLiteOk);
   }
 
   // 3. Output processed tensors.
@@ -563,22 +699,36 @@ REGISTER_CALCULATOR(TfLiteInferenceCalculator);
     RET_CHECK_FAIL() << "GPU processing not enabled.";
 #endif  //  !MEDIAPIPE_DISABLE_GPU
   } else {
-    // Output result tensors (CPU).
-    const auto& tensor_indexes = interpreter_->outputs();
-    auto output_tensors = absl::make_unique<std::vector<TfLiteTensor>>();
-    for (int i = 0; i < tensor_indexes.size(); ++i) {
-      TfLiteTensor* tensor = interpreter_->tensor(tensor_indexes[i]);
-      output_tensors->emplace_back(*tensor);
+    // Output result tensors (CPU). Unless the interpreter wrote them in
+    // place, they are views into its arena.
+    if (cpu_output_tensors) {
+      cc->Outputs().Tag(kTensorsTag).AddPacket(
+          PointToShared(std::move(cpu_output_tensors))
+              .At(cc->InputTimestamp()));
+    } else {
+      const auto& tensor_indexes = interpreter->outputs();
+      auto output_tensors = absl::make_unique<std::vector<TfLiteTensor>>();
+      for (int i = 0; i < tensor_indexes.size(); ++i) {
+        TfLiteTensor* tensor = interpreter->tensor(tensor_indexes[i]);
+        output_tensors->emplace_back(*tensor);
+      }
+      cc->Outputs()
+          .Tag(kTensorsTag)
+          .Add(output_tensors.release(), cc->InputTimestamp());
     }
-    cc->Outputs()
-        .Tag(kTensorsTag)
-        .Add(output_tensors.release(), cc->InputTimestamp());
   }
 
   return ::mediapipe::OkStatus();
 }
 
 ::mediapipe::Status TfLiteInferenceCalculator::Close(CalculatorContext* cc) {
+  batch_inferencer_.reset();
+  {
+    absl::MutexLock lock(&interpreter_mutex_);
+    free_interpreters_.clear();
+  }
+  extra_interpreters_.clear();
+  extra_delegates_.clear();
   if (delegate_) {
     if (gpu_inference_) {
 #if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
@@ -616,6 +766,126 @@ REGISTER_CALCULATOR(TfLiteInferenceCalculator);
 
 // Calculator Auxiliary Section
 
+bool TfLiteInferenceCalculator::GetCpuOutputSpecs(
+    const tflite::Interpreter& interpreter,
+    std::vector<TfLiteTensorSpec>* specs) {
+  const auto& tensor_indexes = interpreter.outputs();
+  specs->resize(tensor_indexes.size());
+  for (int i = 0; i < tensor_indexes.size(); ++i) {
+    const TfLiteTensor* tensor = interpreter.tensor(tensor_indexes[i]);
+    if (!tensor->data.raw || !GetTfLiteTensorSpec(*tensor, &specs->at(i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TfLiteInferenceCalculator::CanBindCpuTensors() {
+#if defined(MEDIAPIPE_EDGE_TPU)
+  return false;
+#else
+  std::vector<TfLiteTensorSpec> output_specs;
+  if (!GetCpuOutputSpecs(*interpreter_, &output_specs)) return false;
+  for (int i = 0; i < interpreter_->tensors_size(); ++i) {
+    // Resizing a dynamic tensor in Invoke() re-plans the arena, which points
+    // the bound tensors back at it.
+    if (interpreter_->tensor(i)->allocation_type == kTfLiteDynamic) {
+      return false;
+    }
+  }
+  std::vector<int> tensor_indexes = interpreter_->inputs();
+  tensor_indexes.insert(tensor_indexes.end(), interpreter_->outputs().begin(),
+                        interpreter_->outputs().end());
+  for (int i = 0; i < tensor_indexes.size(); ++i) {
+    if (interpreter_->tensor(tensor_indexes[i])->allocation_type !=
+        kTfLiteArenaRw) {
+      return false;
+    }
+    // A tensor bound twice could not be restored.
+    for (int j = 0; j < i; ++j) {
+      if (tensor_indexes[j] == tensor_indexes[i]) return false;
+    }
+  }
+  return !delegate_ || DelegateReadsBoundTensors();
+#endif  // MEDIAPIPE_EDGE_TPU
+}
+
+bool TfLiteInferenceCalculator::DelegateReadsBoundTensors() {
+  // Some delegates, such as XNNPACK in some versions, set up their kernels
+  // with the tensor pointers of the first Invoke() and keep them. The first
+  // run is done on the arena, so that such a delegate keeps valid pointers,
+  // and gives the reference outputs for zero inputs.
+  const auto& input_indexes = interpreter_->inputs();
+  const auto& output_indexes = interpreter_->outputs();
+  for (int index : input_indexes) {
+    TfLiteTensor* tensor = interpreter_->tensor(index);
+    std::memset(tensor->data.raw, 0, tensor->bytes);
+  }
+  if (interpreter_->Invoke() != kTfLiteOk) return false;
+  std::vector<std::string> reference_outputs;
+  for (int index : output_indexes) {
+    const TfLiteTensor* tensor = interpreter_->tensor(index);
+    reference_outputs.emplace_back(tensor->data.raw, tensor->bytes);
+  }
+
+  // The second run binds zero inputs and outputs that differ from the
+  // reference everywhere, and fills the arena inputs with other values. The
+  // bound outputs then match the reference only if the delegate read and
+  // wrote the bound tensors.
+  std::vector<TfLiteTensorSpec> input_specs(input_indexes.size());
+  for (int i = 0; i < input_indexes.size(); ++i) {
+    TfLiteTensor* tensor = interpreter_->tensor(input_indexes[i]);
+    if (!GetTfLiteTensorSpec(*tensor, &input_specs[i])) return false;
+    std::memset(tensor->data.raw, 0x3f, tensor->bytes);
+  }
+  std::vector<TfLiteTensorSpec> output_specs;
+  if (!GetCpuOutputSpecs(*interpreter_, &output_specs)) return false;
+  TfLiteTensorPool probe_pool;
+  auto inputs = probe_pool.GetTensors(input_specs);
+  auto outputs = probe_pool.GetTensors(output_specs);
+  {
+    BoundTensors bound_tensors;
+    for (int i = 0; i < input_indexes.size(); ++i) {
+      TfLiteTensor& input = inputs->at(i);
+      std::memset(input.data.raw, 0, input.bytes);
+      bound_tensors.Bind(interpreter_->tensor(input_indexes[i]),
+                         input.data.raw);
+    }
+    for (int i = 0; i < output_indexes.size(); ++i) {
+      TfLiteTensor& output = outputs->at(i);
+      for (size_t j = 0; j < output.bytes; ++j) {
+        output.data.raw[j] = ~reference_outputs[i][j];
+      }
+      bound_tensors.Bind(interpreter_->tensor(output_indexes[i]),
+                         output.data.raw);
+    }
+    if (interpreter_->Invoke() != kTfLiteOk) return false;
+  }
+  for (int i = 0; i < output_indexes.size(); ++i) {
+    const TfLiteTensor& output = outputs->at(i);
+    if (std::memcmp(output.data.raw, reference_outputs[i].data(),
+                    output.bytes) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+tflite::Interpreter* TfLiteInferenceCalculator::AcquireInterpreter() {
+  absl::MutexLock lock(&interpreter_mutex_);
+  interpreter_mutex_.Await(
+      absl::Condition(this, &TfLiteInferenceCalculator::HasFreeInterpreter));
+  tflite::Interpreter* interpreter = free_interpreters_.back();
+  free_interpreters_.pop_back();
+  return interpreter;
+}
+
+void TfLiteInferenceCalculator::ReleaseInterpreter(
+    tflite::Interpreter* interpreter) {
+  absl::MutexLock lock(&interpreter_mutex_);
+  free_interpreters_.push_back(interpreter);
+}
+
 ::mediapipe::Status TfLiteInferenceCalculator::LoadModel(
     CalculatorContext* cc) {
   ASSIGN_OR_RETURN(model_packet_, GetModelAsPacket(*cc));
@@ -650,13 +920,14 @@ REGISTER_CALCULATOR(TfLiteInferenceCalculator);
 
   RET_CHECK(interpreter_);
 
+  const auto& calculator_opts =
+      cc->Options<mediapipe::TfLiteInferenceCalculatorOptions>();
 #if defined(__EMSCRIPTEN__) || defined(MEDIAPIPE_EDGE_TPU)
-  interpreter_->SetNumThreads(1);
+  const int num_threads = 1;
 #else
-  interpreter_->SetNumThreads(
-      cc->Options<mediapipe::TfLiteInferenceCalculatorOptions>()
-          .cpu_num_thread());
+  const int num_threads = calculator_opts.cpu_num_thread();
 #endif  // __EMSCRIPTEN__
+  interpreter_->SetNumThreads(num_threads);
 
   if (gpu_output_) {
     use_quantized_tensors_ = false;
@@ -668,6 +939,69 @@ REGISTER_CALCULATOR(TfLiteInferenceCalculator);
     if (use_quantized_tensors_) gpu_inference_ = false;
   }
 
+  // The extra interpreters share the model, so its weights are loaded once;
+  // each has its own arena.
+  for (int i = 1; i < calculator_opts.num_interpreters(); ++i) {
+    std::unique_ptr<tflite::Interpreter> interpreter;
+    tflite::InterpreterBuilder(model, op_resolver)(&interpreter);
+    RET_CHECK(interpreter);
+    interpreter->SetNumThreads(num_threads);
+    RET_CHECK_EQ(interpreter->AllocateTensors(), kTfLiteOk);
+    extra_interpreters_.push_back(std::move(interpreter));
+  }
+  if (!extra_interpreters_.empty()) {
+    absl::MutexLock lock(&interpreter_mutex_);
+    free_interpreters_.push_back(interpreter_.get());
+    for (const auto& interpreter : extra_interpreters_) {
+      free_interpreters_.push_back(interpreter.get());
+    }
+  }
+
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status TfLiteInferenceCalculator::LoadBatchInferencer(
+    CalculatorContext* cc) {
+  const auto& calculator_opts =
+      cc->Options<mediapipe::TfLiteInferenceCalculatorOptions>();
+  ASSIGN_OR_RETURN(model_packet_, GetModelAsPacket(*cc));
+  // The inferencer keeps the model packet alive.
+  auto model_holder = std::make_shared<Packet>(model_packet_);
+  std::shared_ptr<const tflite::FlatBufferModel> model(
+      model_holder, model_holder->Get<TfLiteModelPtr>().get());
+
+  tflite::ops::builtin::BuiltinOpResolver op_resolver;
+  if (cc->InputSidePackets().HasTag("CUSTOM_OP_RESOLVER")) {
+    op_resolver = cc->InputSidePackets()
+                      .Tag("CUSTOM_OP_RESOLVER")
+                      .Get<tflite::ops::builtin::BuiltinOpResolver>();
+  }
+
+  TfLiteBatchOptions batch_options;
+  batch_options.max_batch_size = calculator_opts.batching().max_batch_size();
+  batch_options.max_wait =
+      absl::Microseconds(calculator_opts.batching().max_wait_us());
+#if defined(__EMSCRIPTEN__)
+  batch_options.num_threads = 1;
+#else
+  batch_options.num_threads = calculator_opts.cpu_num_thread();
+#endif  // __EMSCRIPTEN__
+  if (calculator_opts.has_delegate() &&
+      calculator_opts.delegate().has_xnnpack()) {
+    batch_options.xnnpack_num_threads = GetXnnpackNumThreads(calculator_opts);
+  }
+
+  // Calculators share an inferencer if they have the same options and, when
+  // the model comes from a side packet, the same model.
+  std::string key = calculator_opts.SerializeAsString();
+  if (calculator_opts.model_path().empty()) {
+    key += absl::StrCat("@", reinterpret_cast<uintptr_t>(model.get()));
+  }
+  ASSIGN_OR_RETURN(batch_inferencer_,
+                   cc->Service(kTfLiteBatchInferenceService)
+                       .GetObject()
+                       .GetBatchInferencer(key, std::move(model), op_resolver,
+                                           batch_options));
   return ::mediapipe::OkStatus();
 }
 
@@ -680,10 +1014,14 @@ REGISTER_CALCULATOR(TfLiteInferenceCalculator);
 
     ASSIGN_OR_RETURN(model_path, mediapipe::PathToResourceAsFile(model_path));
 
-    auto model = tflite::FlatBufferModel::BuildFromFile(model_path.c_str());
-    RET_CHECK(model) << "Failed to load model from path.";
-    return MakePacket<TfLiteModelPtr>(TfLiteModelPtr(
-        model.release(), [](tflite::FlatBufferModel* model) { delete model; }));
+    // Calculators loading the same file share one mapping of it.
+    ASSIGN_OR_RETURN(std::shared_ptr<tflite::FlatBufferModel> model,
+                     TfLiteModelCache::GetInstance()->GetModel(model_path));
+    tflite::FlatBufferModel* model_ptr = model.get();
+    return MakePacket<TfLiteModelPtr>(
+        TfLiteModelPtr(model_ptr, [model](tflite::FlatBufferModel*) mutable {
+          model.reset();
+        }));
   }
   if (cc.InputSidePackets().HasTag("MODEL")) {
     return cc.InputSidePackets().Tag("MODEL");
@@ -719,6 +1057,12 @@ REGISTER_CALCULATOR(TfLiteInferenceCalculator);
           });
       RET_CHECK_EQ(interpreter_->ModifyGraphWithDelegate(delegate_.get()),
                    kTfLiteOk);
+      // The NNAPI delegate is a singleton that every interpreter can use.
+      for (const auto& interpreter : extra_interpreters_) {
+        interpreter->SetAllowFp16PrecisionForFp32(1);
+        RET_CHECK_EQ(interpreter->ModifyGraphWithDelegate(delegate_.get()),
+                     kTfLiteOk);
+      }
       return ::mediapipe::OkStatus();
     }
 #endif  // MEDIAPIPE_ANDROID
@@ -737,6 +1081,16 @@ REGISTER_CALCULATOR(TfLiteInferenceCalculator);
                                     &TfLiteXNNPackDelegateDelete);
       RET_CHECK_EQ(interpreter_->ModifyGraphWithDelegate(delegate_.get()),
                    kTfLiteOk);
+      // An XNNPACK delegate keeps per-interpreter state, so each extra
+      // interpreter gets its own.
+      for (const auto& interpreter : extra_interpreters_) {
+        extra_delegates_.emplace_back(
+            TfLiteXNNPackDelegateCreate(&xnnpack_opts),
+            &TfLiteXNNPackDelegateDelete);
+        RET_CHECK_EQ(
+            interpreter->ModifyGraphWithDelegate(extra_delegates_.back().get()),
+            kTfLiteOk);
+      }
     }
 
     // Return, no need for GPU delegate below.
@@ -12,13 +12,16 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
+#include "mediapipe/calculators/tflite/tflite_batch_inference_service.h"
 #include "mediapipe/calculators/tflite/tflite_inference_calculator.pb.h"
+#include "mediapipe/calculators/tflite/tflite_tensor_pool.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/deps/file_path.h"
@@ -41,6 +44,20 @@ namespace mediapipe {
 
 using ::tflite::Interpreter;
 
+constexpr int kTensorSize = 8 * 8 * 3;
+
+// Returns an input packet of one [8, 8, 3] float tensor filled with |value|.
+// The tensors outlive the pool, which only keeps them for reuse.
+Packet MakeInputPacket(float value) {
+  TfLiteTensorPool pool;
+  TfLiteTensorSpec spec;
+  spec.dims = {8, 8, 3};
+  std::shared_ptr<std::vector<TfLiteTensor>> tensors = pool.GetTensors({spec});
+  float* data = (*tensors)[0].data.f;
+  std::fill(data, data + kTensorSize, value);
+  return PointToShared(std::move(tensors));
+}
+
 void DoSmokeTest(const std::string& graph_proto) {
   const int width = 8;
   const int height = 8;
@@ -129,6 +146,177 @@ TEST(TfLiteInferenceCalculatorTest, SmokeTest) {
       {{"$delegate", "delegate { xnnpack { num_threads: 10 } }"}}));
 }
 
+// Tests that the output tensors are not overwritten by the next Invoke().
+TEST(TfLiteInferenceCalculatorTest, OutputsOutliveTheNextInvoke) {
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: "tensor_in"
+        node {
+          calculator: "TfLiteInferenceCalculator"
+          input_stream: "TENSORS:tensor_in"
+          output_stream: "TENSORS:tensor_out"
+          options {
+            [mediapipe.TfLiteInferenceCalculatorOptions.ext] {
+              model_path: "mediapipe/calculators/tflite/testdata/add.bin"
+            }
+          }
+        }
+      )");
+  std::vector<Packet> output_packets;
+  tool::AddVectorSink("tensor_out", &graph_config, &output_packets);
+  CalculatorGraph graph(graph_config);
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  for (int value = 1; value <= 2; ++value) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "tensor_in", MakeInputPacket(value).At(Timestamp(value))));
+    MP_ASSERT_OK(graph.WaitUntilIdle());
+  }
+  ASSERT_EQ(2, output_packets.size());
+  for (int i = 0; i < 2; ++i) {
+    const auto& result = output_packets[i].Get<std::vector<TfLiteTensor>>();
+    EXPECT_EQ(3 * (i + 1), result[0].data.f[0]);
+  }
+
+  MP_ASSERT_OK(graph.CloseInputStream("tensor_in"));
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+// Tests that the XNNPACK delegate reads and writes the bound tensors, so that
+// each output packet keeps its own data.
+TEST(TfLiteInferenceCalculatorTest, XnnpackUsesBoundTensors) {
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: "tensor_in"
+        node {
+          calculator: "TfLiteInferenceCalculator"
+          input_stream: "TENSORS:tensor_in"
+          output_stream: "TENSORS:tensor_out"
+          options {
+            [mediapipe.TfLiteInferenceCalculatorOptions.ext] {
+              model_path: "mediapipe/calculators/tflite/testdata/add.bin"
+              delegate { xnnpack {} }
+            }
+          }
+        }
+      )");
+  std::vector<Packet> output_packets;
+  tool::AddVectorSink("tensor_out", &graph_config, &output_packets);
+  CalculatorGraph graph(graph_config);
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  for (int value = 1; value <= 2; ++value) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "tensor_in", MakeInputPacket(value).At(Timestamp(value))));
+    MP_ASSERT_OK(graph.WaitUntilIdle());
+  }
+  ASSERT_EQ(2, output_packets.size());
+  const auto& first = output_packets[0].Get<std::vector<TfLiteTensor>>();
+  const auto& second = output_packets[1].Get<std::vector<TfLiteTensor>>();
+  // Views into the arena would share one buffer, holding the last outputs.
+  EXPECT_NE(first[0].data.raw, second[0].data.raw);
+  for (int i = 0; i < kTensorSize; ++i) {
+    ASSERT_EQ(3, first[0].data.f[i]);
+    ASSERT_EQ(6, second[0].data.f[i]);
+  }
+
+  MP_ASSERT_OK(graph.CloseInputStream("tensor_in"));
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+// Tests that concurrent inferences on several interpreters keep their outputs
+// in timestamp order.
+TEST(TfLiteInferenceCalculatorTest, MultipleInterpreters) {
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: "tensor_in"
+        num_threads: 4
+        node {
+          calculator: "TfLiteInferenceCalculator"
+          input_stream: "TENSORS:tensor_in"
+          output_stream: "TENSORS:tensor_out"
+          max_in_flight: 2
+          options {
+            [mediapipe.TfLiteInferenceCalculatorOptions.ext] {
+              model_path: "mediapipe/calculators/tflite/testdata/add.bin"
+              num_interpreters: 2
+            }
+          }
+        }
+      )");
+  std::vector<Packet> output_packets;
+  tool::AddVectorSink("tensor_out", &graph_config, &output_packets);
+  CalculatorGraph graph(graph_config);
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  constexpr int kNumFrames = 8;
+  for (int i = 0; i < kNumFrames; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "tensor_in", MakeInputPacket(i).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.CloseInputStream("tensor_in"));
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  ASSERT_EQ(kNumFrames, output_packets.size());
+  for (int i = 0; i < kNumFrames; ++i) {
+    EXPECT_EQ(Timestamp(i), output_packets[i].Timestamp());
+    const auto& result = output_packets[i].Get<std::vector<TfLiteTensor>>();
+    EXPECT_EQ(3 * i, result[0].data.f[kTensorSize - 1]);
+  }
+}
+
+// Tests two calculators whose inferences run as batches of two.
+TEST(TfLiteInferenceCalculatorTest, BatchInferenceService) {
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: "tensor_in"
+        num_threads: 4
+        node {
+          calculator: "TfLiteInferenceCalculator"
+          input_stream: "TENSORS:tensor_in"
+          output_stream: "TENSORS:tensor_out_a"
+          options {
+            [mediapipe.TfLiteInferenceCalculatorOptions.ext] {
+              model_path: "mediapipe/calculators/tflite/testdata/add.bin"
+              batching { max_batch_size: 2 max_wait_us: 60000000 }
+            }
+          }
+        }
+        node {
+          calculator: "TfLiteInferenceCalculator"
+          input_stream: "TENSORS:tensor_in"
+          output_stream: "TENSORS:tensor_out_b"
+          options {
+            [mediapipe.TfLiteInferenceCalculatorOptions.ext] {
+              model_path: "mediapipe/calculators/tflite/testdata/add.bin"
+              batching { max_batch_size: 2 max_wait_us: 60000000 }
+            }
+          }
+        }
+      )");
+  std::vector<Packet> output_packets_a;
+  std::vector<Packet> output_packets_b;
+  tool::AddVectorSink("tensor_out_a", &graph_config, &output_packets_a);
+  tool::AddVectorSink("tensor_out_b", &graph_config, &output_packets_b);
+  CalculatorGraph graph(graph_config);
+  MP_ASSERT_OK(graph.SetServiceObject(
+      kTfLiteBatchInferenceService,
+      std::make_shared<TfLiteBatchInferenceService>()));
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  MP_ASSERT_OK(graph.AddPacketToInputStream(
+      "tensor_in", MakeInputPacket(2).At(Timestamp(0))));
+  MP_ASSERT_OK(graph.CloseInputStream("tensor_in"));
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  for (const auto* output_packets : {&output_packets_a, &output_packets_b}) {
+    ASSERT_EQ(1, output_packets->size());
+    const auto& result = (*output_packets)[0].Get<std::vector<TfLiteTensor>>();
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(6, result[0].data.f[kTensorSize - 1]);
+  }
+}
+
 TEST(TfLiteInferenceCalculatorTest, SmokeTest_ModelAsInputSidePacket) {
   std::string graph_proto = R"(
     input_stream: "tensor_in"
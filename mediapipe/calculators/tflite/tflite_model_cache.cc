@@ -0,0 +1,55 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tflite/tflite_model_cache.h"
+
+#include <sys/stat.h>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/canonical_errors.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+
+TfLiteModelCache* TfLiteModelCache::GetInstance() {
+  static TfLiteModelCache* instance = new TfLiteModelCache;
+  return instance;
+}
+
+::mediapipe::StatusOr<std::shared_ptr<tflite::FlatBufferModel>>
+TfLiteModelCache::GetModel(const std::string& path) {
+  struct stat file_stat;
+  if (stat(path.c_str(), &file_stat) != 0) {
+    return ::mediapipe::NotFoundError(
+        absl::StrCat("Failed to find model file ", path));
+  }
+  const std::string file_id =
+      absl::StrCat(file_stat.st_size, ":", file_stat.st_mtime, ":",
+                   file_stat.st_ino);
+
+  // Loading under the lock keeps concurrent callers from mapping the same
+  // file twice. BuildFromFile only maps the file, so the wait is short.
+  absl::MutexLock lock(&mutex_);
+  Entry& entry = entries_[path];
+  std::shared_ptr<tflite::FlatBufferModel> model = entry.model.lock();
+  if (model && entry.file_id == file_id) return model;
+
+  model = tflite::FlatBufferModel::BuildFromFile(path.c_str());
+  RET_CHECK(model) << "Failed to load model from path " << path;
+  entry.file_id = file_id;
+  entry.model = model;
+  return model;
+}
+
+}  // namespace mediapipe
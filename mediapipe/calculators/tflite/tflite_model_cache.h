@@ -0,0 +1,65 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This class shares the TF Lite models loaded from files among all the
+// calculators and graphs of a process. What is shared is the FlatBufferModel
+// object and the read-only file mapping it owns, so each model file is opened
+// and mapped once. Everything built from the model stays per interpreter,
+// including the packed weights of delegates such as XNNPACK.
+//
+//   ASSIGN_OR_RETURN(std::shared_ptr<tflite::FlatBufferModel> model,
+//                    TfLiteModelCache::GetInstance()->GetModel(path));
+//
+// A model is identified by its path and the size, modification time and
+// inode of its file, so that a file replaced on disk is loaded again. A model
+// stays cached while any caller holds it.
+
+#ifndef MEDIAPIPE_CALCULATORS_TFLITE_TFLITE_MODEL_CACHE_H_
+#define MEDIAPIPE_CALCULATORS_TFLITE_TFLITE_MODEL_CACHE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "tensorflow/lite/model.h"
+
+namespace mediapipe {
+
+class TfLiteModelCache {
+ public:
+  // Returns the process-wide cache.
+  static TfLiteModelCache* GetInstance();
+
+  TfLiteModelCache() {}
+
+  // Returns the model in the file at |path|, loading it unless a model of the
+  // same file is still in use.
+  ::mediapipe::StatusOr<std::shared_ptr<tflite::FlatBufferModel>> GetModel(
+      const std::string& path);
+
+ private:
+  struct Entry {
+    std::string file_id;
+    std::weak_ptr<tflite::FlatBufferModel> model;
+  };
+
+  absl::Mutex mutex_;
+  std::map<std::string, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TFLITE_TFLITE_MODEL_CACHE_H_
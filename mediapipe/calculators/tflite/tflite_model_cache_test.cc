@@ -0,0 +1,63 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tflite/tflite_model_cache.h"
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr char kModelPath[] = "mediapipe/calculators/tflite/testdata/add.bin";
+
+TEST(TfLiteModelCacheTest, SharesModelsOfTheSameFile) {
+  TfLiteModelCache cache;
+  auto first = cache.GetModel(kModelPath);
+  auto second = cache.GetModel(kModelPath);
+  MP_ASSERT_OK(first.status());
+  MP_ASSERT_OK(second.status());
+  EXPECT_EQ(first.ValueOrDie(), second.ValueOrDie());
+}
+
+TEST(TfLiteModelCacheTest, ReloadsChangedFiles) {
+  std::string contents;
+  MP_ASSERT_OK(file::GetContents(kModelPath, &contents));
+  const std::string path =
+      absl::StrCat(getenv("TEST_TMPDIR"), "/reloaded_model.tflite");
+  MP_ASSERT_OK(file::SetContents(path, contents));
+
+  TfLiteModelCache cache;
+  auto first = cache.GetModel(path);
+  MP_ASSERT_OK(first.status());
+  // Trailing bytes change the size of the file, not the model.
+  MP_ASSERT_OK(file::SetContents(path, contents + std::string(64, '\0')));
+  auto second = cache.GetModel(path);
+  MP_ASSERT_OK(second.status());
+  EXPECT_NE(first.ValueOrDie(), second.ValueOrDie());
+}
+
+TEST(TfLiteModelCacheTest, FailsOnMissingFiles) {
+  TfLiteModelCache cache;
+  EXPECT_FALSE(cache.GetModel("/no/such/model.tflite").ok());
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,187 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tflite/tflite_tensor_pool.h"
+
+#include <cstdint>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port/aligned_malloc_and_free.h"
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+namespace {
+
+// Returns the size of one element of |type|, or 0 if it has no fixed size.
+size_t ElementSize(TfLiteType type) {
+  switch (type) {
+    case kTfLiteFloat32:
+    case kTfLiteInt32:
+      return 4;
+    case kTfLiteUInt8:
+    case kTfLiteInt8:
+    case kTfLiteBool:
+      return 1;
+    case kTfLiteInt16:
+    case kTfLiteFloat16:
+      return 2;
+    case kTfLiteInt64:
+    case kTfLiteComplex64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+size_t TensorBytes(const TfLiteTensorSpec& spec) {
+  size_t bytes = ElementSize(spec.type);
+  for (int dim : spec.dims) bytes *= dim;
+  return bytes;
+}
+
+// Rounds |size| up to a multiple of kTfLiteTensorPoolAlignment.
+size_t Align(size_t size) {
+  return (size + kTfLiteTensorPoolAlignment - 1) /
+         kTfLiteTensorPoolAlignment * kTfLiteTensorPoolAlignment;
+}
+
+}  // namespace
+
+bool operator==(const TfLiteTensorSpec& lhs, const TfLiteTensorSpec& rhs) {
+  return lhs.type == rhs.type && lhs.dims == rhs.dims &&
+         lhs.params.scale == rhs.params.scale &&
+         lhs.params.zero_point == rhs.params.zero_point;
+}
+
+bool GetTfLiteTensorSpec(const TfLiteTensor& tensor, TfLiteTensorSpec* spec) {
+  if (ElementSize(tensor.type) == 0 || !tensor.dims) return false;
+  spec->type = tensor.type;
+  spec->dims.assign(tensor.dims->data, tensor.dims->data + tensor.dims->size);
+  spec->params = tensor.params;
+  return true;
+}
+
+// The tensors of one packet, and the memory they point to.
+class TfLiteTensorPool::Buffer {
+ public:
+  explicit Buffer(const std::vector<TfLiteTensorSpec>& specs)
+      : specs_(specs), tensors_(specs.size()) {
+    // Each tensor is followed by kTfLiteTensorPoolAlignment bytes of padding.
+    std::vector<size_t> offsets;
+    size_t size = 0;
+    for (const TfLiteTensorSpec& spec : specs) {
+      offsets.push_back(size);
+      size += Align(TensorBytes(spec)) + kTfLiteTensorPoolAlignment;
+    }
+    data_ = reinterpret_cast<uint8_t*>(
+        aligned_malloc(size, kTfLiteTensorPoolAlignment));
+    CHECK(data_) << "Failed to allocate " << size << " bytes of tensors.";
+
+    for (int i = 0; i < specs.size(); ++i) {
+      const TfLiteTensorSpec& spec = specs[i];
+      TfLiteTensor& tensor = tensors_[i];
+      tensor.type = spec.type;
+      tensor.dims = TfLiteIntArrayCreate(spec.dims.size());
+      for (int d = 0; d < spec.dims.size(); ++d) {
+        tensor.dims->data[d] = spec.dims[d];
+      }
+      tensor.params = spec.params;
+      tensor.data.raw = reinterpret_cast<char*>(data_ + offsets[i]);
+      tensor.bytes = TensorBytes(spec);
+    }
+  }
+
+  ~Buffer() {
+    for (TfLiteTensor& tensor : tensors_) TfLiteIntArrayFree(tensor.dims);
+    aligned_free(data_);
+  }
+
+  const std::vector<TfLiteTensorSpec>& specs() const { return specs_; }
+  std::vector<TfLiteTensor>* tensors() { return &tensors_; }
+
+ private:
+  const std::vector<TfLiteTensorSpec> specs_;
+  // Value-initialized, so that the fields not set above are zero.
+  std::vector<TfLiteTensor> tensors_;
+  uint8_t* data_ = nullptr;
+};
+
+class TfLiteTensorPool::SimplePool {
+ public:
+  std::unique_ptr<Buffer> Get(const std::vector<TfLiteTensorSpec>& specs) {
+    std::vector<std::unique_ptr<Buffer>> dropped;
+    {
+      absl::MutexLock lock(&mutex_);
+      ++in_use_count_;
+      if (specs != specs_) {
+        specs_ = specs;
+        dropped.swap(available_);
+      } else if (!available_.empty()) {
+        std::unique_ptr<Buffer> buffer = std::move(available_.back());
+        available_.pop_back();
+        return buffer;
+      }
+    }
+    // The dropped buffers are released without holding the lock.
+    return absl::make_unique<Buffer>(specs);
+  }
+
+  // Keeps |buffer| for reuse unless the specs have changed since it was
+  // handed out.
+  void Return(std::unique_ptr<Buffer> buffer) {
+    {
+      absl::MutexLock lock(&mutex_);
+      --in_use_count_;
+      if (buffer->specs() == specs_) available_.push_back(std::move(buffer));
+    }
+    // A dropped buffer is released without holding the lock.
+  }
+
+  std::pair<int, int> GetInUseAndAvailableCounts() {
+    absl::MutexLock lock(&mutex_);
+    return {in_use_count_, available_.size()};
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<TfLiteTensorSpec> specs_ ABSL_GUARDED_BY(mutex_);
+  int in_use_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::vector<std::unique_ptr<Buffer>> available_ ABSL_GUARDED_BY(mutex_);
+};
+
+TfLiteTensorPool::TfLiteTensorPool() : pool_(new SimplePool) {}
+
+TfLiteTensorPool::~TfLiteTensorPool() = default;
+
+std::shared_ptr<std::vector<TfLiteTensor>> TfLiteTensorPool::GetTensors(
+    const std::vector<TfLiteTensorSpec>& specs) {
+  Buffer* buffer = pool_->Get(specs).release();
+  // The deleter returns the buffer to the pool, or frees it if the pool is
+  // gone.
+  std::weak_ptr<SimplePool> weak_pool(pool_);
+  return std::shared_ptr<std::vector<TfLiteTensor>>(
+      buffer->tensors(), [weak_pool, buffer](std::vector<TfLiteTensor>*) {
+        std::unique_ptr<Buffer> owned_buffer(buffer);
+        auto pool = weak_pool.lock();
+        if (pool) pool->Return(std::move(owned_buffer));
+      });
+}
+
+std::pair<int, int> TfLiteTensorPool::GetInUseAndAvailableCounts() {
+  return pool_->GetInUseAndAvailableCounts();
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,94 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// This class lets CPU calculators send std::vector<TfLiteTensor> packets
+// whose tensors own their memory, instead of views into the arena of a
+// tflite::Interpreter that the next Invoke() or AllocateTensors() overwrites.
+//
+//   // In Process():
+//   std::shared_ptr<std::vector<TfLiteTensor>> tensors =
+//       tensor_pool_.GetTensors({{kTfLiteFloat32, {height, width, 3}}});
+//   // ... write (*tensors)[0].data.f ...
+//   cc->Outputs().Tag("TENSORS").AddPacket(
+//       PointToShared(std::move(tensors)).At(cc->InputTimestamp()));
+//
+// The tensors of a packet, their dimensions and their data live in one
+// buffer, which goes back to the pool when the last copy of the packet is
+// destroyed. A producer can therefore keep any number of packets in flight
+// without overwriting a tensor that a downstream calculator still reads, and
+// in the steady state the pool holds one buffer per packet in flight and
+// allocates nothing.
+//
+// The data of each tensor is aligned to kTfLiteTensorPoolAlignment bytes and
+// followed by as many bytes of padding, so that TfLiteInferenceCalculator can
+// bind it directly to the input of an interpreter: the XNNPACK delegate may
+// read a few bytes past the end of its inputs.
+
+#ifndef MEDIAPIPE_CALCULATORS_TFLITE_TFLITE_TENSOR_POOL_H_
+#define MEDIAPIPE_CALCULATORS_TFLITE_TFLITE_TENSOR_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/lite/interpreter.h"
+
+namespace mediapipe {
+
+constexpr size_t kTfLiteTensorPoolAlignment = 64;
+
+// The type and the shape of one pooled tensor.
+struct TfLiteTensorSpec {
+  TfLiteType type = kTfLiteFloat32;
+  std::vector<int> dims;
+  // Legacy quantization parameters, copied to the tensor.
+  TfLiteQuantizationParams params = {};
+};
+
+bool operator==(const TfLiteTensorSpec& lhs, const TfLiteTensorSpec& rhs);
+
+// Returns the spec of |tensor|, or false if its type has no fixed size, as
+// for string tensors.
+bool GetTfLiteTensorSpec(const TfLiteTensor& tensor, TfLiteTensorSpec* spec);
+
+class TfLiteTensorPool {
+ public:
+  TfLiteTensorPool();
+  ~TfLiteTensorPool();
+
+  // Returns tensors of the given specs, with uninitialized data. A buffer
+  // released by an earlier packet is reused if it has the same specs; the
+  // spare buffers of other specs are freed, since the tensors a calculator
+  // sends only change with its input size. The caller writes the tensor data,
+  // but must not change the tensors themselves.
+  std::shared_ptr<std::vector<TfLiteTensor>> GetTensors(
+      const std::vector<TfLiteTensorSpec>& specs);
+
+  // This method is meant for testing. Returns the number of buffers in
+  // packets, and the number kept for reuse.
+  std::pair<int, int> GetInUseAndAvailableCounts();
+
+ private:
+  class Buffer;
+  // The spare buffers. Packets refer to it weakly, so that the pool can be
+  // destroyed while they are alive.
+  class SimplePool;
+
+  std::shared_ptr<SimplePool> pool_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TFLITE_TFLITE_TENSOR_POOL_H_
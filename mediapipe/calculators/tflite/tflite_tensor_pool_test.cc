@@ -0,0 +1,111 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tflite/tflite_tensor_pool.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(TfLiteTensorPoolTest, TensorsMatchSpecs) {
+  TfLiteTensorPool pool;
+  TfLiteTensorSpec image_spec;
+  image_spec.dims = {5, 7, 3};
+  TfLiteTensorSpec quantized_spec;
+  quantized_spec.type = kTfLiteUInt8;
+  quantized_spec.dims = {10};
+  quantized_spec.params = {0.5f, 3};
+  auto tensors = pool.GetTensors({image_spec, quantized_spec});
+  ASSERT_EQ(2, tensors->size());
+
+  const TfLiteTensor& image = (*tensors)[0];
+  EXPECT_EQ(kTfLiteFloat32, image.type);
+  ASSERT_EQ(3, image.dims->size);
+  EXPECT_EQ(5, image.dims->data[0]);
+  EXPECT_EQ(7, image.dims->data[1]);
+  EXPECT_EQ(3, image.dims->data[2]);
+  EXPECT_EQ(5 * 7 * 3 * sizeof(float), image.bytes);
+
+  const TfLiteTensor& quantized = (*tensors)[1];
+  EXPECT_EQ(kTfLiteUInt8, quantized.type);
+  EXPECT_EQ(10, quantized.bytes);
+  EXPECT_EQ(0.5f, quantized.params.scale);
+  EXPECT_EQ(3, quantized.params.zero_point);
+
+  for (const TfLiteTensor& tensor : *tensors) {
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(tensor.data.raw) %
+                     kTfLiteTensorPoolAlignment);
+  }
+  // The padding after the first tensor keeps the two apart.
+  EXPECT_GE(quantized.data.raw - image.data.raw,
+            image.bytes + kTfLiteTensorPoolAlignment);
+
+  TfLiteTensorSpec spec;
+  ASSERT_TRUE(GetTfLiteTensorSpec(quantized, &spec));
+  EXPECT_TRUE(spec == quantized_spec);
+}
+
+TEST(TfLiteTensorPoolTest, ReusesBuffersReleasedByPackets) {
+  TfLiteTensorPool pool;
+  TfLiteTensorSpec spec;
+  spec.dims = {4, 4};
+  Packet packet = PointToShared(pool.GetTensors({spec}));
+  const char* data = packet.Get<std::vector<TfLiteTensor>>()[0].data.raw;
+  auto in_flight = pool.GetTensors({spec});
+  EXPECT_NE(data, (*in_flight)[0].data.raw);
+  EXPECT_EQ(std::make_pair(2, 0), pool.GetInUseAndAvailableCounts());
+
+  Packet copy = packet;
+  packet = Packet();
+  EXPECT_EQ(std::make_pair(2, 0), pool.GetInUseAndAvailableCounts());
+  copy = Packet();
+  EXPECT_EQ(std::make_pair(1, 1), pool.GetInUseAndAvailableCounts());
+  EXPECT_EQ(data, (*pool.GetTensors({spec}))[0].data.raw);
+}
+
+TEST(TfLiteTensorPoolTest, DropsBuffersOfOldSpecs) {
+  TfLiteTensorPool pool;
+  TfLiteTensorSpec small_spec;
+  small_spec.dims = {4};
+  TfLiteTensorSpec large_spec;
+  large_spec.dims = {8};
+  pool.GetTensors({small_spec}).reset();
+  EXPECT_EQ(std::make_pair(0, 1), pool.GetInUseAndAvailableCounts());
+  auto small = pool.GetTensors({small_spec});
+  auto large = pool.GetTensors({large_spec});
+  EXPECT_EQ(std::make_pair(2, 0), pool.GetInUseAndAvailableCounts());
+  small.reset();
+  EXPECT_EQ(std::make_pair(1, 0), pool.GetInUseAndAvailableCounts());
+}
+
+TEST(TfLiteTensorPoolTest, TensorsOutliveThePool) {
+  auto pool = absl::make_unique<TfLiteTensorPool>();
+  TfLiteTensorSpec spec;
+  spec.dims = {16};
+  auto tensors = pool->GetTensors({spec});
+  pool.reset();
+  (*tensors)[0].data.f[15] = 1.0f;
+  EXPECT_EQ(1.0f, (*tensors)[0].data.f[15]);
+}
+
+}  // namespace
+}  // namespace mediapipe
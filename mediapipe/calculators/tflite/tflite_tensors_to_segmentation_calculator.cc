@@ -22,6 +22,7 @@
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/image_frame_pool.h"
 #include "mediapipe/framework/port/opencv_imgcodecs_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
@@ -187,6 +188,7 @@ REGISTER_CALCULATOR(TfLiteTensorsToSegmentationCalculator);
   // Outputs.
   if (cc->Outputs().HasTag(kMaskTag)) {
     cc->Outputs().Tag(kMaskTag).Set<ImageFrame>();
+    cc->UseService(kImageFramePoolService).Optional();
   }
 #if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
   if (cc->Outputs().HasTag(kMaskGpuTag)) {
@@ -358,8 +360,8 @@ REGISTER_CALCULATOR(TfLiteTensorsToSegmentationCalculator);
              cv::Size(output_width, output_height));
 
   // Send out image as CPU packet.
-  std::unique_ptr<ImageFrame> output_mask = absl::make_unique<ImageFrame>(
-      ImageFormat::SRGBA, output_width, output_height);
+  std::unique_ptr<ImageFrame> output_mask =
+      GetImageFrame(cc, ImageFormat::SRGBA, output_width, output_height);
   cv::Mat output_mat = formats::MatView(output_mask.get());
   large_mask_mat.copyTo(output_mat);
   cc->Outputs().Tag(kMaskTag).Add(output_mask.release(), cc->InputTimestamp());
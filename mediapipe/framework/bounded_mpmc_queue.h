@@ -0,0 +1,134 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_BOUNDED_MPMC_QUEUE_H_
+#define MEDIAPIPE_FRAMEWORK_BOUNDED_MPMC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace mediapipe {
+namespace internal {
+
+// A fixed-capacity FIFO queue that any number of threads may push to and pop
+// from concurrently without taking a lock (D. Vyukov's bounded MPMC queue).
+//
+// Each cell carries a sequence number that tells pushers and poppers whether
+// it is free for the current lap. A push or pop claims a position with a
+// single compare-and-swap and then publishes the cell, so the queue does not
+// allocate after construction.
+//
+// Pop may report the queue as empty while an earlier Push has claimed a cell
+// but not yet published it; callers that know an item is on its way retry.
+template <typename T>
+class BoundedMpmcQueue {
+ public:
+  // The capacity is rounded up to a power of two, and to at least 2: with a
+  // single cell, a full queue and an empty one would look the same.
+  explicit BoundedMpmcQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size *= 2;
+    mask_ = size - 1;
+    cells_.reset(new Cell[size]);
+    for (size_t i = 0; i < size; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  BoundedMpmcQueue(const BoundedMpmcQueue&) = delete;
+  BoundedMpmcQueue& operator=(const BoundedMpmcQueue&) = delete;
+
+  ~BoundedMpmcQueue() {
+    const size_t end = push_pos_.load(std::memory_order_relaxed);
+    for (size_t pos = pop_pos_.load(std::memory_order_relaxed); pos != end;
+         ++pos) {
+      reinterpret_cast<T*>(&cells_[pos & mask_].storage)->~T();
+    }
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Appends |item|. Returns false if the queue is full.
+  template <typename U>
+  bool Push(U&& item) {
+    size_t pos = push_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (push_pos_.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = push_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    new (&cell->storage) T(std::forward<U>(item));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Moves the oldest item into |item|. Returns false if the queue is empty.
+  bool Pop(T* item) {
+    size_t pos = pop_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (pop_pos_.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = pop_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    T* stored = reinterpret_cast<T*>(&cell->storage);
+    *item = std::move(*stored);
+    stored->~T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_ = 0;
+  alignas(64) std::atomic<size_t> push_pos_{0};
+  alignas(64) std::atomic<size_t> pop_pos_{0};
+};
+
+}  // namespace internal
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_BOUNDED_MPMC_QUEUE_H_
@@ -0,0 +1,111 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/bounded_mpmc_queue.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace internal {
+namespace {
+
+TEST(BoundedMpmcQueueTest, IsFifoAndBounded) {
+  BoundedMpmcQueue<int> queue(3);
+  EXPECT_EQ(4, queue.capacity());
+  for (int i = 0; i < 4; ++i) EXPECT_TRUE(queue.Push(i));
+  EXPECT_FALSE(queue.Push(4));
+  int item = -1;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(queue.Pop(&item));
+    EXPECT_EQ(i, item);
+  }
+  EXPECT_FALSE(queue.Pop(&item));
+}
+
+TEST(BoundedMpmcQueueTest, HoldsAtLeastTwoItems) {
+  BoundedMpmcQueue<int> queue(1);
+  EXPECT_EQ(2, queue.capacity());
+  EXPECT_TRUE(queue.Push(0));
+  EXPECT_TRUE(queue.Push(1));
+  EXPECT_FALSE(queue.Push(2));
+  int item = -1;
+  ASSERT_TRUE(queue.Pop(&item));
+  EXPECT_EQ(0, item);
+}
+
+TEST(BoundedMpmcQueueTest, WrapsAround) {
+  BoundedMpmcQueue<int> queue(2);
+  int item = -1;
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(queue.Push(i));
+    ASSERT_TRUE(queue.Pop(&item));
+    EXPECT_EQ(i, item);
+  }
+}
+
+TEST(BoundedMpmcQueueTest, DestroysItemsLeft) {
+  auto shared = std::make_shared<std::string>("item");
+  {
+    BoundedMpmcQueue<std::shared_ptr<std::string>> queue(4);
+    queue.Push(shared);
+    queue.Push(shared);
+    EXPECT_EQ(3, shared.use_count());
+  }
+  EXPECT_EQ(1, shared.use_count());
+}
+
+// Several producers and consumers share a small queue; every item must be
+// popped exactly once.
+TEST(BoundedMpmcQueueTest, ConcurrentPushAndPop) {
+  constexpr int kNumThreads = 4;
+  constexpr int kItemsPerThread = 50000;
+  BoundedMpmcQueue<int> queue(8);
+  std::vector<std::atomic<int>> taken(kNumThreads * kItemsPerThread);
+  for (auto& count : taken) count = 0;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&queue, t] {
+      for (int i = 0; i < kItemsPerThread; ++i) {
+        while (!queue.Push(t * kItemsPerThread + i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+    threads.emplace_back([&queue, &taken] {
+      int item;
+      for (int i = 0; i < kItemsPerThread; ++i) {
+        while (!queue.Pop(&item)) {
+          std::this_thread::yield();
+        }
+        taken[item].fetch_add(1);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  for (int i = 0; i < kNumThreads * kItemsPerThread; ++i) {
+    ASSERT_EQ(1, taken[i].load()) << "item " << i;
+  }
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace mediapipe
@@ -81,6 +81,19 @@ class CalculatorContext {
                                      : input_timestamps_.front();
   }
 
+  // Returns the number of input sets left in the current invocation,
+  // including the current one.  This exceeds 1 only for calculators that
+  // batch input sets, see CalculatorContract::SetProcessBatchSize.  A
+  // calculator can accumulate work in Process and complete it when this
+  // returns 1.
+  int InputSetsRemaining() const {
+    int result = NumberOfTimestamps();
+    if (result > 0 && input_timestamps_.back() == Timestamp::Done()) {
+      --result;
+    }
+    return result;
+  }
+
   // Returns a reference to the input side packet set.
   const PacketSet& InputSidePackets() const;
   // Returns a reference to the output side packet collection.
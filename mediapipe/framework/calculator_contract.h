@@ -127,6 +127,18 @@ class CalculatorContract {
   void SetTimestampOffset(TimestampDiff offset) { timestamp_offset_ = offset; }
   TimestampDiff GetTimestampOffset() const { return timestamp_offset_; }
 
+  // Specifies the maximum number of ready input sets delivered to one
+  // scheduled invocation of this Node.  Process is still called once per
+  // input timestamp, but up to |batch_size| consecutive calls share a single
+  // trip through the scheduler, which helps cheap calculators on high-rate
+  // streams.  Unlike DefaultInputStreamHandlerOptions.batch_size, an
+  // incomplete batch is delivered as soon as no further input set is ready,
+  // so batching never delays a packet.  The batch size is ignored for source
+  // nodes, for max_in_flight greater than 1, and when the graph config
+  // specifies a batch size.
+  void SetProcessBatchSize(int batch_size) { process_batch_size_ = batch_size; }
+  int GetProcessBatchSize() const { return process_batch_size_; }
+
   class GraphServiceRequest {
    public:
     // APIs that should be used by calculators.
@@ -172,6 +184,7 @@ class CalculatorContract {
   std::map<std::string, GraphServiceRequest> service_requests_;
   bool process_timestamps_ = false;
   TimestampDiff timestamp_offset_ = TimestampDiff::Unset();
+  int process_batch_size_ = 1;
 };
 
 }  // namespace mediapipe
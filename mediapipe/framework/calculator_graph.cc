@@ -34,8 +34,10 @@
 #include "absl/synchronization/mutex.h"
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/calculator_base.h"
+#include "mediapipe/framework/calculator_profile.pb.h"
 #include "mediapipe/framework/counter_factory.h"
 #include "mediapipe/framework/delegating_executor.h"
+#include "mediapipe/framework/formats/image_frame_pool.h"
 #include "mediapipe/framework/input_stream_manager.h"
 #include "mediapipe/framework/mediapipe_profiling.h"
 #include "mediapipe/framework/packet_generator.h"
@@ -133,6 +135,8 @@ CalculatorGraph::~CalculatorGraph() {
   if (!status.ok()) {
     LOG(ERROR) << "During graph destruction: " << status;
   }
+  // The profiler may outlive the graph and its input streams.
+  profiler_->SetQueueStatsCallback(nullptr);
 }
 
 ::mediapipe::Status CalculatorGraph::InitializePacketGeneratorGraph(
@@ -228,6 +232,8 @@ CalculatorGraph::~CalculatorGraph() {
   // Check if the user has specified a maximum queue size for an input stream.
   max_queue_size_ = validated_graph_->Config().max_queue_size();
   max_queue_size_ = max_queue_size_ ? max_queue_size_ : 100;
+  max_queued_bytes_ = validated_graph_->Config().max_queued_bytes();
+  max_queued_bytes_ = max_queued_bytes_ ? max_queued_bytes_ : -1;
 
   // Use a local variable to avoid needing to lock errors_.
   std::vector<::mediapipe::Status> errors;
@@ -264,9 +270,47 @@ CalculatorGraph::~CalculatorGraph() {
 
 ::mediapipe::Status CalculatorGraph::InitializeProfiler() {
   profiler_->Initialize(*validated_graph_);
+  if (validated_graph_->Config().profiler_config().enable_queue_stats()) {
+    profiler_->SetQueueStatsCallback(
+        [this](int node_id, CalculatorProfile* profile) {
+          GetQueueStats(node_id, profile);
+        });
+  }
   return ::mediapipe::OkStatus();
 }
 
+void CalculatorGraph::GetQueueStats(int node_id,
+                                    CalculatorProfile* profile) const {
+  const QueueTotals& totals = (*nodes_)[node_id].InputQueueTotals();
+  profile->set_queued_packets(totals.Packets());
+  profile->set_peak_queued_packets(totals.PeakPackets());
+  profile->set_queued_bytes(totals.Bytes());
+  profile->set_peak_queued_bytes(totals.PeakBytes());
+
+  const NodeTypeInfo& node_type_info =
+      validated_graph_->CalculatorInfos()[node_id];
+  for (int i = 0; i < node_type_info.InputStreamTypes().NumEntries(); ++i) {
+    const InputStreamManager& stream =
+        input_stream_managers_[node_type_info.InputStreamBaseIndex() + i];
+    StreamProfile* stream_profile = nullptr;
+    for (StreamProfile& p : *profile->mutable_input_stream_profiles()) {
+      if (p.name() == stream.Name()) {
+        stream_profile = &p;
+        break;
+      }
+    }
+    if (!stream_profile) {
+      stream_profile = profile->add_input_stream_profiles();
+      stream_profile->set_name(stream.Name());
+      stream_profile->set_back_edge(stream.BackEdge());
+    }
+    stream_profile->set_queue_size(stream.QueueSize());
+    stream_profile->set_peak_queue_size(stream.PeakQueueSize());
+    stream_profile->set_queued_bytes(stream.QueuedBytes());
+    stream_profile->set_peak_queued_bytes(stream.PeakQueuedBytes());
+  }
+}
+
 ::mediapipe::Status CalculatorGraph::InitializeExecutors() {
   // If the ExecutorConfig for the default executor leaves the executor type
   // unspecified, default_executor_options points to the
@@ -608,6 +652,20 @@ CalculatorGraph::PrepareGpu(const std::map<std::string, Packet>& side_packets) {
   ASSIGN_OR_RETURN(additional_side_packets, PrepareGpu(extra_side_packets));
 #endif  // !defined(MEDIAPIPE_DISABLE_GPU)
 
+  // Provides an ImageFramePool to the calculators that request one, unless
+  // the application has set its own. The pool is kept across runs.
+  if (!ContainsKey(service_packets_, kImageFramePoolService.key)) {
+    for (const auto& node_info : validated_graph_->CalculatorInfos()) {
+      if (ContainsKey(node_info.Contract().ServiceRequests(),
+                      kImageFramePoolService.key)) {
+        service_packets_[kImageFramePoolService.key] =
+            MakePacket<std::shared_ptr<ImageFramePool>>(
+                std::make_shared<ImageFramePool>());
+        break;
+      }
+    }
+  }
+
   const std::map<std::string, Packet>* input_side_packets;
   if (!additional_side_packets.empty()) {
     additional_side_packets.insert(extra_side_packets.begin(),
@@ -716,6 +774,7 @@ CalculatorGraph::PrepareGpu(const std::map<std::string, Packet>& side_packets) {
   // streams.
   for (auto& node : *nodes_) {
     node.SetMaxInputStreamQueueSize(max_queue_size_);
+    node.SetMaxInputStreamQueuedBytes(max_queued_bytes_);
   }
 
   // Allow graph input streams to override the global max queue size.
@@ -1099,7 +1158,8 @@ void CalculatorGraph::UpdateThrottledNodes(InputStreamManager* stream,
 
 bool CalculatorGraph::IsNodeThrottled(int node_id) {
   absl::MutexLock lock(&full_input_streams_mutex_);
-  return max_queue_size_ != -1 && !full_input_streams_[node_id].empty();
+  return (max_queue_size_ != -1 || max_queued_bytes_ != -1) &&
+         !full_input_streams_[node_id].empty();
 }
 
 // Returns true if an input stream serves as a graph-output-stream.
@@ -1141,16 +1201,33 @@ bool CalculatorGraph::UnthrottleSources() {
       RecordError(::mediapipe::UnavailableError(absl::StrCat(
           "Detected a deadlock due to input throttling for: \"", stream->Name(),
           "\". All calculators are idle while packet sources remain active "
-          "and throttled.  Consider adjusting \"max_queue_size\" or "
-          "\"resolve_deadlock\".")));
+          "and throttled.  Consider adjusting \"max_queue_size\", "
+          "\"max_queued_bytes\" or \"resolve_deadlock\".")));
       continue;
     }
-    int new_size = stream->QueueSize() + 1;
-    stream->SetMaxQueueSize(new_size);
-    LOG_EVERY_N(WARNING, 100)
-        << "Resolved a deadlock by increasing max_queue_size of input stream: "
-        << stream->Name() << " to: " << new_size
-        << ". Consider increasing max_queue_size for better performance.";
+    // A stream can be full by its number of packets, by its bytes, or both.
+    int queue_size = stream->QueueSize();
+    int max_queue_size = stream->MaxQueueSize();
+    if (max_queue_size != -1 && queue_size >= max_queue_size) {
+      int new_size = queue_size + 1;
+      stream->SetMaxQueueSize(new_size);
+      LOG_EVERY_N(WARNING, 100)
+          << "Resolved a deadlock by increasing max_queue_size of input "
+             "stream: "
+          << stream->Name() << " to: " << new_size
+          << ". Consider increasing max_queue_size for better performance.";
+    }
+    int64 queued_bytes = stream->QueuedBytes();
+    int64 max_queued_bytes = stream->MaxQueuedBytes();
+    if (max_queued_bytes != -1 && queued_bytes >= max_queued_bytes) {
+      int64 new_bytes = queued_bytes + 1;
+      stream->SetMaxQueuedBytes(new_bytes);
+      LOG_EVERY_N(WARNING, 100)
+          << "Resolved a deadlock by increasing max_queued_bytes of input "
+             "stream: "
+          << stream->Name() << " to: " << new_bytes
+          << ". Consider increasing max_queued_bytes for better performance.";
+    }
   }
   return !full_streams.empty();
 }
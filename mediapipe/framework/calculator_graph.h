@@ -338,14 +338,15 @@ class CalculatorGraph {
   }
 
   // Returns true if this node or graph input stream is connected to
-  // any input stream whose queue has hit maximum capacity.
+  // any input stream whose queue has hit maximum capacity, in packets or in
+  // bytes.
   bool IsNodeThrottled(int node_id)
       ABSL_LOCKS_EXCLUDED(full_input_streams_mutex_);
 
   // If any active source node or graph input stream is throttled and not yet
-  // closed, increases the max_queue_size for each full input stream in the
-  // graph.
-  // Returns true if at least one max_queue_size has been grown.
+  // closed, increases the max_queue_size or max_queued_bytes for each full
+  // input stream in the graph.
+  // Returns true if at least one full input stream has been grown.
   bool UnthrottleSources() ABSL_LOCKS_EXCLUDED(full_input_streams_mutex_);
 
   // Returns the scheduler's runtime measures for overhead measurement.
@@ -481,6 +482,10 @@ class CalculatorGraph {
   ::mediapipe::Status InitializeProfiler();
   ::mediapipe::Status InitializeCalculatorNodes();
 
+  // Fills in the packets and bytes queued in the input streams of a node, for
+  // the profiler.
+  void GetQueueStats(int node_id, CalculatorProfile* profile) const;
+
   // Iterates through all nodes and schedules any that can be opened.
   void ScheduleAllOpenableNodes();
 
@@ -569,6 +574,10 @@ class CalculatorGraph {
   // restrict memory usage.
   int max_queue_size_ = -1;
 
+  // Maximum bytes queued in an input stream, or -1 if there is no limit.
+  // Enforced along with max_queue_size_.
+  int64 max_queued_bytes_ = -1;
+
   // Mode for adding packets to a graph input stream. Set to block until all
   // affected input streams are not full by default.
   GraphInputStreamAddMode graph_input_stream_add_mode_
@@ -21,6 +21,7 @@
 #include <deque>
 #include <map>
 #include <memory>
+#include <thread>  // NOLINT(build/c++11)
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -951,6 +952,31 @@ class SemaphoreCalculator : public CalculatorBase {
 };
 REGISTER_CALCULATOR(SemaphoreCalculator);
 
+// A SemaphoreCalculator that batches up to 3 input sets per invocation, and
+// outputs the number of input sets remaining in the invocation.
+class BatchingSemaphoreCalculator : public CalculatorBase {
+ public:
+  using Semaphore = AtomicSemaphore;
+
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).SetAny();
+    cc->Outputs().Index(0).Set<int>();
+    cc->InputSidePackets().Tag("POST_SEM").Set<Semaphore*>();
+    cc->InputSidePackets().Tag("WAIT_SEM").Set<Semaphore*>();
+    cc->SetProcessBatchSize(3);
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Process(CalculatorContext* cc) override {
+    cc->InputSidePackets().Tag("POST_SEM").Get<Semaphore*>()->Release(1);
+    cc->InputSidePackets().Tag("WAIT_SEM").Get<Semaphore*>()->Acquire(1);
+    cc->Outputs().Index(0).AddPacket(
+        MakePacket<int>(cc->InputSetsRemaining()).At(cc->InputTimestamp()));
+    return ::mediapipe::OkStatus();
+  }
+};
+REGISTER_CALCULATOR(BatchingSemaphoreCalculator);
+
 // A calculator that has no input streams and output streams, runs only once,
 // and takes 20 milliseconds to run.
 class OneShot20MsCalculator : public CalculatorBase {
@@ -3339,6 +3365,57 @@ TEST(CalculatorGraph, SetInputStreamMaxQueueSizeWorksSlowCalculator) {
   MP_ASSERT_OK(graph.WaitUntilDone());
 }
 
+// Verifies that a calculator with a process batch size receives the queued
+// input sets in batches, without waiting for a batch to fill up.
+TEST(CalculatorGraph, ProcessBatchSize) {
+  using Semaphore = BatchingSemaphoreCalculator::Semaphore;
+  CalculatorGraphConfig config =
+      ::mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: 'in'
+        node {
+          calculator: 'BatchingSemaphoreCalculator'
+          input_stream: 'in'
+          output_stream: 'out'
+          input_side_packet: 'POST_SEM:post_sem'
+          input_side_packet: 'WAIT_SEM:wait_sem'
+        }
+      )");
+  std::vector<Packet> out_packets;
+  tool::AddVectorSink("out", &config, &out_packets);
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  Semaphore calc_entered_process(0);
+  Semaphore calc_can_exit_process(0);
+  MP_ASSERT_OK(graph.StartRun({
+      {"post_sem", MakePacket<Semaphore*>(&calc_entered_process)},
+      {"wait_sem", MakePacket<Semaphore*>(&calc_can_exit_process)},
+  }));
+
+  // The first input set is delivered alone, because no other is ready.
+  MP_EXPECT_OK(
+      graph.AddPacketToInputStream("in", MakePacket<int>(1).At(Timestamp(1))));
+  calc_entered_process.Acquire(1);
+  // While the calculator is busy, queue up 5 more input sets, which are
+  // delivered as a full batch of 3 followed by a partial batch of 2.
+  for (int i = 2; i <= 6; ++i) {
+    MP_EXPECT_OK(graph.AddPacketToInputStream(
+        "in", MakePacket<int>(i).At(Timestamp(i))));
+  }
+  calc_can_exit_process.Release(6);
+  MP_ASSERT_OK(graph.WaitUntilIdle());
+
+  ASSERT_EQ(6, out_packets.size());
+  std::vector<int> remaining;
+  for (int i = 0; i < out_packets.size(); ++i) {
+    EXPECT_EQ(Timestamp(i + 1), out_packets[i].Timestamp());
+    remaining.push_back(out_packets[i].Get<int>());
+  }
+  EXPECT_THAT(remaining, testing::ElementsAre(1, 3, 2, 1, 2, 1));
+
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
 // Verify the scheduler unthrottles the graph input stream to avoid a deadlock,
 // and won't enter a busy loop.
 TEST(CalculatorGraph, AddPacketNoBusyLoop) {
@@ -3549,6 +3626,135 @@ TEST(CalculatorGraph, ObserveOutputStream) {
   }
 }
 
+// Several threads add packets to separate chains of nodes at once. The
+// scheduler queue is pushed to and popped from by all of them and by the
+// workers, and every chain must still deliver all of its packets in order.
+TEST(CalculatorGraph, SchedulerQueueKeepsOrderUnderContention) {
+  constexpr int kNumChains = 4;
+  constexpr int kNumPackets = 200;
+  CalculatorGraphConfig config;
+  config.set_num_threads(4);
+  for (int i = 0; i < kNumChains; ++i) {
+    config.add_input_stream(absl::StrCat("in_", i));
+    CalculatorGraphConfig::Node* node = config.add_node();
+    node->set_calculator("PassThroughCalculator");
+    node->add_input_stream(absl::StrCat("in_", i));
+    node->add_output_stream(absl::StrCat("mid_", i));
+    node = config.add_node();
+    node->set_calculator("PassThroughCalculator");
+    node->add_input_stream(absl::StrCat("mid_", i));
+    node->add_output_stream(absl::StrCat("out_", i));
+  }
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  std::vector<std::vector<Packet>> out_packets(kNumChains);
+  for (int i = 0; i < kNumChains; ++i) {
+    MP_ASSERT_OK(graph.ObserveOutputStream(
+        absl::StrCat("out_", i), [&out_packets, i](const Packet& packet) {
+          out_packets[i].push_back(packet);
+          return ::mediapipe::OkStatus();
+        }));
+  }
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  std::vector<std::thread> producers;
+  for (int i = 0; i < kNumChains; ++i) {
+    producers.emplace_back([&graph, i] {
+      const std::string stream = absl::StrCat("in_", i);
+      for (int j = 0; j < kNumPackets; ++j) {
+        MP_EXPECT_OK(graph.AddPacketToInputStream(
+            stream, MakePacket<int>(j).At(Timestamp(j))));
+      }
+      MP_EXPECT_OK(graph.CloseInputStream(stream));
+    });
+  }
+  for (auto& producer : producers) producer.join();
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  for (int i = 0; i < kNumChains; ++i) {
+    ASSERT_EQ(kNumPackets, out_packets[i].size()) << "chain " << i;
+    for (int j = 0; j < kNumPackets; ++j) {
+      EXPECT_EQ(j, out_packets[i][j].Get<int>());
+      EXPECT_EQ(Timestamp(j), out_packets[i][j].Timestamp());
+    }
+  }
+}
+
+// With a single worker, a node fed by a source must run before the source runs
+// again, because non-source nodes have priority over sources. Other threads
+// keep queueing non-source work meanwhile.
+TEST(CalculatorGraph, SchedulerQueueRunsNonSourcesFirstUnderContention) {
+  constexpr int kNumProducers = 4;
+  constexpr int kNumPackets = 200;
+  CalculatorGraphConfig config =
+      ::mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        num_threads: 1
+        node {
+          calculator: 'GlobalCountSourceCalculator'
+          input_side_packet: 'global_counter'
+          output_stream: 'count'
+        }
+        node {
+          calculator: 'mediapipe.nested_ns.ProcessCallbackCalculator'
+          input_stream: 'count'
+          output_stream: 'checked'
+          input_side_packet: 'callback'
+        }
+      )");
+  for (int i = 0; i < kNumProducers; ++i) {
+    config.add_input_stream(absl::StrCat("in_", i));
+    CalculatorGraphConfig::Node* node = config.add_node();
+    node->set_calculator("PassThroughCalculator");
+    node->add_input_stream(absl::StrCat("in_", i));
+    node->add_output_stream(absl::StrCat("out_", i));
+  }
+  std::atomic<int> global_counter(0);
+  // Only the single worker runs the callback.
+  std::vector<int> counts_seen;
+  nested_ns::ProcessFunction callback =
+      [&global_counter, &counts_seen](const InputStreamShardSet& inputs,
+                                      OutputStreamShardSet* outputs) {
+        const int count = inputs.Index(0).Get<int>();
+        EXPECT_EQ(count + 1, global_counter.load());
+        counts_seen.push_back(count);
+        return ::mediapipe::OkStatus();
+      };
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  std::atomic<int> num_out_packets(0);
+  for (int i = 0; i < kNumProducers; ++i) {
+    MP_ASSERT_OK(graph.ObserveOutputStream(
+        absl::StrCat("out_", i), [&num_out_packets](const Packet& packet) {
+          num_out_packets.fetch_add(1);
+          return ::mediapipe::OkStatus();
+        }));
+  }
+  MP_ASSERT_OK(graph.StartRun(
+      {{"global_counter", Adopt(new auto(&global_counter))},
+       {"callback", AdoptAsUniquePtr(new auto(callback))}}));
+
+  std::vector<std::thread> producers;
+  for (int i = 0; i < kNumProducers; ++i) {
+    producers.emplace_back([&graph, i] {
+      const std::string stream = absl::StrCat("in_", i);
+      for (int j = 0; j < kNumPackets; ++j) {
+        MP_EXPECT_OK(graph.AddPacketToInputStream(
+            stream, MakePacket<int>(j).At(Timestamp(j))));
+      }
+      MP_EXPECT_OK(graph.CloseInputStream(stream));
+    });
+  }
+  for (auto& producer : producers) producer.join();
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  std::vector<int> expected_counts;
+  for (int i = 0; i < GlobalCountSourceCalculator::kNumOutputPackets; ++i) {
+    expected_counts.push_back(i);
+  }
+  EXPECT_EQ(expected_counts, counts_seen);
+  EXPECT_EQ(kNumProducers * kNumPackets, num_out_packets.load());
+}
+
 class PassThroughSubgraph : public Subgraph {
  public:
   ::mediapipe::StatusOr<CalculatorGraphConfig> GetConfig(
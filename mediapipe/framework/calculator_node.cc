@@ -155,6 +155,9 @@ Timestamp CalculatorNode::SourceProcessOrder(
   }
   input_stream_handler_->SetProcessTimestampBounds(
       contract.GetProcessTimestampBounds());
+  MP_RETURN_IF_ERROR(
+      input_stream_handler_->SetMaxBatchSize(contract.GetProcessBatchSize()))
+      << "for node \"" << DebugName() << "\"";
 
   return InitializeInputStreams(input_stream_managers, output_stream_managers);
 }
@@ -325,6 +328,11 @@ void CalculatorNode::SetMaxInputStreamQueueSize(int max_queue_size) {
   input_stream_handler_->SetMaxQueueSize(max_queue_size);
 }
 
+void CalculatorNode::SetMaxInputStreamQueuedBytes(int64 max_queued_bytes) {
+  CHECK(input_stream_handler_);
+  input_stream_handler_->SetMaxQueuedBytes(max_queued_bytes);
+}
+
 ::mediapipe::Status CalculatorNode::PrepareForRun(
     const std::map<std::string, Packet>& all_side_packets,
     const std::map<std::string, Packet>& service_packets,
@@ -160,6 +160,9 @@ class CalculatorNode {
 
   int source_layer() const { return source_layer_; }
 
+  // The max number of invocations that can be scheduled in parallel.
+  int MaxInFlight() const { return max_in_flight_; }
+
   // Checks if the node can be scheduled; if so, increases current_in_flight_
   // and returns true; otherwise, returns false.
   // If true is returned, the scheduler must commit to executing the node, and
@@ -215,6 +218,15 @@ class CalculatorNode {
   // max_queue_size to trigger callbacks.
   void SetMaxInputStreamQueueSize(int max_queue_size);
 
+  // Sets each of this node's input streams to use the specified
+  // max_queued_bytes to trigger callbacks.
+  void SetMaxInputStreamQueuedBytes(int64 max_queued_bytes);
+
+  // Returns the packets and bytes queued in this node's input streams.
+  const QueueTotals& InputQueueTotals() const {
+    return input_stream_handler_->GetQueueTotals();
+  }
+
   // Closes the node's calculator and input and output streams.
   // graph_status is the current status of the graph run. graph_run_ended
   // indicates whether the graph run has ended.
@@ -0,0 +1,191 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/image_frame_pool.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <tuple>
+
+#include "mediapipe/framework/port/aligned_malloc_and_free.h"
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+// Keep this many buffers allocated for a given frame spec.
+static constexpr int kKeepCount = 2;
+// The maximum number of simple pools. When the limit is reached, the oldest
+// ImageFrameSpec will be dropped.
+static constexpr int kMaxPoolCount = 20;
+
+const GraphService<ImageFramePool> kImageFramePoolService(
+    "kImageFramePoolService");
+
+namespace {
+
+// This generates a "rol" instruction with both Clang and GCC.
+inline std::size_t RotateLeft(std::size_t x, int n) {
+  return (x << n) | (x >> (std::numeric_limits<size_t>::digits - n));
+}
+
+struct AlignedFree {
+  void operator()(uint8* data) const { aligned_free(data); }
+};
+
+}  // namespace
+
+std::size_t ImageFrameSpecHash::operator()(const ImageFrameSpec& spec) const {
+  // Width and height are expected to be smaller than half the width of
+  // size_t, and the format and the alignment to fit in a quarter.
+  constexpr int kWidth = std::numeric_limits<size_t>::digits;
+  return std::hash<std::size_t>{}(
+      spec.width ^ RotateLeft(spec.height, kWidth / 2) ^
+      RotateLeft(static_cast<uint32>(spec.format), kWidth / 4) ^
+      RotateLeft(spec.alignment_boundary, kWidth * 3 / 4));
+}
+
+class ImageFramePool::SimplePool
+    : public std::enable_shared_from_this<ImageFramePool::SimplePool> {
+ public:
+  SimplePool(const ImageFrameSpec& spec, int keep_count)
+      : spec_(spec), keep_count_(keep_count) {
+    // Computes the row stride the same way as ImageFrame::Reset.
+    width_step_ = spec.width * ImageFrame::NumberOfChannelsForFormat(
+                                   spec.format) *
+                  ImageFrame::ByteDepthForFormat(spec.format);
+    width_step_ =
+        ((width_step_ - 1) | (spec.alignment_boundary - 1)) + 1;
+  }
+
+  std::unique_ptr<ImageFrame> GetFrame() {
+    std::unique_ptr<uint8, AlignedFree> buffer;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (!available_.empty()) {
+        buffer = std::move(available_.back());
+        available_.pop_back();
+      }
+      ++in_use_count_;
+    }
+    if (!buffer) {
+      buffer.reset(reinterpret_cast<uint8*>(aligned_malloc(
+          spec_.height * width_step_, spec_.alignment_boundary)));
+    }
+
+    // The deleter adds the buffer back to our available list, or frees it
+    // if the pool is gone.
+    std::weak_ptr<SimplePool> weak_pool(shared_from_this());
+    return std::unique_ptr<ImageFrame>(new ImageFrame(
+        spec_.format, spec_.width, spec_.height, width_step_, buffer.release(),
+        [weak_pool](uint8* data) {
+          auto pool = weak_pool.lock();
+          if (pool) {
+            pool->Return(data);
+          } else {
+            aligned_free(data);
+          }
+        }));
+  }
+
+  std::pair<int, int> GetInUseAndAvailableCounts() {
+    absl::MutexLock lock(&mutex_);
+    return {in_use_count_, available_.size()};
+  }
+
+ private:
+  // Returns a buffer to the pool.
+  void Return(uint8* data) {
+    std::vector<std::unique_ptr<uint8, AlignedFree>> trimmed;
+    {
+      absl::MutexLock lock(&mutex_);
+      --in_use_count_;
+      available_.emplace_back(data);
+      TrimAvailable(&trimmed);
+    }
+    // The trimmed buffers will be released without holding the lock.
+  }
+
+  // If the total number of buffers is greater than keep_count_, frees any
+  // surplus buffers that are no longer in use.
+  void TrimAvailable(std::vector<std::unique_ptr<uint8, AlignedFree>>* trimmed)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    int keep = std::max(keep_count_ - in_use_count_, 0);
+    if (available_.size() > keep) {
+      auto trim_it = std::next(available_.begin(), keep);
+      std::move(trim_it, available_.end(), std::back_inserter(*trimmed));
+      available_.resize(keep);
+    }
+  }
+
+  const ImageFrameSpec spec_;
+  const int keep_count_;
+  int width_step_;
+
+  absl::Mutex mutex_;
+  int in_use_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::vector<std::unique_ptr<uint8, AlignedFree>> available_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+std::unique_ptr<ImageFrame> ImageFramePool::GetFrame(
+    ImageFormat::Format format, int width, int height,
+    uint32 alignment_boundary) {
+  CHECK_NE(ImageFormat::UNKNOWN, format);
+  CHECK_GT(alignment_boundary, 0);
+  CHECK_EQ(alignment_boundary & (alignment_boundary - 1), 0)
+      << "The alignment boundary must be a power of 2.";
+  std::shared_ptr<SimplePool> pool;
+  {
+    absl::MutexLock lock(&mutex_);
+    ImageFrameSpec key(format, width, height, alignment_boundary);
+    auto pool_it = pools_.find(key);
+    if (pool_it == pools_.end()) {
+      // Discard the least recently used pool in LRU cache.
+      if (pools_.size() >= kMaxPoolCount) {
+        auto old_spec = frame_specs_.front();  // Front has LRU.
+        frame_specs_.pop_front();
+        pools_.erase(old_spec);
+      }
+      frame_specs_.push_back(key);  // Push new spec to back.
+      std::tie(pool_it, std::ignore) =
+          pools_.emplace(key, std::make_shared<SimplePool>(key, kKeepCount));
+    } else {
+      // Find and move current 'key' spec to back, keeping others in same
+      // order.
+      auto specs_it = std::find(frame_specs_.begin(), frame_specs_.end(), key);
+      if (specs_it != frame_specs_.end()) frame_specs_.erase(specs_it);
+      frame_specs_.push_back(key);
+    }
+    pool = pool_it->second;
+  }
+  // Allocating a new buffer doesn't need to hold up other specs.
+  return pool->GetFrame();
+}
+
+std::pair<int, int> ImageFramePool::GetInUseAndAvailableCounts(
+    ImageFormat::Format format, int width, int height,
+    uint32 alignment_boundary) {
+  std::shared_ptr<SimplePool> pool;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto pool_it =
+        pools_.find(ImageFrameSpec(format, width, height, alignment_boundary));
+    if (pool_it == pools_.end()) return {0, 0};
+    pool = pool_it->second;
+  }
+  return pool->GetInUseAndAvailableCounts();
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,118 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This class lets CPU calculators allocate ImageFrames of various formats and
+// sizes, caching and reusing their pixel buffers. It is the CPU counterpart
+// of GpuBufferMultiPool and follows the same policy: one simple pool per
+// format and size, each keeping a few spare buffers, and at most
+// kMaxPoolCount simple pools, the least recently used being dropped.
+//
+// Calculators reach the pool through kImageFramePoolService:
+//
+//   // In GetContract():
+//   cc->UseService(kImageFramePoolService).Optional();
+//   // In Process():
+//   std::unique_ptr<ImageFrame> frame =
+//       GetImageFrame(cc, ImageFormat::SRGB, width, height);
+//
+// A frame's pixel buffer goes back to its pool when the frame is destroyed,
+// through its ImageFrame::Deleter. A reused buffer keeps the pixels it last
+// held.
+
+#ifndef MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_POOL_H_
+#define MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_POOL_H_
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/graph_service.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+struct ImageFrameSpec {
+  ImageFrameSpec(ImageFormat::Format f, int w, int h, uint32 a)
+      : format(f), width(w), height(h), alignment_boundary(a) {}
+  ImageFormat::Format format;
+  int width;
+  int height;
+  uint32 alignment_boundary;
+};
+
+inline bool operator==(const ImageFrameSpec& lhs, const ImageFrameSpec& rhs) {
+  return lhs.format == rhs.format && lhs.width == rhs.width &&
+         lhs.height == rhs.height &&
+         lhs.alignment_boundary == rhs.alignment_boundary;
+}
+
+struct ImageFrameSpecHash {
+  std::size_t operator()(const ImageFrameSpec& spec) const;
+};
+
+class ImageFramePool {
+ public:
+  ImageFramePool() {}
+
+  // Obtains a frame whose pixel buffer may either be reused or created anew.
+  std::unique_ptr<ImageFrame> GetFrame(
+      ImageFormat::Format format, int width, int height,
+      uint32 alignment_boundary = ImageFrame::kDefaultAlignmentBoundary);
+
+  // This method is meant for testing. Returns the number of buffers of the
+  // given kind that are in frames, and the number kept for reuse.
+  std::pair<int, int> GetInUseAndAvailableCounts(
+      ImageFormat::Format format, int width, int height,
+      uint32 alignment_boundary = ImageFrame::kDefaultAlignmentBoundary);
+
+ private:
+  // The buffers of one ImageFrameSpec. Frames refer to it weakly, so that it
+  // can be dropped while they are alive.
+  class SimplePool;
+
+  absl::Mutex mutex_;
+  std::unordered_map<ImageFrameSpec, std::shared_ptr<SimplePool>,
+                     ImageFrameSpecHash>
+      pools_ ABSL_GUARDED_BY(mutex_);
+  // A queue of ImageFrameSpecs to keep track of the age of each spec added to
+  // the pool.
+  std::deque<ImageFrameSpec> frame_specs_ ABSL_GUARDED_BY(mutex_);
+};
+
+extern const GraphService<ImageFramePool> kImageFramePoolService;
+
+// Returns a frame from the graph's ImageFramePool if the calculator has
+// requested kImageFramePoolService and the graph provides it, and a newly
+// allocated frame otherwise. CC is a CalculatorContext.
+template <typename CC>
+std::unique_ptr<ImageFrame> GetImageFrame(
+    CC* cc, ImageFormat::Format format, int width, int height,
+    uint32 alignment_boundary = ImageFrame::kDefaultAlignmentBoundary) {
+  auto service = cc->Service(kImageFramePoolService);
+  if (service.IsAvailable()) {
+    return service.GetObject().GetFrame(format, width, height,
+                                        alignment_boundary);
+  }
+  return std::unique_ptr<ImageFrame>(
+      new ImageFrame(format, width, height, alignment_boundary));
+}
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_POOL_H_
@@ -0,0 +1,100 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/image_frame_pool.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(ImageFramePoolTest, FramesMatchImageFrameLayout) {
+  ImageFramePool pool;
+  std::unique_ptr<ImageFrame> frame = pool.GetFrame(ImageFormat::SRGB, 33, 7);
+  ImageFrame expected(ImageFormat::SRGB, 33, 7);
+  EXPECT_EQ(ImageFormat::SRGB, frame->Format());
+  EXPECT_EQ(33, frame->Width());
+  EXPECT_EQ(7, frame->Height());
+  EXPECT_EQ(expected.WidthStep(), frame->WidthStep());
+  EXPECT_TRUE(frame->IsAligned(ImageFrame::kDefaultAlignmentBoundary));
+}
+
+TEST(ImageFramePoolTest, ReusesReturnedBuffers) {
+  ImageFramePool pool;
+  std::unique_ptr<ImageFrame> frame = pool.GetFrame(ImageFormat::SRGBA, 64, 32);
+  const uint8* pixel_data = frame->PixelData();
+  EXPECT_EQ(std::make_pair(1, 0),
+            pool.GetInUseAndAvailableCounts(ImageFormat::SRGBA, 64, 32));
+  frame.reset();
+  EXPECT_EQ(std::make_pair(0, 1),
+            pool.GetInUseAndAvailableCounts(ImageFormat::SRGBA, 64, 32));
+  frame = pool.GetFrame(ImageFormat::SRGBA, 64, 32);
+  EXPECT_EQ(pixel_data, frame->PixelData());
+}
+
+TEST(ImageFramePoolTest, KeysBuffersByFormatAndSize) {
+  ImageFramePool pool;
+  pool.GetFrame(ImageFormat::SRGB, 64, 32).reset();
+  std::unique_ptr<ImageFrame> gray = pool.GetFrame(ImageFormat::GRAY8, 64, 32);
+  std::unique_ptr<ImageFrame> wide = pool.GetFrame(ImageFormat::SRGB, 65, 32);
+  EXPECT_EQ(std::make_pair(0, 1),
+            pool.GetInUseAndAvailableCounts(ImageFormat::SRGB, 64, 32));
+  EXPECT_EQ(std::make_pair(1, 0),
+            pool.GetInUseAndAvailableCounts(ImageFormat::GRAY8, 64, 32));
+  EXPECT_EQ(std::make_pair(1, 0),
+            pool.GetInUseAndAvailableCounts(ImageFormat::SRGB, 65, 32));
+}
+
+TEST(ImageFramePoolTest, TrimsSurplusBuffers) {
+  ImageFramePool pool;
+  std::vector<std::unique_ptr<ImageFrame>> frames;
+  for (int i = 0; i < 5; ++i) {
+    frames.push_back(pool.GetFrame(ImageFormat::GRAY8, 16, 16));
+  }
+  frames.clear();
+  EXPECT_EQ(std::make_pair(0, 2),
+            pool.GetInUseAndAvailableCounts(ImageFormat::GRAY8, 16, 16));
+}
+
+TEST(ImageFramePoolTest, FramesOutliveTheirPool) {
+  auto pool = std::make_shared<ImageFramePool>();
+  std::unique_ptr<ImageFrame> frame = pool->GetFrame(ImageFormat::GRAY8, 4, 4);
+  pool.reset();
+  frame->SetToZero();
+  frame.reset();
+}
+
+TEST(ImageFramePoolTest, DropsLeastRecentlyUsedSpecs) {
+  ImageFramePool pool;
+  pool.GetFrame(ImageFormat::GRAY8, 1, 1).reset();
+  for (int width = 2; width <= 20; ++width) {
+    pool.GetFrame(ImageFormat::GRAY8, width, 1).reset();
+  }
+  // Touching the first spec keeps it when the next one is added.
+  pool.GetFrame(ImageFormat::GRAY8, 1, 1).reset();
+  pool.GetFrame(ImageFormat::GRAY8, 21, 1).reset();
+  EXPECT_EQ(std::make_pair(0, 1),
+            pool.GetInUseAndAvailableCounts(ImageFormat::GRAY8, 1, 1));
+  EXPECT_EQ(std::make_pair(0, 0),
+            pool.GetInUseAndAvailableCounts(ImageFormat::GRAY8, 2, 1));
+}
+
+}  // namespace
+}  // namespace mediapipe
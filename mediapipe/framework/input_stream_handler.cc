@@ -29,6 +29,7 @@ using SyncSet = InputStreamHandler::SyncSet;
   for (CollectionItemId id = input_stream_managers_.BeginId();
        id < input_stream_managers_.EndId(); ++id) {
     input_stream_managers_.Get(id) = &flat_input_stream_managers[id.value()];
+    input_stream_managers_.Get(id)->SetQueueTotals(&queue_totals_);
   }
   return ::mediapipe::OkStatus();
 }
@@ -80,6 +81,7 @@ void InputStreamHandler::PrepareForRun(
     }
     stream->PrepareForRun();
   }
+  queue_totals_.Reset();
   unset_header_count_.store(unset_header_count, std::memory_order_relaxed);
   prepared_context_for_close_ = false;
 }
@@ -128,6 +130,12 @@ void InputStreamHandler::SetMaxQueueSize(int max_queue_size) {
   }
 }
 
+void InputStreamHandler::SetMaxQueuedBytes(int64 max_queued_bytes) {
+  for (auto& stream : input_stream_managers_) {
+    stream->SetMaxQueuedBytes(max_queued_bytes);
+  }
+}
+
 std::string InputStreamHandler::DebugStreamNames() const {
   std::vector<absl::string_view> stream_names;
   for (const auto& stream : input_stream_managers_) {
@@ -170,6 +178,13 @@ bool InputStreamHandler::ScheduleInvocations(int max_allowance,
         *input_bound =
             calculator_context_manager_->GetDefaultCalculatorContext()
                 ->InputTimestamp();
+        if (flush_partial_batch_) {
+          // No further input set is ready, so deliver the incomplete batch
+          // rather than waiting for it to fill up.
+          schedule_callback_(
+              calculator_context_manager_->GetDefaultCalculatorContext());
+          ++invocations_scheduled;
+        }
       } else {
         *input_bound = min_stream_timestamp;
       }
@@ -257,7 +272,7 @@ void LogQueuedPackets(CalculatorContext* context, InputStreamManager* stream,
 }
 
 void InputStreamHandler::AddPackets(CollectionItemId id,
-                                    const std::list<Packet>& packets) {
+                                    const PacketQueue& packets) {
   LogQueuedPackets(GetCalculatorContext(calculator_context_manager_),
                    input_stream_managers_.Get(id), packets.back());
   bool notify = false;
@@ -272,7 +287,7 @@ void InputStreamHandler::AddPackets(CollectionItemId id,
 }
 
 void InputStreamHandler::MovePackets(CollectionItemId id,
-                                     std::list<Packet>* packets) {
+                                     PacketQueue* packets) {
   LogQueuedPackets(GetCalculatorContext(calculator_context_manager_),
                    input_stream_managers_.Get(id), packets->back());
   bool notify = false;
@@ -326,6 +341,18 @@ void InputStreamHandler::SetBatchSize(int batch_size) {
   batch_size_ = batch_size;
 }
 
+::mediapipe::Status InputStreamHandler::SetMaxBatchSize(int max_batch_size) {
+  RET_CHECK_GE(max_batch_size, 1)
+      << "Batch size has to be greater than or equal to 1.";
+  if (max_batch_size == 1 || batch_size_ > 1 || calculator_run_in_parallel_ ||
+      late_preparation_ || NumInputStreams() == 0) {
+    return ::mediapipe::OkStatus();
+  }
+  batch_size_ = max_batch_size;
+  flush_partial_batch_ = true;
+  return ::mediapipe::OkStatus();
+}
+
 void InputStreamHandler::SetLatePreparation(bool late_preparation) {
   CHECK(batch_size_ == 1 || !late_preparation_)
       << "Batching cannot be combined with late preparation.";
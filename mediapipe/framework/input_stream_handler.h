@@ -17,7 +17,6 @@
 
 #include <atomic>
 #include <functional>
-#include <list>
 #include <memory>
 #include <string>
 #include <utility>
@@ -33,6 +32,7 @@
 #include "mediapipe/framework/input_stream_shard.h"
 #include "mediapipe/framework/mediapipe_options.pb.h"
 #include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/packet_queue.h"
 #include "mediapipe/framework/packet_set.h"
 #include "mediapipe/framework/packet_type.h"
 #include "mediapipe/framework/port/status.h"
@@ -127,16 +127,21 @@ class InputStreamHandler {
   // Sets max queue size of a particular stream.
   void SetMaxQueueSize(CollectionItemId id, int max_queue_size);
 
+  // Sets max queued bytes of every stream.
+  void SetMaxQueuedBytes(int64 max_queued_bytes);
+
+  // Returns the packets and bytes queued in all the input streams.
+  const QueueTotals& GetQueueTotals() const { return queue_totals_; }
+
   void SetQueueSizeCallbacks(
       InputStreamManager::QueueSizeCallback becomes_full_callback,
       InputStreamManager::QueueSizeCallback becomes_not_full_callback);
 
   // Add packets into a particular stream.
-  virtual void AddPackets(CollectionItemId id,
-                          const std::list<Packet>& packets);
+  virtual void AddPackets(CollectionItemId id, const PacketQueue& packets);
 
   // Moves packets into a particular stream.
-  virtual void MovePackets(CollectionItemId id, std::list<Packet>* packets);
+  virtual void MovePackets(CollectionItemId id, PacketQueue* packets);
 
   // Sets next timestamp bound in a particular stream.
   void SetNextTimestampBound(CollectionItemId id, Timestamp bound);
@@ -185,6 +190,13 @@ class InputStreamHandler {
   // When true, Calculator::Process is called for every input timestamp bound.
   bool ProcessTimestampBounds() { return process_timestamps_; }
 
+  // Allows up to |max_batch_size| ready input sets to be delivered to one
+  // scheduled invocation.  An incomplete batch is scheduled as soon as the
+  // node is not ready for another input set.  Has no effect for source nodes,
+  // parallel execution, late preparation, or if the subclass has already
+  // enabled batching with SetBatchSize.
+  ::mediapipe::Status SetMaxBatchSize(int max_batch_size);
+
   // A helper class to build input packet sets for a certain set of streams.
   //
   // ReadyForProcess requires all of the streams to be fully determined
@@ -298,6 +310,9 @@ class InputStreamHandler {
   // CalculatorNode is scheduled.
   int batch_size_ = 1;
 
+  // When true, an incomplete batch is scheduled once the node is not ready.
+  bool flush_partial_batch_ = false;
+
   // When true, any increase in timestamp bound invokes Calculator::Process.
   bool process_timestamps_ = false;
 
@@ -306,6 +321,9 @@ class InputStreamHandler {
   std::function<void()> headers_ready_callback_;
 
   std::atomic<int> unset_header_count_{0};
+
+  // The packets and bytes queued in input_stream_managers_.
+  QueueTotals queue_totals_;
 };
 
 using InputStreamHandlerRegistry = GlobalFactoryRegistry<
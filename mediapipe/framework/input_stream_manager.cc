@@ -14,6 +14,7 @@
 
 #include "mediapipe/framework/input_stream_manager.h"
 
+#include <algorithm>
 #include <type_traits>
 #include <utility>
 
@@ -27,6 +28,17 @@
 
 namespace mediapipe {
 
+namespace {
+
+// Returns the estimated bytes held by the payload of a packet.
+int64 SizeHint(const Packet& packet) {
+  const packet_internal::HolderBase* holder =
+      packet_internal::GetHolder(packet);
+  return holder ? holder->GetSizeHint() : 0;
+}
+
+}  // namespace
+
 ::mediapipe::Status InputStreamManager::Initialize(
     const std::string& name, const PacketType* packet_type, bool back_edge) {
   name_ = name;
@@ -45,9 +57,19 @@ void InputStreamManager::SetQueueSizeCallbacks(
   becomes_not_full_callback_ = becomes_not_full_callback;
 }
 
+void InputStreamManager::SetQueueTotals(QueueTotals* totals) {
+  queue_totals_ = totals;
+}
+
 void InputStreamManager::PrepareForRun() {
   absl::MutexLock stream_lock(&stream_mutex_);
+  if (queue_totals_) {
+    queue_totals_->Add(-static_cast<int64>(queue_.size()), -queued_bytes_);
+  }
   queue_.clear();
+  queued_bytes_ = 0;
+  peak_queue_size_ = 0;
+  peak_queued_bytes_ = 0;
   last_reported_stream_full_ = false;
   num_packets_added_ = 0;
   next_timestamp_bound_ = Timestamp::PreStream();
@@ -80,13 +102,13 @@ Packet InputStreamManager::QueueHead() const {
 }
 
 ::mediapipe::Status InputStreamManager::AddPackets(
-    const std::list<Packet>& container, bool* notify) {
-  return AddOrMovePacketsInternal<const std::list<Packet>&>(container, notify);
+    const PacketQueue& container, bool* notify) {
+  return AddOrMovePacketsInternal<const PacketQueue&>(container, notify);
 }
 
 ::mediapipe::Status InputStreamManager::MovePackets(
-    std::list<Packet>* container, bool* notify) {
-  return AddOrMovePacketsInternal<std::list<Packet>&>(*container, notify);
+    PacketQueue* container, bool* notify) {
+  return AddOrMovePacketsInternal<PacketQueue&>(*container, notify);
 }
 
 template <typename Container>
@@ -102,8 +124,7 @@ template <typename Container>
       return ::mediapipe::OkStatus();
     }
     // Check if the queue was full before packets came in.
-    bool was_queue_full =
-        (max_queue_size_ != -1 && queue_.size() >= max_queue_size_);
+    bool was_queue_full = IsFullLocked();
     // Check if the queue becomes non-empty.
     queue_became_non_empty = queue_.empty() && !container.empty();
     for (auto& packet : container) {
@@ -160,9 +181,9 @@ template <typename Container>
       } else {
         queue_.emplace_back(std::move(packet));
       }
+      CountPushed(1, SizeHint(queue_.back()));
     }
-    queue_became_full = (!was_queue_full && max_queue_size_ != -1 &&
-                         queue_.size() >= max_queue_size_);
+    queue_became_full = !was_queue_full && IsFullLocked();
     VLOG_IF(3, queue_.size() > 1)
         << "Queue size greater than 1: stream name: " << name_
         << " queue_size: " << queue_.size();
@@ -265,15 +286,19 @@ Packet InputStreamManager::PopPacketAtTimestamp(Timestamp timestamp,
     Timestamp current_timestamp = Timestamp::Unset();
 
     // Checks if queue is full.
-    bool was_queue_full =
-        (max_queue_size_ != -1 && queue_.size() >= max_queue_size_);
+    bool was_queue_full = IsFullLocked();
 
+    int packets_popped = 0;
+    int64 bytes_popped = 0;
     while (!queue_.empty() && queue_.front().Timestamp() <= timestamp) {
       packet = std::move(queue_.front());
       queue_.pop_front();
       current_timestamp = packet.Timestamp();
       ++(*num_packets_dropped);
+      ++packets_popped;
+      bytes_popped += SizeHint(packet);
     }
+    CountPopped(packets_popped, bytes_popped);
     // Clear value_ if it doesn't have exactly the right timestamp.
     if (current_timestamp != timestamp) {
       // The timestamp bound reported when no packet is sent.
@@ -284,7 +309,7 @@ Packet InputStreamManager::PopPacketAtTimestamp(Timestamp timestamp,
 
     VLOG(3) << "Input stream removed packets:" << name_
             << " Size:" << queue_.size();
-    queue_became_non_full = (was_queue_full && queue_.size() < max_queue_size_);
+    queue_became_non_full = was_queue_full && !IsFullLocked();
     *stream_is_done = IsDone();
   }
   if (queue_became_non_full) {
@@ -305,19 +330,19 @@ Packet InputStreamManager::PopQueueHead(bool* stream_is_done) {
     VLOG(3) << "Input stream " << name_ << " selecting at queue head";
 
     // Check if queue is full.
-    bool was_queue_full =
-        (max_queue_size_ != -1 && queue_.size() >= max_queue_size_);
+    bool was_queue_full = IsFullLocked();
 
     if (!queue_.empty()) {
       packet = std::move(queue_.front());
       queue_.pop_front();
+      CountPopped(1, SizeHint(packet));
     } else {
       packet = Packet();
     }
 
     VLOG(3) << "Input stream removed a packet:" << name_
             << " Size:" << queue_.size();
-    queue_became_non_full = (was_queue_full && queue_.size() < max_queue_size_);
+    queue_became_non_full = was_queue_full && !IsFullLocked();
     *stream_is_done = IsDone();
   }
   if (queue_became_non_full) {
@@ -342,9 +367,39 @@ void InputStreamManager::SetMaxQueueSize(int max_queue_size) {
   bool is_full;
   {
     absl::MutexLock lock(&stream_mutex_);
-    was_full = (max_queue_size_ != -1 && queue_.size() >= max_queue_size_);
+    was_full = IsFullLocked();
     max_queue_size_ = max_queue_size;
-    is_full = (max_queue_size_ != -1 && queue_.size() >= max_queue_size_);
+    is_full = IsFullLocked();
+  }
+
+  // QueueSizeCallback is called with no mutexes held.
+  if (!was_full && is_full) {
+    VLOG(3) << "Queue became full: " << Name();
+    becomes_full_callback_(this, &last_reported_stream_full_);
+  } else if (was_full && !is_full) {
+    VLOG(3) << "Queue became non-full: " << Name();
+    becomes_not_full_callback_(this, &last_reported_stream_full_);
+  }
+}
+
+int64 InputStreamManager::QueuedBytes() const {
+  absl::MutexLock lock(&stream_mutex_);
+  return queued_bytes_;
+}
+
+int64 InputStreamManager::MaxQueuedBytes() const {
+  absl::MutexLock lock(&stream_mutex_);
+  return max_queued_bytes_;
+}
+
+void InputStreamManager::SetMaxQueuedBytes(int64 max_queued_bytes) {
+  bool was_full;
+  bool is_full;
+  {
+    absl::MutexLock lock(&stream_mutex_);
+    was_full = IsFullLocked();
+    max_queued_bytes_ = max_queued_bytes;
+    is_full = IsFullLocked();
   }
 
   // QueueSizeCallback is called with no mutexes held.
@@ -357,9 +412,46 @@ void InputStreamManager::SetMaxQueueSize(int max_queue_size) {
   }
 }
 
+int InputStreamManager::PeakQueueSize() const {
+  absl::MutexLock lock(&stream_mutex_);
+  return peak_queue_size_;
+}
+
+int64 InputStreamManager::PeakQueuedBytes() const {
+  absl::MutexLock lock(&stream_mutex_);
+  return peak_queued_bytes_;
+}
+
 bool InputStreamManager::IsFull() const {
   absl::MutexLock lock(&stream_mutex_);
-  return max_queue_size_ != -1 && queue_.size() >= max_queue_size_;
+  return IsFullLocked();
+}
+
+bool InputStreamManager::IsFullLocked() const {
+  return (max_queue_size_ != -1 && queue_.size() >= max_queue_size_) ||
+         (max_queued_bytes_ != -1 && !queue_.empty() &&
+          queued_bytes_ >= max_queued_bytes_);
+}
+
+void InputStreamManager::CountPushed(int packets, int64 bytes) {
+  queued_bytes_ += bytes;
+  peak_queue_size_ =
+      std::max(peak_queue_size_, static_cast<int>(queue_.size()));
+  peak_queued_bytes_ = std::max(peak_queued_bytes_, queued_bytes_);
+  if (queue_totals_) {
+    queue_totals_->Add(packets, bytes);
+  }
+}
+
+void InputStreamManager::CountPopped(int packets, int64 bytes) {
+  // Size hints are estimates, and an empty queue holds no bytes.
+  if (queue_.empty() || bytes > queued_bytes_) {
+    bytes = queued_bytes_;
+  }
+  queued_bytes_ -= bytes;
+  if (queue_totals_) {
+    queue_totals_->Add(-packets, -bytes);
+  }
 }
 
 Timestamp InputStreamManager::GetMinTimestampAmongNLatest(int n) const {
@@ -375,16 +467,20 @@ void InputStreamManager::ErasePacketsEarlierThan(Timestamp timestamp) {
   {
     absl::MutexLock lock(&stream_mutex_);
     // Checks if queue is full.
-    bool was_queue_full =
-        (max_queue_size_ != -1 && queue_.size() >= max_queue_size_);
+    bool was_queue_full = IsFullLocked();
 
+    int packets_popped = 0;
+    int64 bytes_popped = 0;
     while (!queue_.empty() && queue_.front().Timestamp() < timestamp) {
+      ++packets_popped;
+      bytes_popped += SizeHint(queue_.front());
       queue_.pop_front();
     }
+    CountPopped(packets_popped, bytes_popped);
 
     VLOG(3) << "Input stream removed packets:" << name_
             << " Size:" << queue_.size();
-    queue_became_non_full = (was_queue_full && queue_.size() < max_queue_size_);
+    queue_became_non_full = was_queue_full && !IsFullLocked();
   }
   if (queue_became_non_full) {
     VLOG(3) << "Queue became non-full: " << Name();
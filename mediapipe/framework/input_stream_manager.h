@@ -15,14 +15,14 @@
 #ifndef MEDIAPIPE_FRAMEWORK_INPUT_STREAM_MANAGER_H_
 #define MEDIAPIPE_FRAMEWORK_INPUT_STREAM_MANAGER_H_
 
-#include <deque>
+#include <atomic>
 #include <functional>
-#include <list>
 #include <string>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/synchronization/mutex.h"
 #include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/packet_queue.h"
 #include "mediapipe/framework/packet_type.h"
 #include "mediapipe/framework/port.h"
 #include "mediapipe/framework/port/integral_types.h"
@@ -31,6 +31,56 @@
 
 namespace mediapipe {
 
+// Counts the packets and the bytes queued in a group of input streams, such
+// as the input streams of one node, with their high-water marks since the
+// last Reset(). The bytes are estimated by HolderBase::GetSizeHint().
+class QueueTotals {
+ public:
+  QueueTotals() = default;
+  QueueTotals(const QueueTotals&) = delete;
+  QueueTotals& operator=(const QueueTotals&) = delete;
+
+  // Adds the given numbers of packets and bytes, which are negative when
+  // packets leave a queue.
+  void Add(int64 packets, int64 bytes) {
+    UpdatePeak(packets_.fetch_add(packets, std::memory_order_relaxed) + packets,
+               &peak_packets_);
+    UpdatePeak(bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes,
+               &peak_bytes_);
+  }
+
+  // Clears the counts and the high-water marks.
+  void Reset() {
+    packets_ = 0;
+    bytes_ = 0;
+    peak_packets_ = 0;
+    peak_bytes_ = 0;
+  }
+
+  int64 Packets() const { return packets_.load(std::memory_order_relaxed); }
+  int64 Bytes() const { return bytes_.load(std::memory_order_relaxed); }
+  int64 PeakPackets() const {
+    return peak_packets_.load(std::memory_order_relaxed);
+  }
+  int64 PeakBytes() const {
+    return peak_bytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static void UpdatePeak(int64 value, std::atomic<int64>* peak) {
+    int64 peak_value = peak->load(std::memory_order_relaxed);
+    while (value > peak_value &&
+           !peak->compare_exchange_weak(peak_value, value,
+                                        std::memory_order_relaxed)) {
+    }
+  }
+
+  std::atomic<int64> packets_{0};
+  std::atomic<int64> bytes_{0};
+  std::atomic<int64> peak_packets_{0};
+  std::atomic<int64> peak_bytes_{0};
+};
+
 // An OutputStreamManager will add packets to InputStreamManager through
 // InputStreamHandler as they are output.  A CalculatorNode prepares the input
 // packets for a particular invocation by calling InputStreamManager's
@@ -87,13 +137,12 @@ class InputStreamManager {
   //   Timestamp::PostStream(), the packet must be the only packet in the
   //   stream.
   // Violation of any of these conditions causes an error status.
-  ::mediapipe::Status AddPackets(const std::list<Packet>& container,
-                                 bool* notify);
+  ::mediapipe::Status AddPackets(const PacketQueue& container, bool* notify);
 
   // Move a list of timestamped packets. Sets "notify" to true if the queue
   // becomes non-empty. Does nothing if the input stream is closed. After the
   // move, all packets in the container must be empty.
-  ::mediapipe::Status MovePackets(std::list<Packet>* container, bool* notify);
+  ::mediapipe::Status MovePackets(PacketQueue* container, bool* notify);
 
   // Closes the input stream.  This function can be called multiple times.
   void Close() ABSL_LOCKS_EXCLUDED(stream_mutex_);
@@ -144,7 +193,8 @@ class InputStreamManager {
   // Returns the number of packets in the queue.
   int QueueSize() const ABSL_LOCKS_EXCLUDED(stream_mutex_);
 
-  // Returns true iff the queue is full.
+  // Returns true iff the queue is full, either by MaxQueueSize() or by
+  // MaxQueuedBytes().
   bool IsFull() const ABSL_LOCKS_EXCLUDED(stream_mutex_);
 
   // Returns the max queue size. -1 indicates that there is no maximum.
@@ -155,6 +205,28 @@ class InputStreamManager {
   // of -1 means that there is no maximum queue size.
   void SetMaxQueueSize(int max_queue_size) ABSL_LOCKS_EXCLUDED(stream_mutex_);
 
+  // Returns the estimated number of bytes held by the packets in the queue.
+  int64 QueuedBytes() const ABSL_LOCKS_EXCLUDED(stream_mutex_);
+
+  // Returns the max queued bytes. -1 indicates that there is no maximum.
+  int64 MaxQueuedBytes() const ABSL_LOCKS_EXCLUDED(stream_mutex_);
+
+  // Sets a soft limit on the bytes held by the packets in the queue. A
+  // non-empty queue holding at least max_queued_bytes is full, in the same
+  // way as a queue holding max_queue_size packets. A value of -1 means that
+  // there is no limit.
+  void SetMaxQueuedBytes(int64 max_queued_bytes)
+      ABSL_LOCKS_EXCLUDED(stream_mutex_);
+
+  // Returns the high-water marks of QueueSize() and QueuedBytes() since
+  // PrepareForRun().
+  int PeakQueueSize() const ABSL_LOCKS_EXCLUDED(stream_mutex_);
+  int64 PeakQueuedBytes() const ABSL_LOCKS_EXCLUDED(stream_mutex_);
+
+  // Adds the packets and bytes entering and leaving the queue to |totals|,
+  // which must outlive the InputStreamManager.
+  void SetQueueTotals(QueueTotals* totals);
+
   // If there are equal to or more than n packets in the queue, this function
   // returns the min timestamp of among the latest n packets of the queue.  If
   // there are fewer than n packets in the queue, this function returns
@@ -189,11 +261,21 @@ class InputStreamManager {
   // Returns true if the next timestamp bound reaches Timestamp::Done().
   bool IsDone() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(stream_mutex_);
 
+  // Returns true if the queue is full. See IsFull().
+  bool IsFullLocked() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(stream_mutex_);
+
+  // Accounts for packets entering and leaving the queue. CountPopped() must
+  // be called after the packets have been popped.
+  void CountPushed(int packets, int64 bytes)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(stream_mutex_);
+  void CountPopped(int packets, int64 bytes)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(stream_mutex_);
+
   // Returns the smallest timestamp at which this stream might see an input.
   Timestamp MinTimestampOrBoundHelper() const;
 
   mutable absl::Mutex stream_mutex_;
-  std::deque<Packet> queue_ ABSL_GUARDED_BY(stream_mutex_);
+  PacketQueue queue_ ABSL_GUARDED_BY(stream_mutex_);
   // The number of packets added to queue_.  Used to verify a packet at
   // Timestamp::PostStream() is the only Packet in the stream.
   int64 num_packets_added_ ABSL_GUARDED_BY(stream_mutex_);
@@ -213,6 +295,18 @@ class InputStreamManager {
   // The maximum queue size for this stream if set.
   int max_queue_size_ ABSL_GUARDED_BY(stream_mutex_) = -1;
 
+  // The estimated bytes held by the packets in queue_, and the limit on them
+  // if set.
+  int64 queued_bytes_ ABSL_GUARDED_BY(stream_mutex_) = 0;
+  int64 max_queued_bytes_ ABSL_GUARDED_BY(stream_mutex_) = -1;
+
+  // The high-water marks of queue_.size() and queued_bytes_.
+  int peak_queue_size_ ABSL_GUARDED_BY(stream_mutex_) = 0;
+  int64 peak_queued_bytes_ ABSL_GUARDED_BY(stream_mutex_) = 0;
+
+  // The totals of the streams this stream belongs to, if any.
+  QueueTotals* queue_totals_ = nullptr;
+
   // Callback to notify the framework that we have hit the maximum queue size.
   QueueSizeCallback becomes_full_callback_;
 
@@ -92,7 +92,7 @@ class InputStreamManagerTest : public ::testing::Test {
 TEST_F(InputStreamManagerTest, Init) {}
 
 TEST_F(InputStreamManagerTest, AddPackets) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   packets.push_back(MakePacket<std::string>("packet 3").At(Timestamp(30)));
@@ -109,7 +109,7 @@ TEST_F(InputStreamManagerTest, AddPackets) {
 }
 
 TEST_F(InputStreamManagerTest, MovePackets) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   packets.push_back(MakePacket<std::string>("packet 3").At(Timestamp(30)));
@@ -129,7 +129,7 @@ TEST_F(InputStreamManagerTest, MovePackets) {
 // a stream: Timestamp::Unset(), Timestamp::Unstarted(),
 // Timestamp::OneOverPostStream(), and Timestamp::Done().
 TEST_F(InputStreamManagerTest, AddPacketUnset) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp::Unset()));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
 
@@ -140,7 +140,7 @@ TEST_F(InputStreamManagerTest, AddPacketUnset) {
 }
 
 TEST_F(InputStreamManagerTest, AddPacketUnstarted) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(
       MakePacket<std::string>("packet 1").At(Timestamp::Unstarted()));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -152,7 +152,7 @@ TEST_F(InputStreamManagerTest, AddPacketUnstarted) {
 }
 
 TEST_F(InputStreamManagerTest, AddPacketOneOverPostStream) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(
       MakePacket<std::string>("packet 1").At(Timestamp::OneOverPostStream()));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -165,7 +165,7 @@ TEST_F(InputStreamManagerTest, AddPacketOneOverPostStream) {
 }
 
 TEST_F(InputStreamManagerTest, AddPacketDone) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp::Done()));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
 
@@ -176,7 +176,7 @@ TEST_F(InputStreamManagerTest, AddPacketDone) {
 }
 
 TEST_F(InputStreamManagerTest, AddPacketsOnlyPreStream) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(
       MakePacket<std::string>("packet 1").At(Timestamp::PreStream()));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -190,7 +190,7 @@ TEST_F(InputStreamManagerTest, AddPacketsOnlyPreStream) {
 // An attempt to add a packet after Timestamp::PreStream() should be rejected
 // because the next timestamp bound is Timestamp::OneOverPostStream().
 TEST_F(InputStreamManagerTest, AddPacketsAfterPreStream) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(
       MakePacket<std::string>("packet 1").At(Timestamp::PreStream()));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(10)));
@@ -204,7 +204,7 @@ TEST_F(InputStreamManagerTest, AddPacketsAfterPreStream) {
 }
 
 TEST_F(InputStreamManagerTest, AddPacketsOnlyPostStream) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(
       MakePacket<std::string>("packet 1").At(Timestamp::PostStream()));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -218,7 +218,7 @@ TEST_F(InputStreamManagerTest, AddPacketsOnlyPostStream) {
 // A packet at Timestamp::PostStream() must be the only Packet in an input
 // stream.
 TEST_F(InputStreamManagerTest, AddPacketsBeforePostStream) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(
       MakePacket<std::string>("packet 2").At(Timestamp::PostStream()));
@@ -231,7 +231,7 @@ TEST_F(InputStreamManagerTest, AddPacketsBeforePostStream) {
 }
 
 TEST_F(InputStreamManagerTest, AddPacketsReverseTimestamps) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(20)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 3").At(Timestamp(30)));
@@ -249,7 +249,7 @@ TEST_F(InputStreamManagerTest, PopPacketAtTimestamp) {
   std::string expected_value_at_10("packet 1");
   std::string expected_value_at_20("packet 2");
   std::string expected_value_at_30("packet 3");
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(
       MakePacket<std::string>(expected_value_at_10).At(Timestamp(10)));
   packets.push_back(
@@ -334,7 +334,7 @@ TEST_F(InputStreamManagerTest, PopQueueHead) {
   std::string expected_value_at_10("packet 1");
   std::string expected_value_at_20("packet 2");
   std::string expected_value_at_30("packet 3");
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(
       MakePacket<std::string>(expected_value_at_10).At(Timestamp(10)));
   packets.push_back(
@@ -394,7 +394,7 @@ TEST_F(InputStreamManagerTest, PopQueueHead) {
 }
 
 TEST_F(InputStreamManagerTest, BadPacketType) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<int>(10).At(Timestamp(10)));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
 
@@ -405,7 +405,7 @@ TEST_F(InputStreamManagerTest, BadPacketType) {
 }
 
 TEST_F(InputStreamManagerTest, Close) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   packets.push_back(MakePacket<std::string>("packet 3").At(Timestamp(30)));
@@ -428,7 +428,7 @@ TEST_F(InputStreamManagerTest, Close) {
 }
 
 TEST_F(InputStreamManagerTest, ReuseInputStreamManager) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   packets.push_back(MakePacket<std::string>("packet 3").At(Timestamp(30)));
@@ -481,7 +481,7 @@ TEST_F(InputStreamManagerTest, ReuseInputStreamManager) {
 }
 
 TEST_F(InputStreamManagerTest, MultipleNotifications) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -526,7 +526,7 @@ TEST_F(InputStreamManagerTest, SetHeader) {
 }
 
 TEST_F(InputStreamManagerTest, BackwardsInTime) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -593,7 +593,7 @@ TEST_F(InputStreamManagerTest, BackwardsInTime) {
 }
 
 TEST_F(InputStreamManagerTest, SelectBackwardsInTime) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -637,7 +637,7 @@ TEST_F(InputStreamManagerTest, SelectBackwardsInTime) {
 }
 
 TEST_F(InputStreamManagerTest, TimestampBound) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
@@ -747,7 +747,7 @@ TEST_F(InputStreamManagerTest, TimestampBound) {
 }
 
 TEST_F(InputStreamManagerTest, QueueSizeTest) {
-  std::list<Packet> packets;
+  PacketQueue packets;
   int max_queue_size = 2;
   input_stream_manager_->SetMaxQueueSize(max_queue_size);
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
@@ -781,6 +781,71 @@ TEST_F(InputStreamManagerTest, QueueSizeTest) {
   expected_queue_becomes_not_full_count_ = 1;
 }
 
+int64 SizeHint(const Packet& packet) {
+  return packet_internal::GetHolder(packet)->GetSizeHint();
+}
+
+TEST_F(InputStreamManagerTest, QueuedBytesTest) {
+  QueueTotals totals;
+  input_stream_manager_->SetQueueTotals(&totals);
+  Packet packet1 = MakePacket<std::string>(1000, 'a').At(Timestamp(10));
+  Packet packet2 = MakePacket<std::string>(2000, 'b').At(Timestamp(20));
+  const int64 bytes1 = SizeHint(packet1);
+  const int64 bytes2 = SizeHint(packet2);
+  EXPECT_LE(1000, bytes1);
+  EXPECT_LE(2000, bytes2);
+
+  MP_ASSERT_OK(input_stream_manager_->AddPackets({packet1, packet2}, &notify_));
+  EXPECT_EQ(bytes1 + bytes2, input_stream_manager_->QueuedBytes());
+  EXPECT_EQ(2, totals.Packets());
+  EXPECT_EQ(bytes1 + bytes2, totals.Bytes());
+
+  popped_packet_ = input_stream_manager_->PopPacketAtTimestamp(
+      Timestamp(10), &num_packets_dropped_, &stream_is_done_);
+  EXPECT_EQ(bytes2, input_stream_manager_->QueuedBytes());
+  EXPECT_EQ(1, totals.Packets());
+  EXPECT_EQ(bytes2, totals.Bytes());
+
+  input_stream_manager_->ErasePacketsEarlierThan(Timestamp(30));
+  EXPECT_EQ(0, input_stream_manager_->QueuedBytes());
+  EXPECT_EQ(0, totals.Packets());
+  EXPECT_EQ(0, totals.Bytes());
+
+  // The high-water marks remain until the next run.
+  EXPECT_EQ(2, input_stream_manager_->PeakQueueSize());
+  EXPECT_EQ(bytes1 + bytes2, input_stream_manager_->PeakQueuedBytes());
+  EXPECT_EQ(2, totals.PeakPackets());
+  EXPECT_EQ(bytes1 + bytes2, totals.PeakBytes());
+  input_stream_manager_->PrepareForRun();
+  EXPECT_EQ(0, input_stream_manager_->PeakQueueSize());
+  EXPECT_EQ(0, input_stream_manager_->PeakQueuedBytes());
+}
+
+TEST_F(InputStreamManagerTest, QueuedBytesLimitTest) {
+  Packet packet1 = MakePacket<std::string>(1000, 'a').At(Timestamp(10));
+  Packet packet2 = MakePacket<std::string>(1000, 'b').At(Timestamp(20));
+  input_stream_manager_->SetMaxQueuedBytes(SizeHint(packet1) + 1);
+
+  // A single packet fits under the limit, a second one fills the queue.
+  MP_ASSERT_OK(input_stream_manager_->AddPackets({packet1}, &notify_));
+  EXPECT_FALSE(input_stream_manager_->IsFull());
+  MP_ASSERT_OK(input_stream_manager_->AddPackets({packet2}, &notify_));
+  EXPECT_TRUE(input_stream_manager_->IsFull());
+
+  popped_packet_ = input_stream_manager_->PopPacketAtTimestamp(
+      Timestamp(10), &num_packets_dropped_, &stream_is_done_);
+  EXPECT_FALSE(input_stream_manager_->IsFull());
+
+  // Lowering the limit fills the queue again, and removing the limit does not.
+  input_stream_manager_->SetMaxQueuedBytes(1);
+  EXPECT_TRUE(input_stream_manager_->IsFull());
+  input_stream_manager_->SetMaxQueuedBytes(-1);
+  EXPECT_FALSE(input_stream_manager_->IsFull());
+
+  expected_queue_becomes_full_count_ = 2;
+  expected_queue_becomes_not_full_count_ = 2;
+}
+
 TEST_F(InputStreamManagerTest, InputReleaseTest) {
   packet_type_.Set<LifetimeTracker::Object>();
   input_stream_manager_ = absl::make_unique<InputStreamManager>();
@@ -833,7 +898,7 @@ TEST_F(InputStreamManagerTest, InputReleaseTest) {
 // if packet timestamps don't need to be increasing.
 TEST_F(InputStreamManagerTest, AddPacketsAfterPreStreamUntimed) {
   input_stream_manager_->DisableTimestamps();
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(
       MakePacket<std::string>("packet 1").At(Timestamp::PreStream()));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(10)));
@@ -849,7 +914,7 @@ TEST_F(InputStreamManagerTest, AddPacketsAfterPreStreamUntimed) {
 // an input stream if packet timestamps don't need to be increasing.
 TEST_F(InputStreamManagerTest, AddPacketsBeforePostStreamUntimed) {
   input_stream_manager_->DisableTimestamps();
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(
       MakePacket<std::string>("packet 2").At(Timestamp::PostStream()));
@@ -863,7 +928,7 @@ TEST_F(InputStreamManagerTest, AddPacketsBeforePostStreamUntimed) {
 
 TEST_F(InputStreamManagerTest, BackwardsInTimeUntimed) {
   input_stream_manager_->DisableTimestamps();
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(MakePacket<std::string>("packet 1").At(Timestamp(10)));
   packets.push_back(MakePacket<std::string>("packet 2").At(Timestamp(20)));
   EXPECT_TRUE(input_stream_manager_->IsEmpty());
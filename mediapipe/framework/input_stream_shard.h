@@ -21,6 +21,7 @@
 
 #include "mediapipe/framework/input_stream.h"
 #include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/packet_queue.h"
 
 namespace mediapipe {
 
@@ -72,7 +73,7 @@ class InputStreamShard : public InputStream {
   void AddPacket(Packet&& value, bool is_done);
 
   // Packet storage for batch processing.
-  std::queue<Packet> packet_queue_;
+  std::queue<Packet, PacketQueue> packet_queue_;
   Packet empty_packet_;
 
   // Pointer to the name std::string of the InputStreamManager.
@@ -15,11 +15,11 @@
 #ifndef MEDIAPIPE_FRAMEWORK_OUTPUT_STREAM_SHARD_H_
 #define MEDIAPIPE_FRAMEWORK_OUTPUT_STREAM_SHARD_H_
 
-#include <list>
 #include <string>
 
 #include "mediapipe/framework/output_stream.h"
 #include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/packet_queue.h"
 #include "mediapipe/framework/packet_type.h"
 #include "mediapipe/framework/port.h"
 #include "mediapipe/framework/timestamp.h"
@@ -105,8 +105,8 @@ class OutputStreamShard : public OutputStream {
   ::mediapipe::Status AddPacketInternal(T&& packet);
 
   // Returns a pointer to the output queue.
-  std::list<Packet>* OutputQueue() { return &output_queue_; }
-  const std::list<Packet>* OutputQueue() const { return &output_queue_; }
+  PacketQueue* OutputQueue() { return &output_queue_; }
+  const PacketQueue* OutputQueue() const { return &output_queue_; }
 
   // Resets data members.
   void Reset(Timestamp next_timestamp_bound, bool close);
@@ -114,7 +114,7 @@ class OutputStreamShard : public OutputStream {
   // A pointer to the output stream spec object, which is owned by the output
   // stream manager.
   OutputStreamSpec* output_stream_spec_;
-  std::list<Packet> output_queue_;
+  PacketQueue output_queue_;
   bool closed_;
   Timestamp next_timestamp_bound_;
 
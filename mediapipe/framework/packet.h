@@ -17,6 +17,7 @@
 #ifndef MEDIAPIPE_FRAMEWORK_PACKET_H_
 #define MEDIAPIPE_FRAMEWORK_PACKET_H_
 
+#include <atomic>
 #include <cstddef>
 #include <memory>
 #include <string>
@@ -45,12 +46,45 @@ class Packet;
 
 namespace packet_internal {
 class HolderBase;
+template <typename T>
+class InlineHolder;
+
+// A reference-counting pointer to a HolderBase. The count is kept in the
+// holder itself, so sharing a holder needs no separate control block.
+class HolderPtr {
+ public:
+  HolderPtr() = default;
+  // Takes over the reference that a newly created |holder| starts with.
+  explicit HolderPtr(HolderBase* holder) : holder_(holder) {}
+  HolderPtr(const HolderPtr& that);
+  HolderPtr(HolderPtr&& that) : holder_(that.holder_) {
+    that.holder_ = nullptr;
+  }
+  HolderPtr& operator=(const HolderPtr& that);
+  HolderPtr& operator=(HolderPtr&& that);
+  ~HolderPtr() { reset(); }
+
+  HolderBase* get() const { return holder_; }
+  HolderBase* operator->() const { return holder_; }
+  explicit operator bool() const { return holder_ != nullptr; }
+  bool operator==(std::nullptr_t) const { return holder_ == nullptr; }
+  bool operator!=(std::nullptr_t) const { return holder_ != nullptr; }
+
+  // Returns true if this is the only reference to the holder.
+  bool unique() const;
+  // Drops the reference to the current holder, if any, and takes over the
+  // reference of |holder|.
+  void reset(HolderBase* holder = nullptr);
+
+ private:
+  HolderBase* holder_ = nullptr;
+};
 
 Packet Create(HolderBase* holder);
 Packet Create(HolderBase* holder, Timestamp timestamp);
-Packet Create(std::shared_ptr<HolderBase> holder, Timestamp timestamp);
+Packet Create(HolderPtr holder, Timestamp timestamp);
 const HolderBase* GetHolder(const Packet& packet);
-const std::shared_ptr<HolderBase>& GetHolderShared(const Packet& packet);
+const HolderPtr& GetHolderShared(const Packet& packet);
 }  // namespace packet_internal
 
 // A generic container class which can hold data of any type.  The type of
@@ -59,7 +93,9 @@ const std::shared_ptr<HolderBase>& GetHolderShared(const Packet& packet);
 // The Packet is implemented as a reference-counted pointer.  This means
 // that copying Packets creates a fast, shallow copy.  Packets are
 // copyable, movable, and assignable.  Packets can be stored in STL
-// containers.  A Packet may optionally contain a timestamp.
+// containers.  A Packet may optionally contain a timestamp.  The reference
+// count lives in the holder of the data, and MakePacket<T>() allocates the
+// holder and the T together.
 //
 // The preferred method of creating a Packet is with MakePacket<T>().
 // The Packet typically owns the object that it contains, but
@@ -203,15 +239,14 @@ class Packet {
   friend Packet packet_internal::Create(packet_internal::HolderBase* holder);
   friend Packet packet_internal::Create(packet_internal::HolderBase* holder,
                                         class Timestamp timestamp);
-  friend Packet packet_internal::Create(
-      std::shared_ptr<packet_internal::HolderBase> holder,
-      class Timestamp timestamp);
+  friend Packet packet_internal::Create(packet_internal::HolderPtr holder,
+                                        class Timestamp timestamp);
   friend const packet_internal::HolderBase* packet_internal::GetHolder(
       const Packet& packet);
-  friend const std::shared_ptr<packet_internal::HolderBase>&
-  packet_internal::GetHolderShared(const Packet& packet);
+  friend const packet_internal::HolderPtr& packet_internal::GetHolderShared(
+      const Packet& packet);
 
-  std::shared_ptr<packet_internal::HolderBase> holder_;
+  packet_internal::HolderPtr holder_;
   class Timestamp timestamp_;
 };
 
@@ -234,6 +269,16 @@ Packet Adopt(const T* ptr);
 template <typename T>
 Packet PointToForeign(const T* ptr);
 
+// Returns a Packet that shares the ownership of *ptr with |ptr|: the data is
+// destroyed by the deleter of |ptr| once the returned Packet, its copies and
+// the other owners are all gone. This lets a Packet point into a larger
+// object, through the aliasing constructor of std::shared_ptr, or hand a
+// buffer back to a pool through a custom deleter. Like the data of
+// PointToForeign, the data cannot be consumed. The timestamp of the returned
+// Packet is Timestamp::Unset().
+template <typename T>
+Packet PointToShared(std::shared_ptr<T> ptr);
+
 // Adopts the data but places it in a std::unique_ptr inside the
 // resulting Packet, leaving the timestamp unset. This allows the
 // adopted data to be mutated, with the mutable data accessible as
@@ -288,16 +333,46 @@ Packet AdoptAsSyncedPacket(const T* ptr) {
   return AdoptAsUniquePtr(new SyncedPacket(packet));
 }
 
+namespace packet_internal {
+
+// The largest object that MakePacket stores inside its holder.
+constexpr size_t kMaxInlineDataSize = 64;
+
+// MakePacket stores the object inside its holder if operator new aligns the
+// holder well enough for it, and if Consume() can move it out again cheaply
+// and without throwing. The consumed object is then a new one, moved from the
+// packet's. Other objects get their own allocation, which Consume() hands out
+// as is, so that a type that can only be copied is never copied silently.
+template <typename T>
+using StoresInline = std::integral_constant<
+    bool, std::is_nothrow_move_constructible<T>::value &&
+              sizeof(T) <= kMaxInlineDataSize &&
+              alignof(T) <= alignof(std::max_align_t)>;
+
+template <typename T, typename... Args>
+Packet MakePacketImpl(std::true_type stores_inline, Args&&... args) {
+  return Create(new InlineHolder<T>(std::forward<Args>(args)...));
+}
+
+template <typename T, typename... Args>
+Packet MakePacketImpl(std::false_type stores_inline, Args&&... args) {
+  return Adopt(new T(std::forward<Args>(args)...));
+}
+
+}  // namespace packet_internal
+
 // Create a packet containing an object of type T initialized with the
 // provided arguments. Similar to MakeUnique. Especially convenient for arrays,
 // since it ensures the packet gets the right type (see below).
 //
-// Version for scalars.
+// Version for scalars. The object, its holder and the reference count
+// usually share a single allocation.
 template <typename T,
           typename std::enable_if<!std::is_array<T>::value>::type* = nullptr,
           typename... Args>
 Packet MakePacket(Args&&... args) {  // NOLINT(build/c++11)
-  return Adopt(new T(std::forward<Args>(args)...));
+  return packet_internal::MakePacketImpl<T>(
+      packet_internal::StoresInline<T>(), std::forward<Args>(args)...);
 }
 
 // Version for arrays. We have to use reinterpret_cast because new T[N]
@@ -368,10 +443,58 @@ class HolderBase {
   virtual StatusOr<std::vector<const proto_ns::MessageLite*>>
   GetVectorOfProtoMessageLite() = 0;
 
+  // Returns an estimate of the bytes of memory held by the data, used to
+  // account for the memory queued in input streams. See SizeHint() below.
+  virtual size_t GetSizeHint() const = 0;
+
  private:
+  friend class HolderPtr;
+
+  void Ref() const { ref_count_.fetch_add(1, std::memory_order_relaxed); }
+  // Deletes the holder when the last reference is dropped. The sole owner
+  // skips the atomic decrement, since nobody else can add a reference.
+  void Unref() const {
+    if (ref_count_.load(std::memory_order_acquire) == 1 ||
+        ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+  bool HasOneRef() const {
+    return ref_count_.load(std::memory_order_acquire) == 1;
+  }
+
   size_t type_id_;
+  mutable std::atomic<int> ref_count_{1};
 };
 
+inline HolderPtr::HolderPtr(const HolderPtr& that) : holder_(that.holder_) {
+  if (holder_) holder_->Ref();
+}
+
+inline HolderPtr& HolderPtr::operator=(const HolderPtr& that) {
+  if (that.holder_) that.holder_->Ref();
+  reset(that.holder_);
+  return *this;
+}
+
+inline HolderPtr& HolderPtr::operator=(HolderPtr&& that) {
+  if (this != &that) {
+    reset(that.holder_);
+    that.holder_ = nullptr;
+  }
+  return *this;
+}
+
+inline bool HolderPtr::unique() const {
+  return holder_ != nullptr && holder_->HasOneRef();
+}
+
+inline void HolderPtr::reset(HolderBase* holder) {
+  HolderBase* old_holder = holder_;
+  holder_ = holder;
+  if (old_holder) old_holder->Unref();
+}
+
 // Two helper functions to get the proto base pointers.
 template <typename T>
 const proto_ns::MessageLite* ConvertToProtoMessageLite(const T* data,
@@ -416,6 +539,62 @@ ConvertToVectorOfProtoMessageLitePtrs(const T* data,
   return result;
 }
 
+// Helper functions to estimate the bytes held by a value. Besides sizeof(T),
+// they count the pixels of an ImageFrame (PixelDataSize()), the buffers of a
+// vector of TfLiteTensor (TfLiteTensor::bytes), the coefficients of a dynamic
+// Eigen matrix and the elements of a std::string or std::vector. Elements are
+// not followed any further. The overload with the highest applicable rank is
+// chosen.
+template <int N>
+struct SizeHintRank : SizeHintRank<N - 1> {};
+template <>
+struct SizeHintRank<0> {};
+
+template <typename T>
+size_t SizeHint(const T& data, SizeHintRank<0>) {
+  return sizeof(T);
+}
+
+// Containers.
+template <typename T>
+auto SizeHint(const T& data, SizeHintRank<1>)
+    -> decltype(size_t(data.capacity()), sizeof(typename T::value_type)) {
+  return sizeof(T) + data.capacity() * sizeof(typename T::value_type);
+}
+
+// Eigen matrices, whose fixed-size coefficients are part of sizeof(T).
+template <typename T>
+auto SizeHint(const T& data, SizeHintRank<2>)
+    -> decltype(size_t(data.size()), size_t(T::SizeAtCompileTime),
+                sizeof(typename T::Scalar)) {
+  return sizeof(T) + (T::SizeAtCompileTime < 0
+                          ? data.size() * sizeof(typename T::Scalar)
+                          : 0);
+}
+
+// Containers of tensors, which point to their buffers.
+template <typename T>
+auto SizeHint(const T& data, SizeHintRank<3>)
+    -> decltype(size_t(data.capacity()), size_t(data.begin()->bytes)) {
+  size_t size = sizeof(T) + data.capacity() * sizeof(typename T::value_type);
+  for (const auto& tensor : data) {
+    size += tensor.bytes;
+  }
+  return size;
+}
+
+// Image frames.
+template <typename T>
+auto SizeHint(const T& data, SizeHintRank<4>)
+    -> decltype(size_t(data.PixelDataSize())) {
+  return sizeof(T) + data.PixelDataSize();
+}
+
+template <typename T>
+size_t SizeHint(const T& data) {
+  return SizeHint(data, SizeHintRank<4>());
+}
+
 template <typename T>
 class Holder : public HolderBase {
  public:
@@ -437,6 +616,9 @@ class Holder : public HolderBase {
       return InternalError(
           "Foreign holder can't release data ptr without ownership.");
     }
+    if (T* moved_data = MoveInlineData()) {
+      return std::unique_ptr<T>(moved_data);
+    }
     // Casts away constness to make the data mutable after the release.
     std::unique_ptr<T> data_ptr(const_cast<T*>(ptr_));
     ptr_ = nullptr;
@@ -460,6 +642,7 @@ class Holder : public HolderBase {
     }
     return "";
   }
+  size_t GetSizeHint() const final { return ptr_ ? size_hint_helper() : 0; }
 
  protected:
   // The pointer that uniquely owns the data. However, the ownership of the
@@ -481,6 +664,10 @@ class Holder : public HolderBase {
     return ConvertToVectorOfProtoMessageLitePtrs(ptr_, is_proto_vector<T>());
   }
 
+  // Overridden by holders that keep the data in their own allocation: moves
+  // the data into a new T for Release(). Returns nullptr otherwise.
+  virtual T* MoveInlineData() { return nullptr; }
+
  private:
   // Call delete[] if T is an array, delete otherwise.
   template <typename U = T>
@@ -496,6 +683,19 @@ class Holder : public HolderBase {
     delete[] reinterpret_cast<const typename std::remove_extent<U>::type*>(
         ptr_);
   }
+  // The size of an unbounded array is unknown.
+  template <typename U = T>
+  inline size_t size_hint_helper(
+      typename std::enable_if<!std::is_array<U>::value ||
+                              std::extent<U>::value != 0>::type* = 0) const {
+    return SizeHint(*ptr_);
+  }
+  template <typename U = T>
+  inline size_t size_hint_helper(
+      typename std::enable_if<std::is_array<U>::value &&
+                              std::extent<U>::value == 0>::type* = 0) const {
+    return 0;
+  }
 };
 
 // Like Holder, but does not own its data.
@@ -518,6 +718,39 @@ class ForeignHolder : public Holder<T> {
   }
 };
 
+// Like ForeignHolder, but keeps a reference to the shared owner of its data.
+// It has the type id of ForeignHolder<T>, since it cannot release the data.
+template <typename T>
+class SharedHolder : public ForeignHolder<T> {
+ public:
+  explicit SharedHolder(std::shared_ptr<const T> ptr)
+      : ForeignHolder<T>(ptr.get()), owner_(std::move(ptr)) {}
+
+ private:
+  std::shared_ptr<const T> owner_;
+};
+
+// Like Holder, but stores the data inside the holder, so that the data, the
+// holder and its reference count take a single allocation. It has the type id
+// of Holder<T>, since it owns its data just the same.
+template <typename T>
+class InlineHolder : public Holder<T> {
+ public:
+  template <typename... Args>
+  explicit InlineHolder(Args&&... args)
+      : Holder<T>(&data_), data_(std::forward<Args>(args)...) {}
+  ~InlineHolder() override {
+    // Null out ptr_ so it doesn't get deleted by ~Holder.
+    this->ptr_ = nullptr;
+  }
+
+ protected:
+  T* MoveInlineData() override { return new T(std::move(data_)); }
+
+ private:
+  T data_;
+};
+
 template <typename T>
 Holder<T>* HolderBase::As() {
   if (HolderIsOfType<Holder<T>>() || HolderIsOfType<ForeignHolder<T>>()) {
@@ -713,6 +946,14 @@ Packet PointToForeign(const T* ptr) {
   return packet_internal::Create(new packet_internal::ForeignHolder<T>(ptr));
 }
 
+template <typename T>
+Packet PointToShared(std::shared_ptr<T> ptr) {
+  CHECK(ptr != nullptr);
+  using Data = typename std::remove_const<T>::type;
+  return packet_internal::Create(
+      new packet_internal::SharedHolder<Data>(std::move(ptr)));
+}
+
 // Equal Packets refer to the same memory contents, like equal pointers.
 inline bool operator==(const Packet& p1, const Packet& p2) {
   return packet_internal::GetHolder(p1) == packet_internal::GetHolder(p2);
@@ -723,8 +964,7 @@ inline bool operator!=(const Packet& p1, const Packet& p2) {
 
 namespace packet_internal {
 
-inline const std::shared_ptr<HolderBase>& GetHolderShared(
-    const Packet& packet) {
+inline const HolderPtr& GetHolderShared(const Packet& packet) {
   return packet.holder_;
 }
 
@@ -0,0 +1,236 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PACKET_QUEUE_H_
+#define MEDIAPIPE_FRAMEWORK_PACKET_QUEUE_H_
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+#include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+// A FIFO queue of packets stored in a ring buffer, used for the packets
+// moving along a stream: the output queue of an OutputStreamShard, the queue
+// of an InputStreamManager and the packets handed to an InputStreamShard.
+//
+// The first kInlineCapacity packets are stored in the queue object itself;
+// beyond that the ring moves to the heap and doubles as needed. Popping and
+// clearing keep the capacity, so a queue that is reused for every invocation
+// stops allocating once it has grown to the largest batch it has seen. Unlike
+// std::list there is no allocation per packet, and packets moved from one
+// queue to another only have their holders moved.
+//
+// Meets the requirements of the container of a std::queue.
+class PacketQueue {
+ public:
+  static constexpr size_t kInlineCapacity = 2;
+
+  typedef Packet value_type;
+  typedef Packet& reference;
+  typedef const Packet& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename QueueType, typename ValueType>
+  class Iterator {
+   public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef Packet value_type;
+    typedef ptrdiff_t difference_type;
+    typedef ValueType* pointer;
+    typedef ValueType& reference;
+
+    Iterator() : queue_(nullptr), index_(0) {}
+    Iterator(QueueType* queue, size_t index) : queue_(queue), index_(index) {}
+
+    reference operator*() const { return (*queue_)[index_]; }
+    pointer operator->() const { return &(*queue_)[index_]; }
+    reference operator[](difference_type n) const {
+      return (*queue_)[index_ + n];
+    }
+
+    Iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+    Iterator operator++(int) { return Iterator(queue_, index_++); }
+    Iterator& operator--() {
+      --index_;
+      return *this;
+    }
+    Iterator operator--(int) { return Iterator(queue_, index_--); }
+    Iterator& operator+=(difference_type n) {
+      index_ += n;
+      return *this;
+    }
+    Iterator& operator-=(difference_type n) {
+      index_ -= n;
+      return *this;
+    }
+    Iterator operator+(difference_type n) const {
+      return Iterator(queue_, index_ + n);
+    }
+    Iterator operator-(difference_type n) const {
+      return Iterator(queue_, index_ - n);
+    }
+    difference_type operator-(const Iterator& that) const {
+      return static_cast<difference_type>(index_) -
+             static_cast<difference_type>(that.index_);
+    }
+
+    bool operator==(const Iterator& that) const { return index_ == that.index_; }
+    bool operator!=(const Iterator& that) const { return index_ != that.index_; }
+    bool operator<(const Iterator& that) const { return index_ < that.index_; }
+
+   private:
+    QueueType* queue_;
+    size_t index_;
+  };
+  typedef Iterator<PacketQueue, Packet> iterator;
+  typedef Iterator<const PacketQueue, const Packet> const_iterator;
+
+  PacketQueue() : slots_(inline_), capacity_(kInlineCapacity) {}
+  PacketQueue(std::initializer_list<Packet> packets) : PacketQueue() {
+    Reserve(packets.size());
+    for (const Packet& packet : packets) push_back(packet);
+  }
+  PacketQueue(const PacketQueue& that) : PacketQueue() {
+    Reserve(that.size());
+    for (const Packet& packet : that) push_back(packet);
+  }
+  PacketQueue(PacketQueue&& that) : PacketQueue() { *this = std::move(that); }
+  PacketQueue& operator=(const PacketQueue& that) {
+    if (this != &that) {
+      clear();
+      Reserve(that.size());
+      for (const Packet& packet : that) push_back(packet);
+    }
+    return *this;
+  }
+  // Takes over the heap ring of |that|, if it has one.
+  PacketQueue& operator=(PacketQueue&& that) {
+    if (this == &that) return *this;
+    clear();
+    if (that.heap_) {
+      heap_ = std::move(that.heap_);
+      slots_ = heap_.get();
+      capacity_ = that.capacity_;
+      head_ = that.head_;
+      size_ = that.size_;
+      that.slots_ = that.inline_;
+      that.capacity_ = kInlineCapacity;
+      that.head_ = 0;
+      that.size_ = 0;
+    } else {
+      for (Packet& packet : that) push_back(std::move(packet));
+      that.clear();
+    }
+    return *this;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return capacity_; }
+
+  Packet& operator[](size_t index) { return slots_[Slot(index)]; }
+  const Packet& operator[](size_t index) const { return slots_[Slot(index)]; }
+
+  Packet& front() {
+    DCHECK(!empty());
+    return slots_[head_];
+  }
+  const Packet& front() const {
+    DCHECK(!empty());
+    return slots_[head_];
+  }
+  Packet& back() {
+    DCHECK(!empty());
+    return (*this)[size_ - 1];
+  }
+  const Packet& back() const {
+    DCHECK(!empty());
+    return (*this)[size_ - 1];
+  }
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, size_); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size_); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  void push_back(const Packet& packet) { emplace_back(packet); }
+  void push_back(Packet&& packet) { emplace_back(std::move(packet)); }
+
+  template <typename... Args>
+  Packet& emplace_back(Args&&... args) {
+    if (size_ == capacity_) Reserve(capacity_ * 2);
+    Packet& slot = slots_[Slot(size_)];
+    slot = Packet(std::forward<Args>(args)...);
+    ++size_;
+    return slot;
+  }
+
+  // Releases the front packet.
+  void pop_front() {
+    DCHECK(!empty());
+    slots_[head_] = Packet();
+    head_ = Slot(1);
+    --size_;
+  }
+
+  // Releases all packets and keeps the capacity.
+  void clear() {
+    for (size_t i = 0; i < size_; ++i) slots_[Slot(i)] = Packet();
+    head_ = 0;
+    size_ = 0;
+  }
+
+  // Grows the ring to hold at least |capacity| packets.
+  void Reserve(size_t capacity) {
+    if (capacity <= capacity_) return;
+    size_t new_capacity = capacity_;
+    while (new_capacity < capacity) new_capacity *= 2;
+    std::unique_ptr<Packet[]> slots(new Packet[new_capacity]);
+    for (size_t i = 0; i < size_; ++i) {
+      slots[i] = std::move(slots_[Slot(i)]);
+    }
+    heap_ = std::move(slots);
+    slots_ = heap_.get();
+    capacity_ = new_capacity;
+    head_ = 0;
+  }
+
+ private:
+  // The index in slots_ of the |index|-th packet. Capacities are powers of
+  // two.
+  size_t Slot(size_t index) const { return (head_ + index) & (capacity_ - 1); }
+
+  Packet inline_[kInlineCapacity];
+  std::unique_ptr<Packet[]> heap_;
+  Packet* slots_;
+  size_t capacity_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PACKET_QUEUE_H_
@@ -0,0 +1,179 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/packet_queue.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <new>
+#include <queue>
+#include <string>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+// Counts heap allocations, so that the benchmarks can report allocations per
+// packet.
+namespace {
+std::atomic<int64_t> num_allocations(0);
+}  // namespace
+
+void* operator new(size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace mediapipe {
+namespace {
+
+Packet IntPacket(int value) {
+  return MakePacket<int>(value).At(Timestamp(value));
+}
+
+TEST(PacketQueueTest, IsFifo) {
+  PacketQueue queue;
+  for (int i = 0; i < 5; ++i) queue.push_back(IntPacket(i));
+  ASSERT_EQ(5, queue.size());
+  EXPECT_EQ(0, queue.front().Get<int>());
+  EXPECT_EQ(4, queue.back().Get<int>());
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(i, queue.front().Get<int>());
+    queue.pop_front();
+  }
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(PacketQueueTest, StaysInlineForSmallBatches) {
+  PacketQueue queue;
+  const int64_t allocations = num_allocations.load();
+  const Packet packet = IntPacket(1);
+  for (int i = 0; i < 100; ++i) {
+    queue.push_back(packet);
+    queue.push_back(packet);
+    queue.clear();
+  }
+  EXPECT_EQ(allocations, num_allocations.load());
+  EXPECT_EQ(PacketQueue::kInlineCapacity, queue.capacity());
+}
+
+TEST(PacketQueueTest, GrowsAcrossTheWrapAround) {
+  PacketQueue queue;
+  queue.push_back(IntPacket(0));
+  queue.push_back(IntPacket(1));
+  queue.pop_front();
+  for (int i = 2; i < 10; ++i) queue.push_back(IntPacket(i));
+  ASSERT_EQ(9, queue.size());
+  int expected = 1;
+  for (const Packet& packet : queue) {
+    EXPECT_EQ(expected++, packet.Get<int>());
+  }
+  EXPECT_EQ(7, (queue.cend() - 3)->Get<int>());
+}
+
+TEST(PacketQueueTest, ReleasesPoppedPackets) {
+  auto payload = std::make_shared<int>(1);
+  PacketQueue queue;
+  queue.push_back(MakePacket<std::shared_ptr<int>>(payload));
+  queue.push_back(MakePacket<std::shared_ptr<int>>(payload));
+  EXPECT_EQ(3, payload.use_count());
+  queue.pop_front();
+  EXPECT_EQ(2, payload.use_count());
+  queue.clear();
+  EXPECT_EQ(1, payload.use_count());
+}
+
+TEST(PacketQueueTest, MoveTakesOverTheRing) {
+  PacketQueue queue;
+  for (int i = 0; i < 10; ++i) queue.push_back(IntPacket(i));
+  const int64_t allocations = num_allocations.load();
+  PacketQueue moved(std::move(queue));
+  EXPECT_EQ(allocations, num_allocations.load());
+  EXPECT_TRUE(queue.empty());
+  ASSERT_EQ(10, moved.size());
+  EXPECT_EQ(9, moved.back().Get<int>());
+}
+
+TEST(PacketQueueTest, WorksAsStdQueueContainer) {
+  std::queue<Packet, PacketQueue> queue;
+  queue.emplace(IntPacket(1));
+  queue.push(IntPacket(2));
+  EXPECT_EQ(1, queue.front().Get<int>());
+  queue.pop();
+  EXPECT_EQ(2, queue.front().Get<int>());
+}
+
+// Pushes one packet at a time and hands it on, as an output stream does with
+// the packets of one Process() call.
+template <typename Container>
+void BM_PushAndClear(benchmark::State& state) {
+  Container container;
+  const Packet packet = IntPacket(1);
+  const int64_t allocations = num_allocations.load();
+  for (auto _ : state) {
+    container.push_back(packet);
+    container.clear();
+  }
+  state.counters["allocations_per_packet"] =
+      static_cast<double>(num_allocations.load() - allocations) /
+      state.iterations();
+}
+BENCHMARK_TEMPLATE(BM_PushAndClear, std::list<Packet>);
+BENCHMARK_TEMPLATE(BM_PushAndClear, PacketQueue);
+
+// Sends packets through a chain of 10 pass-through nodes and reports the heap
+// allocations made per packet, including those of the packet payload.
+void BM_PassThroughChain(benchmark::State& state) {
+  constexpr int kLength = 10;
+  constexpr int kNumPackets = 1000;
+  CalculatorGraphConfig config;
+  config.add_input_stream("stream_0");
+  for (int i = 0; i < kLength; ++i) {
+    *config.add_node() = ParseTextProtoOrDie<CalculatorGraphConfig::Node>(
+        absl::StrCat(R"(calculator: "PassThroughCalculator"
+                        input_stream: "stream_)",
+                     i, R"(" output_stream: "stream_)", i + 1, "\""));
+  }
+  int64_t allocations = 0;
+  for (auto _ : state) {
+    CalculatorGraph graph;
+    CHECK(graph.Initialize(config).ok());
+    CHECK(graph.StartRun({}).ok());
+    const int64_t start = num_allocations.load();
+    for (int i = 0; i < kNumPackets; ++i) {
+      CHECK(graph.AddPacketToInputStream("stream_0", IntPacket(i)).ok());
+    }
+    CHECK(graph.WaitUntilIdle().ok());
+    allocations += num_allocations.load() - start;
+    CHECK(graph.CloseAllInputStreams().ok());
+    CHECK(graph.WaitUntilDone().ok());
+  }
+  state.counters["allocations_per_packet"] =
+      static_cast<double>(allocations) / (state.iterations() * kNumPackets);
+  state.SetItemsProcessed(state.iterations() * kNumPackets * kLength);
+}
+BENCHMARK(BM_PassThroughChain);
+
+}  // namespace
+}  // namespace mediapipe
@@ -22,6 +22,7 @@
 
 #include "absl/strings/str_cat.h"
 #include "mediapipe/framework/packet_test.pb.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/core_proto_inc.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
@@ -383,6 +384,23 @@ TEST(PacketTest, TestForeignHolderConsumeOrCopy) {
   EXPECT_EQ(33, *result2.ValueOrDie());
 }
 
+TEST(PacketTest, TestPointToShared) {
+  bool deleted = false;
+  std::shared_ptr<int> data(new int(17), [&deleted](int* value) {
+    deleted = true;
+    delete value;
+  });
+  Packet packet = PointToShared(data);
+  data.reset();
+  Packet packet_copy = packet;
+  packet = Packet();
+  EXPECT_FALSE(deleted);
+  EXPECT_EQ(17, packet_copy.Get<int>());
+  EXPECT_FALSE(packet_copy.Consume<int>().ok());
+  packet_copy = Packet();
+  EXPECT_TRUE(deleted);
+}
+
 TEST(PacketTest, TestConsumeBoundedArray) {
   Packet packet1 = MakePacket<int[3]>(10, 20, 30);
   Packet packet_copy = packet1;
@@ -455,5 +473,173 @@ TEST(PacketTest, TestConsumeOrCopyBoundedArray) {
   EXPECT_TRUE(packet2.IsEmpty());
 }
 
+// Records how its instances are copied and moved.
+struct CopyCounter {
+  CopyCounter() = default;
+  CopyCounter(const CopyCounter& other) : copies(other.copies + 1) {}
+  CopyCounter(CopyCounter&& other) noexcept : moves(other.moves + 1) {}
+  int copies = 0;
+  int moves = 0;
+};
+
+// Counts its copies, and has no move constructor.
+struct CopyOnly {
+  CopyOnly() = default;
+  CopyOnly(const CopyOnly& other) : copies(other.copies + 1) {}
+  int copies = 0;
+};
+
+// Too large to be moved out of a packet cheaply.
+struct LargeData {
+  char bytes[256] = {};
+};
+
+static_assert(packet_internal::StoresInline<int>::value, "");
+static_assert(packet_internal::StoresInline<std::string>::value, "");
+static_assert(packet_internal::StoresInline<CopyCounter>::value, "");
+static_assert(!packet_internal::StoresInline<CopyOnly>::value, "");
+static_assert(!packet_internal::StoresInline<LargeData>::value, "");
+
+TEST(PacketTest, ConsumeMovesDataOutOfMakePacket) {
+  Packet packet = MakePacket<CopyCounter>();
+  const CopyCounter* data = &packet.Get<CopyCounter>();
+  ::mediapipe::StatusOr<std::unique_ptr<CopyCounter>> result =
+      packet.Consume<CopyCounter>();
+  MP_ASSERT_OK(result);
+  EXPECT_NE(data, result.ValueOrDie().get());
+  EXPECT_EQ(0, result.ValueOrDie()->copies);
+  EXPECT_EQ(1, result.ValueOrDie()->moves);
+  EXPECT_TRUE(packet.IsEmpty());
+}
+
+TEST(PacketTest, ConsumeOrCopyMovesDataOutOfMakePacket) {
+  Packet packet = MakePacket<CopyCounter>();
+  Packet packet_copy = packet;
+  bool was_copied = false;
+  ::mediapipe::StatusOr<std::unique_ptr<CopyCounter>> result1 =
+      packet_copy.ConsumeOrCopy<CopyCounter>(&was_copied);
+  // The data is shared, so it is copied and stays in the packets.
+  MP_ASSERT_OK(result1);
+  EXPECT_TRUE(was_copied);
+  EXPECT_EQ(1, result1.ValueOrDie()->copies);
+  EXPECT_FALSE(packet.IsEmpty());
+  EXPECT_FALSE(packet_copy.IsEmpty());
+
+  packet_copy = Packet();
+  ::mediapipe::StatusOr<std::unique_ptr<CopyCounter>> result2 =
+      packet.ConsumeOrCopy<CopyCounter>(&was_copied);
+  // The sole owner moves the data out.
+  MP_ASSERT_OK(result2);
+  EXPECT_FALSE(was_copied);
+  EXPECT_EQ(0, result2.ValueOrDie()->copies);
+  EXPECT_EQ(1, result2.ValueOrDie()->moves);
+  EXPECT_TRUE(packet.IsEmpty());
+}
+
+TEST(PacketTest, ConsumeReleasesCopyOnlyDataOfMakePacket) {
+  Packet packet = MakePacket<CopyOnly>();
+  const CopyOnly* data = &packet.Get<CopyOnly>();
+  ::mediapipe::StatusOr<std::unique_ptr<CopyOnly>> result =
+      packet.Consume<CopyOnly>();
+  MP_ASSERT_OK(result);
+  EXPECT_EQ(data, result.ValueOrDie().get());
+  EXPECT_EQ(0, result.ValueOrDie()->copies);
+  EXPECT_TRUE(packet.IsEmpty());
+}
+
+TEST(PacketTest, ConsumeOrCopyReleasesLargeDataOfMakePacket) {
+  Packet packet = MakePacket<LargeData>();
+  const LargeData* data = &packet.Get<LargeData>();
+  bool was_copied = true;
+  ::mediapipe::StatusOr<std::unique_ptr<LargeData>> result =
+      packet.ConsumeOrCopy<LargeData>(&was_copied);
+  MP_ASSERT_OK(result);
+  EXPECT_FALSE(was_copied);
+  EXPECT_EQ(data, result.ValueOrDie().get());
+  EXPECT_TRUE(packet.IsEmpty());
+}
+
+TEST(PacketTest, AdoptedDataIsReleasedWithoutMoving) {
+  CopyCounter* data = new CopyCounter;
+  Packet packet = Adopt(data);
+  ::mediapipe::StatusOr<std::unique_ptr<CopyCounter>> result =
+      packet.Consume<CopyCounter>();
+  MP_ASSERT_OK(result);
+  EXPECT_EQ(data, result.ValueOrDie().get());
+  EXPECT_EQ(0, result.ValueOrDie()->moves);
+}
+
+TEST(PacketTest, CopiesShareTheData) {
+  Packet packet = MakePacket<std::string>("shared");
+  Packet copy = packet;
+  Packet timestamped = copy.At(Timestamp(1));
+  EXPECT_EQ(&packet.Get<std::string>(), &timestamped.Get<std::string>());
+  packet = Packet();
+  copy = Packet();
+  EXPECT_EQ("shared", timestamped.Get<std::string>());
+  MP_EXPECT_OK(timestamped.Consume<std::string>());
+}
+
+// Stand-ins for ImageFrame and TfLiteTensor.
+struct FakeImage {
+  int PixelDataSize() const { return 640 * 480 * 3; }
+};
+struct FakeTensor {
+  size_t bytes;
+};
+
+size_t SizeHintOf(const Packet& packet) {
+  return packet_internal::GetHolder(packet)->GetSizeHint();
+}
+
+TEST(PacketTest, SizeHintCountsTheHeldBuffers) {
+  EXPECT_EQ(sizeof(int), SizeHintOf(MakePacket<int>(1)));
+  EXPECT_EQ(sizeof(int[3]), SizeHintOf(MakePacket<int[3]>(1, 2, 3)));
+  EXPECT_EQ(sizeof(FakeImage) + 640 * 480 * 3,
+            SizeHintOf(MakePacket<FakeImage>()));
+
+  std::vector<float> floats;
+  floats.reserve(100);
+  EXPECT_EQ(sizeof(floats) + floats.capacity() * sizeof(float),
+            SizeHintOf(MakePacket<std::vector<float>>(std::move(floats))));
+
+  std::vector<FakeTensor> tensors = {{1000}, {24}};
+  EXPECT_EQ(sizeof(tensors) + tensors.capacity() * sizeof(FakeTensor) + 1024,
+            SizeHintOf(MakePacket<std::vector<FakeTensor>>(tensors)));
+}
+
+void BM_MakePacket(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(MakePacket<int>(1));
+  }
+}
+BENCHMARK(BM_MakePacket);
+
+void BM_AdoptPacket(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Adopt(new int(1)));
+  }
+}
+BENCHMARK(BM_AdoptPacket);
+
+void BM_CopyPacket(benchmark::State& state) {
+  const Packet packet = MakePacket<int>(1);
+  for (auto _ : state) {
+    Packet copy = packet;
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK(BM_CopyPacket);
+
+// Sets the timestamp of a packet that is handed on, as source calculators do.
+void BM_MakePacketAt(benchmark::State& state) {
+  int64 timestamp = 0;
+  for (auto _ : state) {
+    Packet packet = MakePacket<int>(1).At(Timestamp(++timestamp));
+    benchmark::DoNotOptimize(packet);
+  }
+}
+BENCHMARK(BM_MakePacketAt);
+
 }  // namespace
 }  // namespace mediapipe
@@ -0,0 +1,255 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/chrome_trace_builder.h"
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+
+namespace mediapipe {
+
+namespace {
+
+// The process ids holding the thread tracks and the calculator tracks.
+constexpr int kThreadPid = 1;
+constexpr int kCalculatorPid = 2;
+
+// Returns a quoted and escaped JSON string.
+std::string JsonString(absl::string_view text) {
+  std::string result = "\"";
+  for (char c : text) {
+    switch (c) {
+      case '"':
+        result += "\\\"";
+        break;
+      case '\\':
+        result += "\\\\";
+        break;
+      case '\n':
+        result += "\\n";
+        break;
+      case '\t':
+        result += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          absl::StrAppendFormat(&result, "\\u%04x", static_cast<int>(c));
+        } else {
+          result += c;
+        }
+    }
+  }
+  result += "\"";
+  return result;
+}
+
+// Returns true for the event types spanning the execution of a task.
+bool IsTaskEvent(GraphTrace::EventType event_type) {
+  switch (event_type) {
+    case GraphTrace::OPEN:
+    case GraphTrace::PROCESS:
+    case GraphTrace::CLOSE:
+    case GraphTrace::CPU_TASK_USER:
+    case GraphTrace::CPU_TASK_SYSTEM:
+    case GraphTrace::GPU_TASK:
+    case GraphTrace::DSP_TASK:
+    case GraphTrace::TPU_TASK:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Appends a metadata event naming a process or a thread.
+void AppendNameEvent(const char* kind, int pid, int tid,
+                     absl::string_view name, std::string* result) {
+  absl::StrAppend(result, "{\"ph\":\"M\",\"name\":\"", kind,
+                  "\",\"pid\":", pid, ",\"tid\":", tid,
+                  ",\"args\":{\"name\":", JsonString(name), "}},\n");
+}
+
+// Appends a complete event spanning a task.
+void AppendSliceEvent(int pid, int tid, absl::string_view name,
+                      absl::string_view category, int64 start, int64 finish,
+                      int64 input_timestamp, std::string* result) {
+  absl::StrAppend(result, "{\"ph\":\"X\",\"pid\":", pid, ",\"tid\":", tid,
+                  ",\"name\":", JsonString(name),
+                  ",\"cat\":", JsonString(category), ",\"ts\":", start,
+                  ",\"dur\":", finish - start,
+                  ",\"args\":{\"input_timestamp\":", input_timestamp, "}},\n");
+}
+
+// Appends an instant event scoped to a track.
+void AppendInstantEvent(int pid, int tid, absl::string_view name, int64 time,
+                        std::string* result) {
+  absl::StrAppend(result, "{\"ph\":\"i\",\"s\":\"t\",\"pid\":", pid,
+                  ",\"tid\":", tid, ",\"name\":", JsonString(name),
+                  ",\"ts\":", time, "},\n");
+}
+
+// Appends the start or the end of a flow arrow.  Both ends are bound to the
+// enclosing slices on the calculator tracks.
+void AppendFlowEvent(const char* phase, int64 flow_id, int tid,
+                     absl::string_view name, int64 time, std::string* result) {
+  absl::StrAppend(result, "{\"ph\":\"", phase, "\",\"bp\":\"e\",\"id\":",
+                  flow_id, ",\"pid\":", kCalculatorPid, ",\"tid\":", tid,
+                  ",\"name\":", JsonString(name),
+                  ",\"cat\":\"packet\",\"ts\":", time, "},\n");
+}
+
+}  // namespace
+
+void ChromeTraceBuilder::StartFile(const GraphTrace& trace,
+                                   std::string* result) {
+  calculator_names_.assign(trace.calculator_name().begin(),
+                           trace.calculator_name().end());
+  named_threads_.clear();
+  absl::StrAppend(result, "[\n");
+  AppendNameEvent("process_name", kThreadPid, 0, "Threads", result);
+  AppendNameEvent("process_name", kCalculatorPid, 0, "Calculators", result);
+  for (int i = 0; i < calculator_names_.size(); ++i) {
+    AppendNameEvent("thread_name", kCalculatorPid, i, calculator_names_[i],
+                    result);
+  }
+}
+
+void ChromeTraceBuilder::AppendTrace(const GraphTrace& trace,
+                                     std::string* result) {
+  // Entries older than the previous GraphTrace are discarded.
+  previous_producers_ = std::move(producers_);
+  producers_.clear();
+  previous_task_starts_ = std::move(task_starts_);
+  task_starts_.clear();
+  for (const GraphTrace::CalculatorTrace& task : trace.calculator_trace()) {
+    AppendCalculatorTrace(trace, task, result);
+  }
+}
+
+void ChromeTraceBuilder::AppendCalculatorTrace(
+    const GraphTrace& trace, const GraphTrace::CalculatorTrace& task,
+    std::string* result) {
+  const int32 node_id = task.node_id();
+  const std::string& event_name = GraphTrace::EventType_Name(task.event_type());
+
+  // The queue size of each stream is reported as a counter.
+  if (task.event_type() == GraphTrace::PACKET_QUEUED) {
+    for (const GraphTrace::StreamTrace& input : task.input_trace()) {
+      int64 time =
+          input.has_finish_time() ? input.finish_time() : task.start_time();
+      absl::StrAppend(
+          result, "{\"ph\":\"C\",\"pid\":", kCalculatorPid, ",\"name\":",
+          JsonString(absl::StrCat(StreamName(trace, input.stream_id()),
+                                  " queue")),
+          ",\"ts\":", time, ",\"args\":{\"size\":", input.event_data(),
+          "}},\n");
+    }
+    return;
+  }
+
+  bool has_start = task.has_start_time();
+  bool has_finish = task.has_finish_time();
+  int64 start = task.start_time();
+  int64 finish = task.finish_time();
+  if (!IsTaskEvent(task.event_type())) {
+    AppendInstantEvent(kCalculatorPid, node_id, event_name,
+                       has_start ? start : finish, result);
+    return;
+  }
+
+  // With trace_log_duration_events, the start and the finish of a task are
+  // logged separately, and are joined here into one slice.
+  TaskKey task_key{node_id, task.input_timestamp(), task.event_type()};
+  if (has_start && !has_finish) {
+    task_starts_[task_key] = start;
+  } else if (!has_start && has_finish) {
+    for (auto* starts : {&task_starts_, &previous_task_starts_}) {
+      auto it = starts->find(task_key);
+      if (it != starts->end()) {
+        has_start = true;
+        start = it->second;
+        starts->erase(it);
+        break;
+      }
+    }
+  }
+
+  // Each input packet is joined to the task that produced it.
+  if (task.has_start_time()) {
+    for (const GraphTrace::StreamTrace& input : task.input_trace()) {
+      const Producer* producer =
+          FindProducer({input.stream_id(), input.packet_timestamp()});
+      if (producer) {
+        std::string stream_name = StreamName(trace, input.stream_id());
+        AppendFlowEvent("s", next_flow_id_, producer->node_id, stream_name,
+                        producer->time, result);
+        AppendFlowEvent("f", next_flow_id_, node_id, stream_name, start,
+                        result);
+        ++next_flow_id_;
+      }
+    }
+  }
+  for (const GraphTrace::StreamTrace& output : task.output_trace()) {
+    producers_[{output.stream_id(), output.packet_timestamp()}] = {
+        node_id, has_start ? start : finish};
+  }
+
+  int64 input_timestamp = trace.base_timestamp() + task.input_timestamp();
+  if (has_start && has_finish) {
+    AppendThreadName(task.thread_id(), result);
+    AppendSliceEvent(kThreadPid, task.thread_id(), CalculatorName(node_id),
+                     event_name, start, finish, input_timestamp, result);
+    AppendSliceEvent(kCalculatorPid, node_id, event_name, event_name, start,
+                     finish, input_timestamp, result);
+  } else if (has_finish) {
+    // A task without a recorded start, such as a source node task.
+    AppendInstantEvent(kCalculatorPid, node_id, event_name, finish, result);
+  }
+}
+
+void ChromeTraceBuilder::AppendThreadName(int32 thread_id,
+                                          std::string* result) {
+  if (named_threads_.insert(thread_id).second) {
+    AppendNameEvent("thread_name", kThreadPid, thread_id,
+                    absl::StrCat("Thread ", thread_id), result);
+  }
+}
+
+std::string ChromeTraceBuilder::CalculatorName(int32 node_id) const {
+  if (node_id >= 0 && node_id < calculator_names_.size()) {
+    return calculator_names_[node_id];
+  }
+  return absl::StrCat("node ", node_id);
+}
+
+std::string ChromeTraceBuilder::StreamName(const GraphTrace& trace,
+                                           int32 stream_id) {
+  if (stream_id >= 0 && stream_id < trace.stream_name_size()) {
+    return trace.stream_name(stream_id);
+  }
+  return absl::StrCat("stream ", stream_id);
+}
+
+const ChromeTraceBuilder::Producer* ChromeTraceBuilder::FindProducer(
+    const PacketKey& key) const {
+  for (auto* producers : {&producers_, &previous_producers_}) {
+    auto it = producers->find(key);
+    if (it != producers->end()) {
+      return &it->second;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace mediapipe
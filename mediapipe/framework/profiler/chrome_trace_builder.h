@@ -0,0 +1,95 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PROFILER_CHROME_TRACE_BUILDER_H_
+#define MEDIAPIPE_FRAMEWORK_PROFILER_CHROME_TRACE_BUILDER_H_
+
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+// Converts GraphTrace protos into the Chrome trace-event JSON format, which
+// can be opened in chrome://tracing or in the Perfetto UI.
+//
+// The JSON output contains a track for each thread and a track for each
+// calculator node.  Flow arrows connect the task producing each packet to
+// the tasks consuming it, and a counter track shows the queue size of each
+// input stream.
+//
+// The JSON array is left open, so that the events of successive GraphTraces
+// can be appended to the same file as they are recorded.  Both viewers accept
+// the unterminated array.
+class ChromeTraceBuilder {
+ public:
+  // Begins a new JSON trace file, naming the processes and the calculator
+  // tracks after the calculator_name list of the GraphTrace.
+  void StartFile(const GraphTrace& trace, std::string* result);
+
+  // Appends the events of a GraphTrace to the current JSON trace file.
+  // The GraphTrace may be built by TraceBuilder::CreateTrace or by
+  // TraceBuilder::CreateLog.
+  void AppendTrace(const GraphTrace& trace, std::string* result);
+
+ private:
+  // Identifies the output of one packet from one stream.
+  using PacketKey = std::pair<int32, int64>;
+  // Identifies the start event of one calculator task.
+  using TaskKey = std::tuple<int32, int64, int>;
+  // The calculator task that produced a packet.
+  struct Producer {
+    int32 node_id;
+    int64 time;
+  };
+
+  // Appends the events for one CalculatorTrace.
+  void AppendCalculatorTrace(const GraphTrace& trace,
+                             const GraphTrace::CalculatorTrace& task,
+                             std::string* result);
+
+  // Appends a thread name event for a thread seen for the first time.
+  void AppendThreadName(int32 thread_id, std::string* result);
+
+  // Returns the name of a calculator node or of a stream.
+  std::string CalculatorName(int32 node_id) const;
+  static std::string StreamName(const GraphTrace& trace, int32 stream_id);
+
+  // Returns the producer recorded for a packet, or nullptr.
+  const Producer* FindProducer(const PacketKey& key) const;
+
+  // The calculator names for the current file.
+  std::vector<std::string> calculator_names_;
+  // The threads already named in the current file.
+  absl::flat_hash_set<int32> named_threads_;
+  // The producers of the packets output in the current and previous
+  // GraphTrace, so that flows can cross one GraphTrace boundary.
+  absl::flat_hash_map<PacketKey, Producer> producers_;
+  absl::flat_hash_map<PacketKey, Producer> previous_producers_;
+  // The start times of tasks logged as separate start and finish events.
+  absl::flat_hash_map<TaskKey, int64> task_starts_;
+  absl::flat_hash_map<TaskKey, int64> previous_task_starts_;
+  // The identifier for the next flow arrow.
+  int64 next_flow_id_ = 1;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PROFILER_CHROME_TRACE_BUILDER_H_
@@ -0,0 +1,157 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/chrome_trace_builder.h"
+
+#include <string>
+
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+
+namespace mediapipe {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::Not;
+using ::testing::StartsWith;
+
+// A trace of two calculators passing one packet, as built by CreateTrace.
+GraphTrace PassThroughTrace() {
+  return ParseTextProtoOrDie<GraphTrace>(R"(
+    base_time: 1000000
+    base_timestamp: 10000
+    calculator_name: "Source"
+    calculator_name: "Sink"
+    stream_name: ""
+    stream_name: "input_0"
+    calculator_trace {
+      node_id: 0
+      input_timestamp: 0
+      event_type: PROCESS
+      start_time: 100
+      finish_time: 150
+      thread_id: 3
+      output_trace { packet_timestamp: 0 stream_id: 1 }
+    }
+    calculator_trace {
+      node_id: 1
+      input_timestamp: 0
+      event_type: PACKET_QUEUED
+      input_trace {
+        finish_time: 160
+        packet_timestamp: 0
+        stream_id: 1
+        event_data: 2
+      }
+    }
+    calculator_trace {
+      node_id: 1
+      input_timestamp: 0
+      event_type: PROCESS
+      start_time: 200
+      finish_time: 260
+      thread_id: 4
+      input_trace {
+        start_time: 150
+        finish_time: 200
+        packet_timestamp: 0
+        stream_id: 1
+      }
+    }
+    calculator_trace {
+      node_id: 1
+      input_timestamp: 0
+      event_type: THROTTLED
+      start_time: 270
+    }
+  )");
+}
+
+TEST(ChromeTraceBuilderTest, NamesProcessesAndCalculators) {
+  ChromeTraceBuilder builder;
+  std::string json;
+  builder.StartFile(PassThroughTrace(), &json);
+  EXPECT_THAT(json, StartsWith("[\n"));
+  EXPECT_THAT(json, HasSubstr(R"({"ph":"M","name":"process_name","pid":2,)"
+                              R"("tid":0,"args":{"name":"Calculators"}})"));
+  EXPECT_THAT(json, HasSubstr(R"({"ph":"M","name":"thread_name","pid":2,)"
+                              R"("tid":1,"args":{"name":"Sink"}})"));
+}
+
+TEST(ChromeTraceBuilderTest, WritesTracksFlowsAndCounters) {
+  ChromeTraceBuilder builder;
+  std::string json;
+  GraphTrace trace = PassThroughTrace();
+  builder.StartFile(trace, &json);
+  builder.AppendTrace(trace, &json);
+
+  // One slice on the thread track and one on the calculator track.
+  EXPECT_THAT(json, HasSubstr(R"({"ph":"X","pid":1,"tid":4,"name":"Sink",)"
+                              R"("cat":"PROCESS","ts":200,"dur":60,)"
+                              R"("args":{"input_timestamp":10000}})"));
+  EXPECT_THAT(json, HasSubstr(R"({"ph":"X","pid":2,"tid":1,"name":"PROCESS",)"
+                              R"("cat":"PROCESS","ts":200,"dur":60,)"));
+  EXPECT_THAT(json, HasSubstr(R"({"ph":"M","name":"thread_name","pid":1,)"
+                              R"("tid":3,"args":{"name":"Thread 3"}})"));
+
+  // The flow arrow runs from the source task to the sink task.
+  EXPECT_THAT(json, HasSubstr(R"({"ph":"s","bp":"e","id":1,"pid":2,"tid":0,)"
+                              R"("name":"input_0","cat":"packet","ts":100})"));
+  EXPECT_THAT(json, HasSubstr(R"({"ph":"f","bp":"e","id":1,"pid":2,"tid":1,)"
+                              R"("name":"input_0","cat":"packet","ts":200})"));
+
+  EXPECT_THAT(json, HasSubstr(R"({"ph":"C","pid":2,"name":"input_0 queue",)"
+                              R"("ts":160,"args":{"size":2}})"));
+  EXPECT_THAT(json, HasSubstr(R"({"ph":"i","s":"t","pid":2,"tid":1,)"
+                              R"("name":"THROTTLED","ts":270})"));
+}
+
+TEST(ChromeTraceBuilderTest, JoinsDurationEventsAcrossTraces) {
+  ChromeTraceBuilder builder;
+  std::string json;
+  GraphTrace trace = PassThroughTrace();
+  trace.clear_calculator_trace();
+  builder.StartFile(trace, &json);
+
+  GraphTrace start_trace = trace;
+  start_trace.add_calculator_trace()->CopyFrom(
+      ParseTextProtoOrDie<GraphTrace::CalculatorTrace>(R"(
+        node_id: 1 input_timestamp: 5 event_type: PROCESS start_time: 300
+      )"));
+  builder.AppendTrace(start_trace, &json);
+  EXPECT_THAT(json, Not(HasSubstr(R"("ph":"X")")));
+
+  GraphTrace finish_trace = trace;
+  finish_trace.add_calculator_trace()->CopyFrom(
+      ParseTextProtoOrDie<GraphTrace::CalculatorTrace>(R"(
+        node_id: 1 input_timestamp: 5 event_type: PROCESS finish_time: 340
+      )"));
+  builder.AppendTrace(finish_trace, &json);
+  EXPECT_THAT(json, HasSubstr(R"({"ph":"X","pid":2,"tid":1,"name":"PROCESS",)"
+                              R"("cat":"PROCESS","ts":300,"dur":40,)"));
+}
+
+TEST(ChromeTraceBuilderTest, EscapesNames) {
+  ChromeTraceBuilder builder;
+  std::string json;
+  GraphTrace trace;
+  trace.add_calculator_name("a\"b\\c");
+  builder.StartFile(trace, &json);
+  EXPECT_THAT(json, HasSubstr(R"("args":{"name":"a\"b\\c"})"));
+}
+
+}  // namespace
+}  // namespace mediapipe
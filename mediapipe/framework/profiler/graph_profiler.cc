@@ -131,6 +131,8 @@ void GraphProfiler::Initialize(
   if (IsTracerEnabled(profiler_config_)) {
     packet_tracer_ = absl::make_unique<GraphTracer>(profiler_config_);
   }
+  is_sampling_ = profiler_config_.process_sample_interval() > 0 &&
+                 !profiler_config_.enable_stream_latency();
   for (int node_id = 0;
        node_id < validated_graph_config.CalculatorInfos().size(); ++node_id) {
     std::string node_name =
@@ -155,6 +157,11 @@ void GraphProfiler::Initialize(
     auto iter = calculator_profiles_.insert({node_name, profile});
     CHECK(iter.second) << absl::Substitute(
         "Calculator \"$0\" has already been added.", node_name);
+    node_ids_[node_name] = node_id;
+    if (is_sampling_) {
+      process_samplers_.push_back(
+          absl::make_unique<ProcessSampler>(interval_size_usec, num_intervals));
+    }
   }
   is_initialized_ = true;
 }
@@ -196,6 +203,9 @@ void GraphProfiler::Reset() {
       ResetTimeHistogram(input_stream_profile.mutable_latency());
     }
   }
+  for (auto& sampler : process_samplers_) {
+    sampler->runtime.Reset();
+  }
 }
 
 // Begins profiling for a single graph run.
@@ -284,10 +294,24 @@ void GraphProfiler::AddPacketInfo(const TraceEvent& packet_info) {
       << "GetCalculatorProfiles can only be called after Initialize()";
   for (auto& entry : calculator_profiles_) {
     profiles->push_back(entry.second);
+    int node_id = node_ids_.at(entry.first);
+    if (is_sampling_) {
+      process_samplers_[node_id]->runtime.AddTo(
+          profiler_config_.process_sample_interval(),
+          profiles->back().mutable_process_runtime());
+    }
+    if (queue_stats_callback_) {
+      queue_stats_callback_(node_id, &profiles->back());
+    }
   }
   return ::mediapipe::OkStatus();
 }
 
+void GraphProfiler::SetQueueStatsCallback(QueueStatsCallback callback) {
+  absl::WriterMutexLock lock(&profiler_mutex_);
+  queue_stats_callback_ = std::move(callback);
+}
+
 void GraphProfiler::InitializeTimeHistogram(int64 interval_size_usec,
                                             int64 num_intervals,
                                             TimeHistogram* histogram) {
@@ -506,6 +530,11 @@ void GraphProfiler::AddProcessSample(
   }
 }
 
+void GraphProfiler::AddSampledProcessRuntime(
+    const CalculatorContext& calculator_context, int64 time_usec) {
+  process_samplers_[calculator_context.NodeId()]->runtime.AddSample(time_usec);
+}
+
 std::unique_ptr<GlProfilingHelper> GraphProfiler::CreateGlProfilingHelper() {
   if (!IsTracerEnabled(profiler_config_)) {
     return nullptr;
@@ -619,14 +648,27 @@ void AssignNodeNames(GraphProfile* profile) {
   }
 
   // Write the GraphProfile to the trace_log_path.
+  bool chrome_json = profiler_config_.trace_log_chrome_json();
   int log_index = previous_log_index_ / log_interval_count % log_file_count;
-  std::string log_path = absl::StrCat(trace_log_path, log_index, ".binarypb");
+  std::string log_path = absl::StrCat(trace_log_path, log_index,
+                                      chrome_json ? ".json" : ".binarypb");
   std::ofstream ofs;
   if (is_new_file) {
     ofs.open(log_path, std::ofstream::out | std::ofstream::trunc);
   } else {
     ofs.open(log_path, std::ofstream::out | std::ofstream::app);
   }
+  if (chrome_json) {
+    // Each interval appends its events to the open JSON array.
+    std::string json;
+    if (is_new_file) {
+      chrome_trace_builder_.StartFile(*trace, &json);
+    }
+    chrome_trace_builder_.AppendTrace(*trace, &json);
+    ofs << json;
+    RET_CHECK(ofs.good()) << "Could not write Chrome trace to: " << log_path;
+    return status;
+  }
   OstreamStream out(&ofs);
   RET_CHECK(profile.SerializeToZeroCopyStream(&out))
       << "Could not write binary GraphProfile to: " << log_path;
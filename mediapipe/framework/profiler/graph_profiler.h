@@ -17,6 +17,8 @@
 
 #include <atomic>
 #include <cstddef>
+#include <functional>
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
@@ -30,7 +32,9 @@
 #include "mediapipe/framework/deps/monotonic_clock.h"
 #include "mediapipe/framework/executor.h"
 #include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/profiler/chrome_trace_builder.h"
 #include "mediapipe/framework/profiler/graph_tracer.h"
+#include "mediapipe/framework/profiler/sharded_histogram.h"
 #include "mediapipe/framework/profiler/sharded_map.h"
 #include "mediapipe/framework/validated_graph_config.h"
 
@@ -88,6 +92,9 @@ class GraphProfilerTestPeer;
 //     enable_profiler: true
 //   }
 //
+// For always-on profiling, process_sample_interval limits the overhead by
+// timing only one in every N Process() calls of each calculator.
+//
 // Because the graph definition affects the stream profiling and the profiler is
 // singleton, the profiler can not be used with more than one graph. Thus the
 // profiler disables itself and returns an empty stub if Initialize() is called
@@ -153,6 +160,14 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
   ::mediapipe::Status GetCalculatorProfiles(std::vector<CalculatorProfile>*)
       const ABSL_LOCKS_EXCLUDED(profiler_mutex_);
 
+  // Sets the function that GetCalculatorProfiles() calls to fill in the queue
+  // statistics of the profile of each node. The graph sets it, since it owns
+  // the input streams.
+  using QueueStatsCallback =
+      std::function<void(int node_id, CalculatorProfile* profile)>;
+  void SetQueueStatsCallback(QueueStatsCallback callback)
+      ABSL_LOCKS_EXCLUDED(profiler_mutex_);
+
   // Writes recent profiling and tracing data to a file specified in the
   // ProfilerConfig.  Includes events since the previous call to WriteProfile.
   ::mediapipe::Status WriteProfile();
@@ -178,7 +193,11 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
         : calculator_method_(event_type),
           calculator_context_(*calculator_context),
           profiler_(profiler) {
-      start_time_usec_ = profiler_->TimeNowUsec();
+      is_profiled_ =
+          profiler_->ShouldProfile(calculator_method_, calculator_context_);
+      if (is_profiled_ || profiler_->is_tracing_) {
+        start_time_usec_ = profiler_->TimeNowUsec();
+      }
       if (profiler_->is_tracing_) {
         absl::Time time_now = absl::FromUnixMicros(start_time_usec_);
         profiler_->packet_tracer_->LogInputEvents(
@@ -188,11 +207,10 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
 
     inline ~Scope() {
       int64 end_time_usec;
-      if (profiler_->is_profiling_ || profiler_->is_tracing_) {
+      if (is_profiled_ || profiler_->is_tracing_) {
         end_time_usec = profiler_->TimeNowUsec();
       }
-      if (profiler_->is_profiling_) {
-        int64 end_time_usec = profiler_->TimeNowUsec();
+      if (is_profiled_) {
         switch (calculator_method_) {
           case GraphTrace::OPEN:
             profiler_->SetOpenRuntime(calculator_context_, start_time_usec_,
@@ -200,8 +218,13 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
             break;
 
           case GraphTrace::PROCESS:
-            profiler_->AddProcessSample(calculator_context_, start_time_usec_,
-                                        end_time_usec);
+            if (profiler_->is_sampling_) {
+              profiler_->AddSampledProcessRuntime(
+                  calculator_context_, end_time_usec - start_time_usec_);
+            } else {
+              profiler_->AddProcessSample(calculator_context_,
+                                          start_time_usec_, end_time_usec);
+            }
             break;
 
           case GraphTrace::CLOSE:
@@ -224,6 +247,7 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
     const CalculatorContext& calculator_context_;
     GraphProfiler* profiler_;
     int64 start_time_usec_;
+    bool is_profiled_;
   };
 
  private:
@@ -291,6 +315,28 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
                         int64 start_time_usec, int64 end_time_usec)
       ABSL_LOCKS_EXCLUDED(profiler_mutex_);
 
+  // Returns true if the runtime of a calculator method call is recorded.
+  // With process_sample_interval, only one in every process_sample_interval
+  // Process() calls of each calculator is recorded.
+  inline bool ShouldProfile(GraphTrace::EventType calculator_method,
+                            const CalculatorContext& calculator_context) {
+    if (!is_profiling_) {
+      return false;
+    }
+    if (calculator_method != GraphTrace::PROCESS || !is_sampling_) {
+      return true;
+    }
+    std::atomic<int64>& call_count =
+        process_samplers_[calculator_context.NodeId()]->call_count;
+    return call_count.fetch_add(1, std::memory_order_relaxed) %
+               profiler_config_.process_sample_interval() ==
+           0;
+  }
+
+  // Records the runtime of a sampled Process() call without locking.
+  void AddSampledProcessRuntime(const CalculatorContext& calculator_context,
+                                int64 time_usec);
+
   // Helper method to get trace_log_path.  If the trace_log_path is empty and
   // tracing is enabled, this function returns a default platform dependent
   // trace_log_path.
@@ -312,9 +358,27 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
   // If true, the tracer records timing events.
   std::atomic_bool is_tracing_;
 
+  // If true, Process() runtimes are sampled, and are recorded in
+  // |process_samplers_| rather than in |calculator_profiles_|.
+  bool is_sampling_ = false;
+
   // Stores all the calculator profiles with the calculator name as the key.
   using CalculatorProfileMap = ShardedMap<std::string, CalculatorProfile>;
   CalculatorProfileMap calculator_profiles_;
+
+  // The sampled Process() runtimes of one calculator.
+  struct ProcessSampler {
+    ProcessSampler(int64 interval_size_usec, int64 num_intervals)
+        : runtime(interval_size_usec, num_intervals) {}
+    std::atomic<int64> call_count{0};
+    ShardedHistogram runtime;
+  };
+  // The sampled Process() runtimes indexed by node id.
+  std::vector<std::unique_ptr<ProcessSampler>> process_samplers_;
+  // Maps each calculator name to its node id.
+  std::map<std::string, int> node_ids_;
+  // Fills in the queue statistics of the calculator profiles.
+  QueueStatsCallback queue_stats_callback_;
   // Stores the production time of a packet, based on profiler's clock.
   using PacketInfoMap =
       ShardedMap<std::string, std::list<std::pair<int64, PacketInfo>>>;
@@ -338,6 +402,9 @@ class GraphProfiler : public std::enable_shared_from_this<ProfilingContext> {
   // The index number of the previous output log.
   int previous_log_index_;
 
+  // Converts the trace log output to Chrome trace-event JSON.
+  ChromeTraceBuilder chrome_trace_builder_;
+
   // The configuration for the graph being profiled.
   const ValidatedGraphConfig* validated_graph_;
 
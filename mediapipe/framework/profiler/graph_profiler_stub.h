@@ -15,6 +15,8 @@
 #ifndef MEDIAPIPE_FRAMEWORK_PROFILER_MEDIAPIPE_PROFILER_STUB_H_
 #define MEDIAPIPE_FRAMEWORK_PROFILER_MEDIAPIPE_PROFILER_STUB_H_
 
+#include <functional>
+
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/timestamp.h"
 
@@ -85,6 +87,9 @@ class GraphProfilerStub {
       std::vector<CalculatorProfile>*) const {
     return mediapipe::OkStatus();
   }
+  using QueueStatsCallback =
+      std::function<void(int node_id, CalculatorProfile* profile)>;
+  inline void SetQueueStatsCallback(QueueStatsCallback callback) {}
   inline void Pause() {}
   inline void Resume() {}
   inline void Reset() {}
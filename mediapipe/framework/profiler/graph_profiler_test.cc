@@ -1016,6 +1016,56 @@ TEST_F(GraphProfilerTestPeer, AddProcessSample) {
   ASSERT_EQ(GetPacketsInfoMap()->size(), 0);
 }
 
+// Tests that process_sample_interval times one in every N Process() calls,
+// and scales up the process_runtime histogram to estimate all calls.
+TEST_F(GraphProfilerTestPeer, SampleProcessRuntime) {
+  InitializeProfilerWithGraphConfig(R"(
+    profiler_config {
+      enable_profiler: true
+      process_sample_interval: 2
+    }
+    input_stream: "input_stream"
+    node {
+      calculator: "DummyTestCalculator"
+      input_stream: "input_stream"
+      output_stream: "output_stream"
+    })");
+  std::shared_ptr<mediapipe::SimulationClock> simulation_clock(
+      new SimulationClock());
+  simulation_clock->ThreadStart();
+  profiler_.SetClock(simulation_clock);
+
+  TestContextBuilder context(kDummyTestCalculatorName, /*node_id=*/0,
+                             {"input_stream"}, {"output_stream"});
+  context.AddInputs({MakePacket<std::string>("5").At(Timestamp(100))});
+  context.AddOutputs({{MakePacket<std::string>("15").At(Timestamp(100))}});
+
+  // The first and the third calls are timed.
+  for (int64 runtime_usec : {150, 10, 250}) {
+    GraphProfiler::Scope profiler_scope(GraphTrace::PROCESS, context.get(),
+                                        &profiler_);
+    simulation_clock->Sleep(absl::Microseconds(runtime_usec));
+  }
+
+  std::vector<CalculatorProfile> profiles = Profiles();
+  simulation_clock->ThreadFinish();
+
+  ASSERT_EQ(profiles.size(), 1);
+  EXPECT_THAT(profiles[0], EqualsProto(R"(
+                name: "DummyTestCalculator"
+                process_runtime {
+                  total: 800
+                  interval_size_usec: 1000000
+                  num_intervals: 1
+                  count: 4
+                }
+              )"));
+  // The sampled runtimes are not recorded in the profile map.
+  EXPECT_EQ(
+      FindCalculatorProfile(kDummyTestCalculatorName).process_runtime().total(),
+      0);
+}
+
 // Tests that AddProcessSample() updates |process_runtime| and also updates the
 // packet info map when stream latency is enabled.
 TEST_F(GraphProfilerTestPeer, AddProcessSampleWithStreamLatency) {
@@ -0,0 +1,88 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/sharded_histogram.h"
+
+#include <algorithm>
+
+#include "mediapipe/framework/port/logging.h"
+
+namespace mediapipe {
+
+namespace {
+
+// The number of int64 counters in a cache line.
+constexpr int kCountersPerCacheLine = 64 / sizeof(int64);
+
+// Returns a small number identifying the current thread.
+int ThreadIndex() {
+  static std::atomic<int> next_index(0);
+  static thread_local int index =
+      next_index.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+}  // namespace
+
+ShardedHistogram::ShardedHistogram(int64 interval_size_usec,
+                                   int64 num_intervals, int num_shards)
+    : interval_size_usec_(interval_size_usec),
+      num_intervals_(num_intervals),
+      num_shards_(num_shards),
+      // Each shard is followed by one unused cache line, since new[] does not
+      // align the counters to cache lines.
+      shard_size_((num_intervals + kCountersPerCacheLine) /
+                      kCountersPerCacheLine * kCountersPerCacheLine +
+                  kCountersPerCacheLine),
+      counters_(new std::atomic<int64>[num_shards * shard_size_]) {
+  CHECK_GT(interval_size_usec_, 0);
+  CHECK_GT(num_intervals_, 0);
+  CHECK_GT(num_shards_, 0);
+  Reset();
+}
+
+std::atomic<int64>* ShardedHistogram::ThreadShard() {
+  return &counters_[ThreadIndex() % num_shards_ * shard_size_];
+}
+
+void ShardedHistogram::AddSample(int64 time_usec) {
+  CHECK_GE(time_usec, 0);
+  int64 interval_index =
+      std::min(time_usec / interval_size_usec_, num_intervals_ - 1);
+  std::atomic<int64>* shard = ThreadShard();
+  shard[0].fetch_add(time_usec, std::memory_order_relaxed);
+  shard[1 + interval_index].fetch_add(1, std::memory_order_relaxed);
+}
+
+void ShardedHistogram::AddTo(int64 scale, TimeHistogram* histogram) const {
+  CHECK_EQ(histogram->count_size(), num_intervals_);
+  for (int s = 0; s < num_shards_; ++s) {
+    const std::atomic<int64>* shard = &counters_[s * shard_size_];
+    histogram->set_total(histogram->total() +
+                         shard[0].load(std::memory_order_relaxed) * scale);
+    for (int i = 0; i < num_intervals_; ++i) {
+      histogram->set_count(
+          i, histogram->count(i) +
+                 shard[1 + i].load(std::memory_order_relaxed) * scale);
+    }
+  }
+}
+
+void ShardedHistogram::Reset() {
+  for (int i = 0; i < num_shards_ * shard_size_; ++i) {
+    counters_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,67 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PROFILER_SHARDED_HISTOGRAM_H_
+#define MEDIAPIPE_FRAMEWORK_PROFILER_SHARDED_HISTOGRAM_H_
+
+#include <atomic>
+#include <memory>
+
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+// A TimeHistogram that many threads can update without locking.
+//
+// Each thread adds samples to one of |num_shards| sets of atomic counters,
+// so that threads rarely write to the same cache line.  The shards are
+// summed only when the histogram is read, so a read may see only part of a
+// sample that is being added concurrently.
+class ShardedHistogram {
+ public:
+  // Creates a histogram with the layout of TimeHistogram.
+  ShardedHistogram(int64 interval_size_usec, int64 num_intervals,
+                   int num_shards = 16);
+
+  // Not copyable or movable.
+  ShardedHistogram(const ShardedHistogram&) = delete;
+  ShardedHistogram& operator=(const ShardedHistogram&) = delete;
+
+  // Records one duration.
+  void AddSample(int64 time_usec);
+
+  // Adds the recorded totals and counts, each multiplied by |scale|, to
+  // |histogram|, which must have the same number of intervals.
+  void AddTo(int64 scale, TimeHistogram* histogram) const;
+
+  // Discards the recorded samples.
+  void Reset();
+
+ private:
+  // Returns the first counter of the shard used by the current thread.
+  std::atomic<int64>* ThreadShard();
+
+  const int64 interval_size_usec_;
+  const int64 num_intervals_;
+  const int num_shards_;
+  // The number of counters per shard, including padding.  The
+  // first counter of each shard is the total time, followed by the counts.
+  const int shard_size_;
+  std::unique_ptr<std::atomic<int64>[]> counters_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PROFILER_SHARDED_HISTOGRAM_H_
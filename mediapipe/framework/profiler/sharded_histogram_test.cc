@@ -0,0 +1,75 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/sharded_histogram.h"
+
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+namespace {
+
+// Returns an empty TimeHistogram with |num_intervals| counts.
+TimeHistogram EmptyHistogram(int num_intervals) {
+  TimeHistogram result;
+  result.mutable_count()->Resize(num_intervals, /*value=*/0);
+  return result;
+}
+
+TEST(ShardedHistogramTest, AddsScaledSamples) {
+  ShardedHistogram histogram(/*interval_size_usec=*/100, /*num_intervals=*/3);
+  histogram.AddSample(50);
+  histogram.AddSample(150);
+  histogram.AddSample(1000);
+  TimeHistogram result = EmptyHistogram(3);
+  histogram.AddTo(/*scale=*/2, &result);
+  EXPECT_EQ(2400, result.total());
+  EXPECT_EQ(2, result.count(0));
+  EXPECT_EQ(2, result.count(1));
+  EXPECT_EQ(2, result.count(2));
+
+  histogram.Reset();
+  result = EmptyHistogram(3);
+  histogram.AddTo(/*scale=*/1, &result);
+  EXPECT_EQ(0, result.total());
+  EXPECT_EQ(0, result.count(2));
+}
+
+TEST(ShardedHistogramTest, MergesThreadShards) {
+  const int kNumThreads = 8;
+  const int kNumSamples = 1000;
+  ShardedHistogram histogram(/*interval_size_usec=*/10, /*num_intervals=*/2,
+                             /*num_shards=*/4);
+  {
+    ::mediapipe::ThreadPool pool(kNumThreads);
+    pool.StartWorkers();
+    for (int i = 0; i < kNumThreads; ++i) {
+      pool.Schedule([&histogram]() {
+        for (int j = 0; j < kNumSamples; ++j) {
+          histogram.AddSample(j % 2 * 10);
+        }
+      });
+    }
+  }
+  TimeHistogram result = EmptyHistogram(2);
+  histogram.AddTo(/*scale=*/1, &result);
+  EXPECT_EQ(kNumThreads * kNumSamples / 2 * 10, result.total());
+  EXPECT_EQ(kNumThreads * kNumSamples / 2, result.count(0));
+  EXPECT_EQ(kNumThreads * kNumSamples / 2, result.count(1));
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,301 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/trace_analysis.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+
+namespace mediapipe {
+
+namespace {
+
+// One Process() call, or one packet added to a graph input stream.
+struct Task {
+  int node_id;
+  int64 input_timestamp;
+  int64 start_time;
+  int64 finish_time;
+  // The stream id and packet timestamp of each input packet.
+  std::vector<std::pair<int32, int64>> inputs;
+};
+
+// The intervals during which at least one input stream was full.
+class ThrottledIntervals {
+ public:
+  // Builds the intervals from THROTTLED and UNTHROTTLED event times.
+  explicit ThrottledIntervals(std::vector<std::pair<int64, int>> changes) {
+    std::sort(changes.begin(), changes.end());
+    int full_streams = 0;
+    int64 begin = 0;
+    for (const auto& change : changes) {
+      if (full_streams == 0 && change.second > 0) {
+        begin = change.first;
+      }
+      full_streams = std::max(0, full_streams + change.second);
+      if (full_streams == 0 && change.second < 0) {
+        intervals_.push_back({begin, change.first});
+      }
+    }
+    if (full_streams > 0) {
+      intervals_.push_back({begin, std::numeric_limits<int64>::max()});
+    }
+  }
+
+  // Returns the time within [begin, end) during which a stream was full.
+  int64 Overlap(int64 begin, int64 end) const {
+    int64 result = 0;
+    for (const auto& interval : intervals_) {
+      int64 lo = std::max(begin, interval.first);
+      int64 hi = std::min(end, interval.second);
+      result += std::max<int64>(0, hi - lo);
+    }
+    return result;
+  }
+
+ private:
+  std::vector<std::pair<int64, int64>> intervals_;
+};
+
+// Maps each output packet, identified by stream id and packet timestamp, to
+// the index of the task that produced it.
+using ProducerMap = absl::flat_hash_map<std::pair<int32, int64>, int>;
+
+// Returns the Process() tasks and the graph input packets in the profile,
+// with their output packets and the throttling changes.
+std::vector<Task> CollectTasks(const GraphProfile& profile,
+                               ProducerMap* producers,
+                               std::vector<std::pair<int64, int>>* changes) {
+  std::vector<Task> tasks;
+  for (const GraphTrace& trace : profile.graph_trace()) {
+    for (const GraphTrace::CalculatorTrace& t : trace.calculator_trace()) {
+      if (t.event_type() == GraphTrace::THROTTLED) {
+        changes->push_back({t.start_time(), 1});
+      } else if (t.event_type() == GraphTrace::UNTHROTTLED) {
+        changes->push_back({t.start_time(), -1});
+      }
+      if (t.event_type() != GraphTrace::PROCESS || !t.has_finish_time()) {
+        continue;
+      }
+      Task task;
+      task.node_id = t.node_id();
+      task.input_timestamp = trace.base_timestamp() + t.input_timestamp();
+      task.finish_time = t.finish_time();
+      task.start_time = t.has_start_time() ? t.start_time() : t.finish_time();
+      for (const GraphTrace::StreamTrace& input : t.input_trace()) {
+        task.inputs.push_back({input.stream_id(), input.packet_timestamp()});
+      }
+      for (const GraphTrace::StreamTrace& output : t.output_trace()) {
+        (*producers)[{output.stream_id(), output.packet_timestamp()}] =
+            tasks.size();
+      }
+      tasks.push_back(std::move(task));
+    }
+  }
+  return tasks;
+}
+
+// Returns the calculator names, indexed by node id.
+std::vector<std::string> CalculatorNames(const GraphProfile& profile) {
+  for (const GraphTrace& trace : profile.graph_trace()) {
+    if (trace.calculator_name_size() > 0) {
+      return {trace.calculator_name().begin(), trace.calculator_name().end()};
+    }
+  }
+  std::vector<std::string> result;
+  for (int i = 0; i < profile.config().node_size(); ++i) {
+    result.push_back(absl::StrCat("node_", i));
+  }
+  return result;
+}
+
+// Returns |part| as a percentage of |whole|.
+double Percent(int64 part, int64 whole) {
+  return whole > 0 ? 100.0 * part / whole : 0;
+}
+
+}  // namespace
+
+TraceAnalysis AnalyzeGraphProfile(const GraphProfile& profile) {
+  TraceAnalysis result;
+  ProducerMap producers;
+  std::vector<std::pair<int64, int>> changes;
+  std::vector<Task> tasks = CollectTasks(profile, &producers, &changes);
+  ThrottledIntervals throttled(std::move(changes));
+
+  // Find the last task for each timestamp.
+  std::map<int64, int> last_tasks;
+  std::vector<std::string> names = CalculatorNames(profile);
+  int num_nodes = names.size();
+  int64 begin_time = std::numeric_limits<int64>::max();
+  int64 end_time = std::numeric_limits<int64>::min();
+  for (int i = 0; i < tasks.size(); ++i) {
+    const Task& task = tasks[i];
+    if (task.node_id < 0) {
+      continue;
+    }
+    num_nodes = std::max(num_nodes, task.node_id + 1);
+    begin_time = std::min(begin_time, task.start_time);
+    end_time = std::max(end_time, task.finish_time);
+    auto it = last_tasks.find(task.input_timestamp);
+    if (it == last_tasks.end() ||
+        tasks[it->second].finish_time < task.finish_time) {
+      last_tasks[task.input_timestamp] = i;
+    }
+  }
+  result.duration = end_time > begin_time ? end_time - begin_time : 0;
+
+  result.calculators.resize(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    result.calculators[i].name =
+        i < names.size() ? names[i] : absl::StrCat("node_", i);
+  }
+  for (const Task& task : tasks) {
+    if (task.node_id >= 0) {
+      CalculatorAnalysis& calculator = result.calculators[task.node_id];
+      ++calculator.task_count;
+      calculator.busy_time += task.finish_time - task.start_time;
+    }
+  }
+
+  // Walk back from the last task of each timestamp.
+  for (const auto& entry : last_tasks) {
+    TimestampPath path;
+    path.timestamp = entry.first;
+    int task_index = entry.second;
+    int64 path_begin = tasks[task_index].start_time;
+    for (int step = 0; step < tasks.size(); ++step) {
+      const Task& task = tasks[task_index];
+      if (task.node_id < 0) {
+        // A graph input packet begins the path.
+        path_begin = task.finish_time;
+        break;
+      }
+      CalculatorAnalysis& calculator = result.calculators[task.node_id];
+      path.node_ids.push_back(task.node_id);
+      path.compute_time += task.finish_time - task.start_time;
+      calculator.critical_compute_time += task.finish_time - task.start_time;
+      path_begin = task.start_time;
+
+      // The critical input is the input packet produced last.
+      int critical = -1;
+      for (const auto& input : task.inputs) {
+        auto it = producers.find(input);
+        if (it != producers.end() &&
+            (critical == -1 ||
+             tasks[it->second].finish_time > tasks[critical].finish_time)) {
+          critical = it->second;
+        }
+      }
+      if (critical == -1 || tasks[critical].finish_time > task.start_time) {
+        break;
+      }
+      int64 wait_begin = tasks[critical].finish_time;
+      int64 throttled_time = throttled.Overlap(wait_begin, task.start_time);
+      int64 queue_time = task.start_time - wait_begin - throttled_time;
+      path.queue_time += queue_time;
+      path.throttled_time += throttled_time;
+      calculator.critical_queue_time += queue_time;
+      calculator.critical_throttled_time += throttled_time;
+      task_index = critical;
+    }
+    path.latency = tasks[entry.second].finish_time - path_begin;
+    std::reverse(path.node_ids.begin(), path.node_ids.end());
+    result.paths.push_back(std::move(path));
+  }
+
+  // Find the throughput and the latency bottlenecks.
+  int64 max_critical_time = 0;
+  for (int i = 0; i < result.calculators.size(); ++i) {
+    CalculatorAnalysis& calculator = result.calculators[i];
+    if (result.duration > 0) {
+      calculator.utilization =
+          static_cast<double>(calculator.busy_time) / result.duration;
+    }
+    if (calculator.task_count > 0 &&
+        (result.throughput_bottleneck == -1 ||
+         calculator.utilization >
+             result.calculators[result.throughput_bottleneck].utilization)) {
+      result.throughput_bottleneck = i;
+    }
+    int64 critical_time = calculator.critical_compute_time +
+                          calculator.critical_queue_time +
+                          calculator.critical_throttled_time;
+    if (critical_time > max_critical_time) {
+      max_critical_time = critical_time;
+      result.latency_bottleneck = i;
+    }
+  }
+  return result;
+}
+
+std::string FormatTraceAnalysis(const TraceAnalysis& analysis) {
+  std::string result;
+  int64 latency = 0, compute = 0, queue = 0, throttled = 0;
+  for (const TimestampPath& path : analysis.paths) {
+    latency += path.latency;
+    compute += path.compute_time;
+    queue += path.queue_time;
+    throttled += path.throttled_time;
+  }
+  int64 count = std::max<int64>(analysis.paths.size(), 1);
+  absl::StrAppendFormat(&result, "Trace duration: %d usec, %d timestamps\n",
+                        analysis.duration, analysis.paths.size());
+  absl::StrAppendFormat(
+      &result,
+      "Mean critical path latency: %d usec (compute %.1f%%, queued %.1f%%, "
+      "throttled %.1f%%)\n\n",
+      latency / count, Percent(compute, latency), Percent(queue, latency),
+      Percent(throttled, latency));
+
+  absl::StrAppendFormat(&result, "%-32s %8s %7s %10s %10s %10s\n",
+                        "calculator", "calls", "busy", "compute", "queued",
+                        "throttled");
+  for (const CalculatorAnalysis& c : analysis.calculators) {
+    absl::StrAppendFormat(&result, "%-32s %8d %6.1f%% %10d %10d %10d\n",
+                          c.name, c.task_count, 100 * c.utilization,
+                          c.critical_compute_time / count,
+                          c.critical_queue_time / count,
+                          c.critical_throttled_time / count);
+  }
+  result +=
+      "(compute, queued and throttled are the mean usec per timestamp on the "
+      "critical path)\n\n";
+
+  if (analysis.throughput_bottleneck >= 0) {
+    const CalculatorAnalysis& c =
+        analysis.calculators[analysis.throughput_bottleneck];
+    absl::StrAppendFormat(&result, "Throughput bottleneck: %s (busy %.1f%%)\n",
+                          c.name, 100 * c.utilization);
+  }
+  if (analysis.latency_bottleneck >= 0) {
+    const CalculatorAnalysis& c =
+        analysis.calculators[analysis.latency_bottleneck];
+    absl::StrAppendFormat(
+        &result, "Latency bottleneck: %s (%.1f%% of critical path time)\n",
+        c.name,
+        Percent(c.critical_compute_time + c.critical_queue_time +
+                    c.critical_throttled_time,
+                latency));
+  }
+  return result;
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,92 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_PROFILER_TRACE_ANALYSIS_H_
+#define MEDIAPIPE_FRAMEWORK_PROFILER_TRACE_ANALYSIS_H_
+
+#include <string>
+#include <vector>
+
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+// The end-to-end latency of one packet timestamp, attributed along its
+// critical path.  All times are in microseconds.
+struct TimestampPath {
+  // The input timestamp of the last task for this timestamp.
+  int64 timestamp = 0;
+  // The time from the start of the path to the finish of its last task.
+  int64 latency = 0;
+  // The time spent in Process() calls along the path.
+  int64 compute_time = 0;
+  // The time packets waited in input streams along the path, excluding
+  // throttled time.
+  int64 queue_time = 0;
+  // The time packets waited while the graph was throttled by a full stream.
+  int64 throttled_time = 0;
+  // The node ids along the path, from first to last.
+  std::vector<int> node_ids;
+};
+
+// The timing of one calculator node over the whole trace.
+struct CalculatorAnalysis {
+  std::string name;
+  // The number of Process() calls and their total runtime.
+  int64 task_count = 0;
+  int64 busy_time = 0;
+  // The fraction of the trace duration spent in Process() calls.  Parallel
+  // calls may raise this above 1.
+  double utilization = 0;
+  // The time attributed to this node on the critical paths.
+  int64 critical_compute_time = 0;
+  int64 critical_queue_time = 0;
+  int64 critical_throttled_time = 0;
+};
+
+// The critical-path and stall analysis of a recorded graph trace.
+struct TraceAnalysis {
+  // The time from the first task start to the last task finish.
+  int64 duration = 0;
+  // One entry per packet timestamp, ordered by timestamp.
+  std::vector<TimestampPath> paths;
+  // One entry per calculator node, indexed by node id.
+  std::vector<CalculatorAnalysis> calculators;
+  // The node limiting throughput, which is the most utilized node.
+  int throughput_bottleneck = -1;
+  // The node limiting latency, which contributes the most time to the
+  // critical paths.
+  int latency_bottleneck = -1;
+};
+
+// Analyzes the GraphTraces of a GraphProfile, such as a trace log file
+// written by the GraphProfiler.  The traces must be built by
+// TraceBuilder::CreateTrace, which is the default unless
+// trace_log_duration_events is set.
+//
+// For each packet timestamp, the critical path ends at the Process() call
+// that finished last for that timestamp.  From there it steps back through
+// the input packet that was produced last, to the Process() call that
+// produced it, until it reaches a graph input or a source node.  Waiting
+// time between a packet's production and its consumer's start is counted as
+// throttled while any input stream is full, and as queueing otherwise.
+TraceAnalysis AnalyzeGraphProfile(const GraphProfile& profile);
+
+// Returns a human-readable report of a TraceAnalysis.
+std::string FormatTraceAnalysis(const TraceAnalysis& analysis);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_PROFILER_TRACE_ANALYSIS_H_
@@ -0,0 +1,131 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/profiler/trace_analysis.h"
+
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+
+namespace mediapipe {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+// A graph input packet passes through "Filter" and then "Sink", while the
+// graph is throttled between times 35 and 45.
+GraphProfile TwoNodeProfile() {
+  return ParseTextProtoOrDie<GraphProfile>(R"(
+    graph_trace {
+      base_timestamp: 1000
+      calculator_name: "Filter"
+      calculator_name: "Sink"
+      stream_name: ""
+      stream_name: "input"
+      stream_name: "filtered"
+      calculator_trace {
+        node_id: -1
+        input_timestamp: 0
+        event_type: PROCESS
+        finish_time: 0
+        output_trace { packet_timestamp: 0 stream_id: 1 }
+      }
+      calculator_trace {
+        node_id: 0
+        input_timestamp: 0
+        event_type: PROCESS
+        start_time: 10
+        finish_time: 30
+        input_trace {
+          start_time: 0
+          finish_time: 10
+          packet_timestamp: 0
+          stream_id: 1
+        }
+        output_trace { packet_timestamp: 0 stream_id: 2 }
+      }
+      calculator_trace { event_type: THROTTLED start_time: 35 }
+      calculator_trace { event_type: UNTHROTTLED start_time: 45 }
+    }
+    graph_trace {
+      base_timestamp: 1000
+      calculator_trace {
+        node_id: 1
+        input_timestamp: 0
+        event_type: PROCESS
+        start_time: 50
+        finish_time: 80
+        input_trace {
+          start_time: 30
+          finish_time: 50
+          packet_timestamp: 0
+          stream_id: 2
+        }
+      }
+    }
+  )");
+}
+
+TEST(TraceAnalysisTest, AttributesCriticalPathLatency) {
+  TraceAnalysis analysis = AnalyzeGraphProfile(TwoNodeProfile());
+  ASSERT_EQ(1, analysis.paths.size());
+  const TimestampPath& path = analysis.paths[0];
+  EXPECT_EQ(1000, path.timestamp);
+  EXPECT_THAT(path.node_ids, ElementsAre(0, 1));
+  EXPECT_EQ(80, path.latency);
+  EXPECT_EQ(50, path.compute_time);
+  EXPECT_EQ(20, path.queue_time);
+  EXPECT_EQ(10, path.throttled_time);
+
+  ASSERT_EQ(2, analysis.calculators.size());
+  const CalculatorAnalysis& sink = analysis.calculators[1];
+  EXPECT_EQ("Sink", sink.name);
+  EXPECT_EQ(1, sink.task_count);
+  EXPECT_EQ(30, sink.critical_compute_time);
+  EXPECT_EQ(10, sink.critical_queue_time);
+  EXPECT_EQ(10, sink.critical_throttled_time);
+  EXPECT_EQ(10, analysis.calculators[0].critical_queue_time);
+}
+
+TEST(TraceAnalysisTest, FindsBottlenecks) {
+  GraphProfile profile = TwoNodeProfile();
+  // A second, slow Filter call for a timestamp that the Sink drops.
+  *profile.mutable_graph_trace(1)->add_calculator_trace() =
+      ParseTextProtoOrDie<GraphTrace::CalculatorTrace>(R"(
+        node_id: 0 input_timestamp: 1 event_type: PROCESS
+        start_time: 30 finish_time: 90
+      )");
+  TraceAnalysis analysis = AnalyzeGraphProfile(profile);
+  EXPECT_EQ(80, analysis.duration);
+  EXPECT_DOUBLE_EQ(1.0, analysis.calculators[0].utilization);
+  EXPECT_EQ(0, analysis.throughput_bottleneck);
+
+  // The Filter contributes 20 + 10 usec to the first path, and 60 usec to
+  // the second, while the Sink contributes 50 usec.
+  EXPECT_EQ(2, analysis.paths.size());
+  EXPECT_EQ(0, analysis.latency_bottleneck);
+}
+
+TEST(TraceAnalysisTest, FormatsReport) {
+  std::string report =
+      FormatTraceAnalysis(AnalyzeGraphProfile(TwoNodeProfile()));
+  EXPECT_THAT(report, HasSubstr("Trace duration: 70 usec, 1 timestamps"));
+  EXPECT_THAT(report, HasSubstr("Throughput bottleneck: Sink"));
+  EXPECT_THAT(report, HasSubstr("Latency bottleneck: Sink (62.5%"));
+}
+
+}  // namespace
+}  // namespace mediapipe
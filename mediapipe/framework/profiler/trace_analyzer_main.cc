@@ -0,0 +1,72 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// A command line utility to report the critical paths and the bottleneck
+// calculators in a binary trace log file written by the GraphProfiler, such
+// as "mediapipe_trace_0.binarypb".
+
+#include <stdlib.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/canonical_errors.h"
+#include "mediapipe/framework/port/commandlineflags.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/profiler/trace_analysis.h"
+
+DEFINE_string(trace_log_file, "",
+              "A binary GraphProfile trace log file written by the "
+              "GraphProfiler.");
+
+#define EXIT_IF_ERROR(status) \
+  if (!status.ok()) {         \
+    LOG(ERROR) << status;     \
+    return EXIT_FAILURE;      \
+  }
+
+namespace mediapipe {
+
+// Reads a trace log file.  The GraphProfiler appends one GraphProfile per
+// trace log interval, and parsing the concatenation merges them into one
+// GraphProfile holding every GraphTrace.
+mediapipe::Status ReadTraceLog(const std::string& path, GraphProfile* result) {
+  std::ifstream ifs(path, std::ifstream::in | std::ifstream::binary);
+  RET_CHECK(ifs.is_open()) << "could not open trace log: " << path;
+  RET_CHECK(result->ParseFromIstream(&ifs))
+      << "could not parse binary GraphProfile: " << path;
+  return mediapipe::OkStatus();
+}
+
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_trace_log_file.empty()) {
+    LOG(ERROR) << ::mediapipe::InvalidArgumentError(
+        "--trace_log_file must be specified");
+    return EXIT_FAILURE;
+  }
+  mediapipe::GraphProfile profile;
+  EXIT_IF_ERROR(mediapipe::ReadTraceLog(FLAGS_trace_log_file, &profile));
+  std::cout << mediapipe::FormatTraceAnalysis(
+      mediapipe::AnalyzeGraphProfile(profile));
+  return EXIT_SUCCESS;
+}
@@ -16,8 +16,10 @@
 
 #include <memory>
 #include <queue>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 
+#include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
 #include "mediapipe/framework/calculator_node.h"
 #include "mediapipe/framework/executor.h"
@@ -87,24 +89,102 @@ bool SchedulerQueue::Item::operator<(const SchedulerQueue::Item& that) const {
 }
 
 void SchedulerQueue::Reset() {
-  absl::MutexLock lock(&mutex_);
-  num_pending_tasks_ = 0;
+  num_unfinished_items_ = 0;
   num_tasks_to_add_ = 0;
   running_count_ = 0;
 }
 
+void SchedulerQueue::RegisterNode(CalculatorNode* node) {
+  CHECK_EQ(num_unfinished_items_.load(), 0);
+  const int id = node->Id();
+  if (id >= static_cast<int>(open_buckets_.size())) {
+    open_buckets_.resize(id + 1);
+    process_buckets_.resize(id + 1);
+    // Bit positions depend on the number of buckets; all of them are empty.
+    bitmap_ = std::vector<std::atomic<uint64>>((2 * (id + 1) + 63) / 64);
+  }
+  if (!open_buckets_[id]) {
+    open_buckets_[id] = absl::make_unique<Bucket>(1);
+    process_buckets_[id] = absl::make_unique<Bucket>(node->MaxInFlight());
+  }
+}
+
 void SchedulerQueue::SetExecutor(Executor* executor) { executor_ = executor; }
 
-bool SchedulerQueue::IsIdle() {
-  VLOG(3) << "Scheduler queue empty: " << queue_.empty()
-          << ", # of pending tasks: " << num_pending_tasks_;
-  return queue_.empty() && num_pending_tasks_ == 0;
+SchedulerQueue::Bucket* SchedulerQueue::BucketForItem(const Item& item,
+                                                      int* bit) {
+  const int id = item.Node()->Id();
+  DCHECK_LT(id, static_cast<int>(open_buckets_.size()))
+      << item.Node()->DebugName() << " was not registered.";
+  if (item.IsOpenNode()) {
+    *bit = id;
+    return open_buckets_[id].get();
+  }
+  *bit = 2 * open_buckets_.size() - 1 - id;
+  return process_buckets_[id].get();
+}
+
+SchedulerQueue::Bucket* SchedulerQueue::BucketForBit(int bit) {
+  const int num_nodes = open_buckets_.size();
+  if (bit < num_nodes) return open_buckets_[bit].get();
+  return process_buckets_[2 * num_nodes - 1 - bit].get();
+}
+
+void SchedulerQueue::SetBit(int bit) {
+  std::atomic<uint64>& word = bitmap_[bit / 64];
+  const uint64 mask = uint64{1} << (bit % 64);
+  if (!(word.load() & mask)) word.fetch_or(mask);
+}
+
+void SchedulerQueue::ClearBit(int bit) {
+  bitmap_[bit / 64].fetch_and(~(uint64{1} << (bit % 64)));
+}
+
+void SchedulerQueue::PushToBucket(Item&& item) {
+  int bit;
+  Bucket* bucket = BucketForItem(item, &bit);
+  DCHECK_LT(bucket->size.load(), static_cast<int>(bucket->items.capacity()))
+      << "More items were queued for " << item.Node()->DebugName()
+      << " than its max_in_flight.";
+  // The bucket never holds more than max_in_flight items, so it only looks
+  // full while a pop of the item in the cell is still in progress.
+  while (!bucket->items.Push(item)) {
+    std::this_thread::yield();
+  }
+  bucket->size.fetch_add(1);
+  SetBit(bit);
+}
+
+bool SchedulerQueue::PopItem(Item* item) {
+  for (int word_index = 0; word_index < static_cast<int>(bitmap_.size());
+       ++word_index) {
+    uint64 word = bitmap_[word_index].load();
+    while (word) {
+      const int bit = word_index * 64 + __builtin_ctzll(word);
+      word &= word - 1;
+      Bucket* bucket = BucketForBit(bit);
+      if (!bucket->items.Pop(item)) continue;
+      if (bucket->size.fetch_sub(1) == 1) {
+        // The bucket may have become empty. A concurrent push increments
+        // size before setting the bit, so check again after clearing it.
+        ClearBit(bit);
+        if (bucket->size.load() > 0) SetBit(bit);
+      }
+      return true;
+    }
+  }
+  if (num_source_items_.load() == 0) return false;
+  absl::MutexLock lock(&source_mutex_);
+  if (source_queue_.empty()) return false;
+  *item = source_queue_.top();
+  source_queue_.pop();
+  num_source_items_.fetch_sub(1);
+  return true;
 }
 
 void SchedulerQueue::SetRunning(bool running) {
-  absl::MutexLock lock(&mutex_);
-  running_count_ += running ? 1 : -1;
-  DCHECK_LE(running_count_, 1);
+  const int running_count = running_count_.fetch_add(running ? 1 : -1);
+  DCHECK_LE(running_count + (running ? 1 : -1), 1);
 }
 
 void SchedulerQueue::AddNode(CalculatorNode* node, CalculatorContext* cc) {
@@ -132,29 +212,32 @@ void SchedulerQueue::AddNodeForOpen(CalculatorNode* node) {
 
 void SchedulerQueue::AddItemToQueue(Item&& item) {
   const CalculatorNode* node = item.Node();
-  bool was_idle;
-  int tasks_to_add = 0;
-  {
-    absl::MutexLock lock(&mutex_);
-    was_idle = IsIdle();
-    queue_.push(item);
-    ++num_tasks_to_add_;
-    VLOG(4) << node->DebugName() << " was added to the scheduler queue.";
-
-    // Now grab the tasks to execute while still holding the lock. This will
-    // gather any waiting tasks, in addition to the one we just added.
-    if (running_count_ > 0) {
-      tasks_to_add = GetTasksToSubmitToExecutor();
-    }
-  }
+  const bool was_idle = num_unfinished_items_.fetch_add(1) == 0;
   if (was_idle && idle_callback_) {
     // Became not idle.
     idle_callback_(false);
   }
-  // Note: this should be done after calling idle_callback_(false) above.
-  // This ensures that we never get an idle_callback_(true) that is not
-  // preceded by the corresponding idle_callback_(false). See the comments on
+  // Note: the item is queued only after calling idle_callback_(false) above,
+  // so that no task can run it and report the queue idle before that. This
+  // ensures that we never get an idle_callback_(true) that is not preceded by
+  // the corresponding idle_callback_(false). See the comments on
   // SetIdleCallback for details.
+  if (!item.IsOpenNode() && item.Node()->IsSource()) {
+    absl::MutexLock lock(&source_mutex_);
+    source_queue_.push(item);
+    num_source_items_.fetch_add(1);
+  } else {
+    PushToBucket(std::move(item));
+  }
+  num_tasks_to_add_.fetch_add(1);
+  VLOG(4) << node->DebugName() << " was added to the scheduler queue.";
+
+  // Now grab the tasks to execute. This will gather any waiting tasks, in
+  // addition to the one we just added.
+  int tasks_to_add = 0;
+  if (running_count_.load() > 0) {
+    tasks_to_add = GetTasksToSubmitToExecutor();
+  }
   while (tasks_to_add > 0) {
     executor_->AddTask(this);
     --tasks_to_add;
@@ -162,10 +245,7 @@ void SchedulerQueue::AddItemToQueue(Item&& item) {
 }
 
 int SchedulerQueue::GetTasksToSubmitToExecutor() {
-  int tasks_to_add = num_tasks_to_add_;
-  num_tasks_to_add_ = 0;
-  num_pending_tasks_ += tasks_to_add;
-  return tasks_to_add;
+  return num_tasks_to_add_.exchange(0);
 }
 
 void SchedulerQueue::SubmitWaitingTasksToExecutor() {
@@ -173,11 +253,8 @@ void SchedulerQueue::SubmitWaitingTasksToExecutor() {
   // we do not immediately submit tasks to the executor. Here we check for any
   // such waiting tasks, and submit them.
   int tasks_to_add = 0;
-  {
-    absl::MutexLock lock(&mutex_);
-    if (running_count_ > 0) {
-      tasks_to_add = GetTasksToSubmitToExecutor();
-    }
+  if (running_count_.load() > 0) {
+    tasks_to_add = GetTasksToSubmitToExecutor();
   }
   while (tasks_to_add > 0) {
     executor_->AddTask(this);
@@ -186,23 +263,23 @@ void SchedulerQueue::SubmitWaitingTasksToExecutor() {
 }
 
 void SchedulerQueue::RunNextTask() {
-  CalculatorNode* node;
-  CalculatorContext* calculator_context;
-  bool is_open_node;
-  {
-    absl::MutexLock lock(&mutex_);
-
-    CHECK(!queue_.empty()) << "Called RunNextTask when the queue is empty. "
-                              "This should not happen.";
-
-    node = queue_.top().Node();
-    calculator_context = queue_.top().Context();
-    is_open_node = queue_.top().IsOpenNode();
-    queue_.pop();
-
-    CHECK(!node->Closed())
-        << "Scheduled a node that was closed. This should not happen.";
+  // Every task is submitted after the item it stands for was queued, so an
+  // item is available. It can still be missed for a moment while another
+  // thread pushes or pops, hence the retries. Running out of them means a
+  // task was submitted without an item.
+  constexpr int kMaxPopAttempts = 1 << 20;
+  Item item;
+  int attempts = 0;
+  while (!PopItem(&item)) {
+    CHECK_LT(++attempts, kMaxPopAttempts)
+        << "Scheduler queue has no item for a submitted task.";
+    std::this_thread::yield();
   }
+  CalculatorNode* node = item.Node();
+  CalculatorContext* calculator_context = item.Context();
+  const bool is_open_node = item.IsOpenNode();
+  CHECK(!node->Closed())
+      << "Scheduled a node that was closed. This should not happen.";
 
   // On iOS, calculators may rely on the existence of an autorelease pool
   // (either directly, or because system code they call does). We do not
@@ -218,13 +295,8 @@ void SchedulerQueue::RunNextTask() {
     }
   }
 
-  bool is_idle;
-  {
-    absl::MutexLock lock(&mutex_);
-    DCHECK_GT(num_pending_tasks_, 0);
-    --num_pending_tasks_;
-    is_idle = IsIdle();
-  }
+  const bool is_idle = num_unfinished_items_.fetch_sub(1) == 1;
+  VLOG(3) << "Scheduler queue idle: " << is_idle;
   if (is_idle && idle_callback_) {
     // Became idle.
     idle_callback_(true);
@@ -295,17 +367,16 @@ void SchedulerQueue::OpenCalculatorNode(CalculatorNode* node) {
 }
 
 void SchedulerQueue::CleanupAfterRun() {
-  bool was_idle;
-  {
-    absl::MutexLock lock(&mutex_);
-    was_idle = IsIdle();
-    CHECK_EQ(num_pending_tasks_, 0);
-    CHECK_EQ(num_tasks_to_add_, queue_.size());
-    num_tasks_to_add_ = 0;
-    while (!queue_.empty()) {
-      queue_.pop();
-    }
-  }
+  // No task is pending, so the items left were never submitted.
+  const int num_items = num_unfinished_items_.load();
+  const bool was_idle = num_items == 0;
+  CHECK_EQ(num_tasks_to_add_.load(), num_items);
+  num_tasks_to_add_ = 0;
+  Item item;
+  int num_popped = 0;
+  while (PopItem(&item)) ++num_popped;
+  CHECK_EQ(num_popped, num_items);
+  num_unfinished_items_ = 0;
   if (!was_idle && idle_callback_) {
     // Became idle.
     idle_callback_(true);
@@ -20,9 +20,11 @@
 #include <memory>
 #include <queue>
 #include <utility>
+#include <vector>
 
 #include "absl/base/macros.h"
 #include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/bounded_mpmc_queue.h"
 #include "mediapipe/framework/calculator_context.h"
 #include "mediapipe/framework/executor.h"
 #include "mediapipe/framework/port/integral_types.h"
@@ -35,6 +37,15 @@ class CalculatorNode;
 namespace internal {
 
 // Manages a priority queue of nodes to be run on the associated executor.
+//
+// Adding and running tasks does not take a lock, except for source nodes.
+// OpenNode() and non-source ProcessNode() items go into one fixed-size
+// lock-free bucket per node and per kind, and a bitmap of non-empty buckets
+// is laid out in the order Item::operator< defines, so the next item to run
+// is found by scanning for the first set bit. Items of source nodes are
+// ordered by their SourceProcessOrder as well, which is not a small integer,
+// so they are kept in a priority queue under a mutex and run only when all
+// buckets are empty, as before.
 class SchedulerQueue : public TaskQueue {
  public:
   // Callback to be invoked when the queue's idle state changes.
@@ -48,6 +59,8 @@ class SchedulerQueue : public TaskQueue {
     Item(CalculatorNode* node, CalculatorContext* cc);
     // A null CalculatorContext indicates the task should run OpenNode().
     Item(CalculatorNode* node);
+    // An empty item, to be assigned to.
+    Item() : node_(nullptr), cc_(nullptr) {}
 
     CalculatorNode* Node() const { return node_; }
 
@@ -99,51 +112,75 @@ class SchedulerQueue : public TaskQueue {
   // Resets the data members at the beginning of each graph run.
   void Reset();
 
+  // Sets up the buckets for |node|. Must be called for every node that is
+  // added to this queue, before the scheduler is started.
+  void RegisterNode(CalculatorNode* node);
+
   // Implements the TaskQueue interface.
   void RunNextTask() override;
 
   // NOTE: After calling SetRunning(true), the caller must call
   // SubmitWaitingTasksToExecutor since tasks may have been added while the
   // queue was not running.
-  void SetRunning(bool running) ABSL_LOCKS_EXCLUDED(mutex_);
+  void SetRunning(bool running);
 
-  // Gets the number of tasks that need to be submitted to the executor, and
-  // updates num_pending_tasks_. If this method is called and returns a
-  // non-zero value, the executor's AddTask method *must* be called for each
-  // task returned, but it can be called without holding the lock.
-  int GetTasksToSubmitToExecutor() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Gets the number of tasks that need to be submitted to the executor. If
+  // this method returns a non-zero value, the executor's AddTask method
+  // *must* be called for each task returned.
+  int GetTasksToSubmitToExecutor();
 
   // Submits tasks that are waiting (e.g. that were added while the queue was
   // not running) if the queue is running. The caller must not hold any mutex.
-  void SubmitWaitingTasksToExecutor() ABSL_LOCKS_EXCLUDED(mutex_);
+  void SubmitWaitingTasksToExecutor();
 
   // Adds a node and a calculator context to the scheduler queue if the node is
   // not already running. Note that if the node was running, then it will be
   // rescheduled upon completion (after checking dependencies), so this call is
   // not lost.
-  void AddNode(CalculatorNode* node, CalculatorContext* cc)
-      ABSL_LOCKS_EXCLUDED(mutex_);
+  void AddNode(CalculatorNode* node, CalculatorContext* cc);
 
   // Adds a node to the scheduler queue for an OpenNode() call.
-  void AddNodeForOpen(CalculatorNode* node) ABSL_LOCKS_EXCLUDED(mutex_);
+  void AddNodeForOpen(CalculatorNode* node);
 
-  // Adds an Item to queue_.
+  // Adds an Item to the queue.
   void AddItemToQueue(Item&& item);
 
-  void CleanupAfterRun() ABSL_LOCKS_EXCLUDED(mutex_);
+  void CleanupAfterRun();
 
  private:
   // Used internally by RunNextTask. Invokes ProcessNode or CloseNode, followed
   // by EndScheduling.
-  void RunCalculatorNode(CalculatorNode* node, CalculatorContext* cc)
-      ABSL_LOCKS_EXCLUDED(mutex_);
+  void RunCalculatorNode(CalculatorNode* node, CalculatorContext* cc);
 
   // Used internally by RunNextTask. Invokes OpenNode, followed by
   // CheckIfBecameReady.
-  void OpenCalculatorNode(CalculatorNode* node) ABSL_LOCKS_EXCLUDED(mutex_);
+  void OpenCalculatorNode(CalculatorNode* node);
+
+  // Items of one node and one kind (OpenNode() or ProcessNode()). Holds at
+  // most max_in_flight items, since a node is only added to the queue after
+  // CalculatorNode::TryToBeginScheduling succeeds.
+  struct Bucket {
+    explicit Bucket(int capacity) : items(capacity) {}
+
+    BoundedMpmcQueue<Item> items;
+    // Number of items pushed and not yet popped.
+    std::atomic<int> size{0};
+  };
 
-  // Checks whether the queue has no queued nodes or pending tasks.
-  bool IsIdle() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Returns the bucket |item| belongs to and its bit in bitmap_. Bits are
+  // numbered in the order the items run: the OpenNode() buckets by increasing
+  // node id, then the ProcessNode() buckets by decreasing node id.
+  Bucket* BucketForItem(const Item& item, int* bit);
+  Bucket* BucketForBit(int bit);
+
+  void SetBit(int bit);
+  void ClearBit(int bit);
+
+  // Pushes a non-source item into its bucket.
+  void PushToBucket(Item&& item);
+
+  // Pops the item that runs first. Returns false if no item is available.
+  bool PopItem(Item* item);
 
   Executor* executor_ = nullptr;
 
@@ -154,20 +191,28 @@ class SchedulerQueue : public TaskQueue {
   // decrements it. The queue is running if running_count_ > 0. A running
   // queue will submit tasks to the executor.
   // Invariant: running_count_ <= 1.
-  int running_count_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::atomic<int> running_count_{0};
 
-  // Number of tasks added to the Executor and not yet complete.
-  int num_pending_tasks_ ABSL_GUARDED_BY(mutex_);
+  // Number of items added to the queue whose task has not completed yet.
+  // The queue is idle when this is 0.
+  std::atomic<int> num_unfinished_items_{0};
 
   // Number of tasks that need to be added to the Executor.
-  int num_tasks_to_add_ ABSL_GUARDED_BY(mutex_);
+  std::atomic<int> num_tasks_to_add_{0};
 
-  // Queue of nodes that need to be run.
-  std::priority_queue<Item> queue_ ABSL_GUARDED_BY(mutex_);
+  // Buckets for OpenNode() and ProcessNode() items, indexed by node id.
+  std::vector<std::unique_ptr<Bucket>> open_buckets_;
+  std::vector<std::unique_ptr<Bucket>> process_buckets_;
+  // One bit per bucket, set while the bucket may be non-empty.
+  std::vector<std::atomic<uint64>> bitmap_;
 
-  SchedulerShared* const shared_;
+  // Number of items in source_queue_.
+  std::atomic<int> num_source_items_{0};
+  // ProcessNode() items of source nodes.
+  std::priority_queue<Item> source_queue_ ABSL_GUARDED_BY(source_mutex_);
+  absl::Mutex source_mutex_;
 
-  absl::Mutex mutex_;
+  SchedulerShared* const shared_;
 };
 
 }  // namespace internal
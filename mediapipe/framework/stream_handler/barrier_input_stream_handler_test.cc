@@ -13,7 +13,6 @@
 // limitations under the License.
 
 #include <functional>
-#include <list>
 #include <memory>
 #include <vector>
 
@@ -146,7 +145,7 @@ TEST_F(BarrierInputStreamHandlerTest, SimulateProcessNode) {
   ASSERT_FALSE(input_stream_handler_->ScheduleInvocations(
       /*max_allowance=*/1, &min_stream_timestamp));
 
-  std::list<Packet> packets;
+  PacketQueue packets;
   packets.push_back(Adopt(new std::string("packet 1")).At(Timestamp(10)));
   packets.push_back(Adopt(new std::string("packet 2")).At(Timestamp(30)));
   packets.push_back(Adopt(new std::string("packet 3")).At(Timestamp(20)));
@@ -18,17 +18,18 @@
 
 #include "mediapipe/framework/port/canonical_errors.h"
 #include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_macros.h"
 #include "mediapipe/framework/port/status_builder.h"
 #include "mediapipe/framework/thread_pool_executor.pb.h"
 #include "mediapipe/util/cpu_util.h"
 
 namespace mediapipe {
 
-// static
-::mediapipe::StatusOr<Executor*> ThreadPoolExecutor::Create(
-    const MediaPipeOptions& extendable_options) {
-  auto& options =
-      extendable_options.GetExtension(ThreadPoolExecutorOptions::ext);
+namespace internal {
+
+::mediapipe::Status ParseThreadPoolExecutorOptions(
+    const ThreadPoolExecutorOptions& options, ThreadOptions* thread_options) {
   if (!options.has_num_threads()) {
     return ::mediapipe::InvalidArgumentError(
         "num_threads is not specified in ThreadPoolExecutorOptions.");
@@ -40,9 +41,8 @@ namespace mediapipe {
            << options.num_threads();
   }
 
-  ThreadOptions thread_options;
   if (options.has_stack_size()) {
-    // thread_options.set_stack_size() takes a size_t as input, so we must not
+    // thread_options->set_stack_size() takes a size_t as input, so we must not
     // pass a negative value. 0 has a special meaning (the default thread
     // stack size for the system), so we also avoid that.
     if (options.stack_size() <= 0) {
@@ -51,26 +51,39 @@ namespace mediapipe {
                 "positive but is "
              << options.stack_size();
     }
-    thread_options.set_stack_size(options.stack_size());
+    thread_options->set_stack_size(options.stack_size());
   }
   if (options.has_nice_priority_level()) {
-    thread_options.set_nice_priority_level(options.nice_priority_level());
+    thread_options->set_nice_priority_level(options.nice_priority_level());
   }
   if (options.has_thread_name_prefix()) {
-    thread_options.set_name_prefix(options.thread_name_prefix());
+    thread_options->set_name_prefix(options.thread_name_prefix());
   }
 #if defined(__linux__)
   switch (options.require_processor_performance()) {
     case ThreadPoolExecutorOptions::LOW:
-      thread_options.set_cpu_set(InferLowerCoreIds());
+      thread_options->set_cpu_set(InferLowerCoreIds());
       break;
     case ThreadPoolExecutorOptions::HIGH:
-      thread_options.set_cpu_set(InferHigherCoreIds());
+      thread_options->set_cpu_set(InferHigherCoreIds());
       break;
     default:
       break;
   }
 #endif
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace internal
+
+// static
+::mediapipe::StatusOr<Executor*> ThreadPoolExecutor::Create(
+    const MediaPipeOptions& extendable_options) {
+  auto& options =
+      extendable_options.GetExtension(ThreadPoolExecutorOptions::ext);
+  ThreadOptions thread_options;
+  MP_RETURN_IF_ERROR(
+      internal::ParseThreadPoolExecutorOptions(options, &thread_options));
   return new ThreadPoolExecutor(thread_options, options.num_threads());
 }
 
@@ -22,6 +22,8 @@
 
 namespace mediapipe {
 
+class ThreadPoolExecutorOptions;
+
 // A multithreaded executor based on a thread pool.
 class ThreadPoolExecutor : public Executor {
  public:
@@ -58,6 +60,16 @@ class ThreadPoolExecutor : public Executor {
   size_t stack_size_ = 0;
 };
 
+namespace internal {
+
+// Validates the num_threads field of |options| and converts the other fields
+// into |thread_options|. Shared with the other executors that take
+// ThreadPoolExecutorOptions.
+::mediapipe::Status ParseThreadPoolExecutorOptions(
+    const ThreadPoolExecutorOptions& options, ThreadOptions* thread_options);
+
+}  // namespace internal
+
 }  // namespace mediapipe
 
 #endif  // MEDIAPIPE_FRAMEWORK_THREAD_POOL_EXECUTOR_H_
@@ -0,0 +1,154 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef MEDIAPIPE_FRAMEWORK_WORK_STEALING_DEQUE_H_
+#define MEDIAPIPE_FRAMEWORK_WORK_STEALING_DEQUE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mediapipe {
+namespace internal {
+
+// A Chase-Lev work-stealing deque of pointers ("Dynamic Circular
+// Work-Stealing Deque", Chase and Lev, SPAA 2005, with the memory orderings of
+// "Correct and Efficient Work-Stealing for Weak Memory Models", Le et al.,
+// PPoPP 2013).
+//
+// One thread, the owner, pushes and pops at the bottom; any thread may steal
+// from the top. Push and Pop are wait-free except when the deque grows, and
+// Steal is lock-free. The owner thus takes its most recently pushed item
+// (LIFO), which is the one most likely to still be in its cache, while
+// thieves take the oldest one.
+//
+// The buffer doubles when it fills up. Buffers that were replaced are kept
+// until the deque is destroyed, as a concurrent Steal may still read them.
+template <typename T>
+class WorkStealingDeque {
+ public:
+  explicit WorkStealingDeque(int64_t initial_capacity = 64) {
+    int64_t capacity = 1;
+    while (capacity < initial_capacity) capacity *= 2;
+    buffers_.push_back(MakeBuffer(capacity));
+    buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+  }
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  // Adds |item| at the bottom. Owner only.
+  void Push(T* item) {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const int64_t top = top_.load(std::memory_order_acquire);
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    if (bottom - top > buffer->capacity - 1) {
+      buffer = Grow(buffer, top, bottom);
+    }
+    buffer->Put(bottom, item);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  // Removes and returns the item at the bottom, or nullptr if the deque is
+  // empty. Owner only.
+  T* Pop() {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      // Empty.
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T* item = buffer->Get(bottom);
+    if (top == bottom) {
+      // Last item; race the thieves for it.
+      if (!top_.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        item = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // Removes and returns the item at the top. Returns nullptr if the deque is
+  // empty or if another thread took the item first. Any thread.
+  T* Steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) return nullptr;
+    Buffer* buffer = buffer_.load(std::memory_order_acquire);
+    T* item = buffer->Get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return item;
+  }
+
+  // Approximate number of items. Any thread.
+  int64_t Size() const {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const int64_t top = top_.load(std::memory_order_relaxed);
+    return bottom > top ? bottom - top : 0;
+  }
+
+ private:
+  struct Buffer {
+    explicit Buffer(int64_t capacity)
+        : capacity(capacity), items(new std::atomic<T*>[capacity]) {}
+
+    T* Get(int64_t index) const {
+      return items[index & (capacity - 1)].load(std::memory_order_relaxed);
+    }
+    void Put(int64_t index, T* item) {
+      items[index & (capacity - 1)].store(item, std::memory_order_relaxed);
+    }
+
+    const int64_t capacity;
+    std::unique_ptr<std::atomic<T*>[]> items;
+  };
+
+  static std::unique_ptr<Buffer> MakeBuffer(int64_t capacity) {
+    return std::unique_ptr<Buffer>(new Buffer(capacity));
+  }
+
+  Buffer* Grow(Buffer* buffer, int64_t top, int64_t bottom) {
+    buffers_.push_back(MakeBuffer(buffer->capacity * 2));
+    Buffer* grown = buffers_.back().get();
+    for (int64_t i = top; i < bottom; ++i) {
+      grown->Put(i, buffer->Get(i));
+    }
+    buffer_.store(grown, std::memory_order_release);
+    return grown;
+  }
+
+  alignas(64) std::atomic<int64_t> top_{0};
+  alignas(64) std::atomic<int64_t> bottom_{0};
+  std::atomic<Buffer*> buffer_;
+  // Every buffer used so far, the current one last. Owner only.
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+};
+
+}  // namespace internal
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_WORK_STEALING_DEQUE_H_
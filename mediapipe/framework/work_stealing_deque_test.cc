@@ -0,0 +1,97 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "mediapipe/framework/work_stealing_deque.h"
+
+#include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace internal {
+namespace {
+
+TEST(WorkStealingDequeTest, PopIsLifo) {
+  WorkStealingDeque<int> deque;
+  int items[3] = {0, 1, 2};
+  for (int& item : items) deque.Push(&item);
+  EXPECT_EQ(3, deque.Size());
+  EXPECT_EQ(&items[2], deque.Pop());
+  EXPECT_EQ(&items[1], deque.Pop());
+  EXPECT_EQ(&items[0], deque.Pop());
+  EXPECT_EQ(nullptr, deque.Pop());
+  EXPECT_EQ(0, deque.Size());
+}
+
+TEST(WorkStealingDequeTest, StealIsFifo) {
+  WorkStealingDeque<int> deque;
+  int items[3] = {0, 1, 2};
+  for (int& item : items) deque.Push(&item);
+  EXPECT_EQ(&items[0], deque.Steal());
+  EXPECT_EQ(&items[1], deque.Steal());
+  EXPECT_EQ(&items[2], deque.Pop());
+  EXPECT_EQ(nullptr, deque.Steal());
+}
+
+TEST(WorkStealingDequeTest, Grows) {
+  WorkStealingDeque<int> deque(/*initial_capacity=*/2);
+  std::vector<int> items(100);
+  // Steal some first so that the items wrap around the buffer when it grows.
+  for (int i = 0; i < 10; ++i) deque.Push(&items[i]);
+  for (int i = 0; i < 5; ++i) EXPECT_EQ(&items[i], deque.Steal());
+  for (int i = 10; i < 100; ++i) deque.Push(&items[i]);
+  EXPECT_EQ(95, deque.Size());
+  for (int i = 99; i >= 5; --i) EXPECT_EQ(&items[i], deque.Pop());
+  EXPECT_EQ(nullptr, deque.Pop());
+}
+
+// The owner pushes and pops while thieves steal; every item must be taken
+// exactly once.
+TEST(WorkStealingDequeTest, ConcurrentPopAndSteal) {
+  constexpr int kNumItems = 200000;
+  constexpr int kNumThieves = 4;
+  WorkStealingDeque<int> deque(/*initial_capacity=*/4);
+  std::vector<int> items(kNumItems);
+  std::vector<std::atomic<int>> taken(kNumItems);
+  for (auto& count : taken) count = 0;
+  std::atomic<bool> done(false);
+  auto take = [&items, &taken](int* item) {
+    if (item != nullptr) taken[item - items.data()].fetch_add(1);
+  };
+
+  std::vector<std::thread> thieves;
+  for (int i = 0; i < kNumThieves; ++i) {
+    thieves.emplace_back([&deque, &done, &take] {
+      while (!done.load()) take(deque.Steal());
+    });
+  }
+  for (int i = 0; i < kNumItems; ++i) {
+    deque.Push(&items[i]);
+    if (i % 3 == 0) take(deque.Pop());
+  }
+  while (int* item = deque.Pop()) take(item);
+  done = true;
+  for (auto& thief : thieves) thief.join();
+
+  for (int i = 0; i < kNumItems; ++i) {
+    ASSERT_EQ(1, taken[i].load()) << "item " << i;
+  }
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace mediapipe
@@ -0,0 +1,189 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "mediapipe/framework/work_stealing_executor.h"
+
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/framework/thread_pool_executor.h"
+#include "mediapipe/framework/thread_pool_executor.pb.h"
+
+namespace mediapipe {
+
+namespace {
+
+// Rounds of looking for a task before a worker goes to sleep, while tasks are
+// pending but were taken by other thieves first.
+constexpr int kSpinRounds = 32;
+
+}  // namespace
+
+struct WorkStealingExecutor::Worker {
+  Worker(WorkStealingExecutor* executor, int index)
+      : executor(executor), index(index), random_state(index * 2654435761u + 1) {}
+
+  // Returns a pseudo-random number (xorshift32).
+  uint32_t NextRandom() {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+  }
+
+  WorkStealingExecutor* const executor;
+  const int index;
+  internal::WorkStealingDeque<Task> tasks;
+  uint32_t random_state;
+};
+
+// static
+::mediapipe::StatusOr<Executor*> WorkStealingExecutor::Create(
+    const MediaPipeOptions& extendable_options) {
+  auto& options =
+      extendable_options.GetExtension(ThreadPoolExecutorOptions::ext);
+  ThreadOptions thread_options;
+  MP_RETURN_IF_ERROR(
+      internal::ParseThreadPoolExecutorOptions(options, &thread_options));
+  return new WorkStealingExecutor(thread_options, options.num_threads());
+}
+
+WorkStealingExecutor::WorkStealingExecutor(int num_threads)
+    : thread_pool_("mediapipe", num_threads) {
+  Start();
+}
+
+WorkStealingExecutor::WorkStealingExecutor(const ThreadOptions& thread_options,
+                                           int num_threads)
+    : thread_pool_(thread_options,
+                   thread_options.name_prefix().empty()
+                       ? "mediapipe"
+                       : thread_options.name_prefix(),
+                   num_threads) {
+  Start();
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+  VLOG(2) << "Terminating work-stealing executor.";
+  {
+    absl::MutexLock lock(&mutex_);
+    stopped_ = true;
+    sleep_condition_.SignalAll();
+  }
+  // thread_pool_ is destroyed first and waits for the worker loops, which
+  // finish the pending tasks before they return.
+}
+
+void WorkStealingExecutor::Start() {
+  for (int i = 0; i < thread_pool_.num_threads(); ++i) {
+    workers_.push_back(absl::make_unique<Worker>(this, i));
+  }
+  thread_pool_.StartWorkers();
+  for (auto& worker : workers_) {
+    Worker* w = worker.get();
+    thread_pool_.Schedule([this, w] { RunWorker(w); });
+  }
+  VLOG(2) << "Started work-stealing executor with " << workers_.size()
+          << " threads.";
+}
+
+// static
+WorkStealingExecutor::Worker*& WorkStealingExecutor::CurrentWorker() {
+  static thread_local Worker* worker = nullptr;
+  return worker;
+}
+
+void WorkStealingExecutor::Schedule(std::function<void()> task) {
+  Task* pending = new Task(std::move(task));
+  Worker* worker = CurrentWorker();
+  if (worker != nullptr && worker->executor == this) {
+    worker->tasks.Push(pending);
+  } else {
+    absl::MutexLock lock(&mutex_);
+    shared_tasks_.push_back(pending);
+    num_shared_.fetch_add(1);
+  }
+  num_pending_.fetch_add(1);
+  NotifyWorker();
+}
+
+void WorkStealingExecutor::NotifyWorker() {
+  // Pairs with the sleeping worker incrementing num_sleeping_ before it checks
+  // num_pending_: either this sees the sleeper, or the sleeper sees the task.
+  if (num_sleeping_.load() > 0) {
+    absl::MutexLock lock(&mutex_);
+    sleep_condition_.Signal();
+  }
+}
+
+WorkStealingExecutor::Task* WorkStealingExecutor::FindTask(Worker* worker) {
+  if (Task* task = worker->tasks.Pop()) return task;
+  if (num_shared_.load(std::memory_order_relaxed) > 0) {
+    absl::MutexLock lock(&mutex_);
+    if (!shared_tasks_.empty()) {
+      Task* task = shared_tasks_.front();
+      shared_tasks_.pop_front();
+      num_shared_.fetch_sub(1);
+      return task;
+    }
+  }
+  return StealTask(worker);
+}
+
+WorkStealingExecutor::Task* WorkStealingExecutor::StealTask(Worker* worker) {
+  const int num_workers = workers_.size();
+  if (num_workers == 1) return nullptr;
+  const int first = worker->NextRandom() % num_workers;
+  for (int i = 0; i < num_workers; ++i) {
+    Worker* victim = workers_[(first + i) % num_workers].get();
+    if (victim == worker) continue;
+    if (Task* task = victim->tasks.Steal()) return task;
+  }
+  return nullptr;
+}
+
+void WorkStealingExecutor::RunWorker(Worker* worker) {
+  CurrentWorker() = worker;
+  while (true) {
+    Task* task = nullptr;
+    for (int round = 0; round < kSpinRounds && task == nullptr; ++round) {
+      task = FindTask(worker);
+      if (task == nullptr && num_pending_.load() == 0) break;
+      if (task == nullptr) std::this_thread::yield();
+    }
+    if (task != nullptr) {
+      num_pending_.fetch_sub(1);
+      (*task)();
+      delete task;
+      continue;
+    }
+    absl::MutexLock lock(&mutex_);
+    num_sleeping_.fetch_add(1);
+    while (num_pending_.load() == 0 && !stopped_) {
+      sleep_condition_.Wait(&mutex_);
+    }
+    num_sleeping_.fetch_sub(1);
+    if (stopped_ && num_pending_.load() == 0) break;
+  }
+  CurrentWorker() = nullptr;
+}
+
+REGISTER_EXECUTOR(WorkStealingExecutor);
+
+}  // namespace mediapipe
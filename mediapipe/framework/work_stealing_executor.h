@@ -0,0 +1,108 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef MEDIAPIPE_FRAMEWORK_WORK_STEALING_EXECUTOR_H_
+#define MEDIAPIPE_FRAMEWORK_WORK_STEALING_EXECUTOR_H_
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/deps/thread_options.h"
+#include "mediapipe/framework/executor.h"
+#include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/framework/work_stealing_deque.h"
+
+namespace mediapipe {
+
+// A multithreaded executor in which every worker thread has its own task
+// deque, instead of all threads sharing one queue behind one mutex as in
+// ThreadPoolExecutor.
+//
+// A task scheduled from a worker thread, which is how the scheduler adds most
+// of the nodes that became ready, goes to the bottom of that worker's deque
+// and is usually run next by the same thread, while the data it consumes is
+// still in its cache. Idle workers steal from the top of the deque of a random
+// other worker. Tasks scheduled from other threads go through a shared queue.
+//
+// Takes ThreadPoolExecutorOptions. Unlike ThreadPoolExecutor, it does not run
+// the tasks in FIFO order, even with one thread.
+//
+// Example config:
+// executor {
+//   name: ""
+//   type: "WorkStealingExecutor"
+//   options {
+//     [mediapipe.ThreadPoolExecutorOptions.ext] { num_threads: 16 }
+//   }
+// }
+class WorkStealingExecutor : public Executor {
+ public:
+  static ::mediapipe::StatusOr<Executor*> Create(
+      const MediaPipeOptions& extendable_options);
+
+  explicit WorkStealingExecutor(int num_threads);
+  ~WorkStealingExecutor() override;
+  void Schedule(std::function<void()> task) override;
+
+  // For testing.
+  int num_threads() const { return static_cast<int>(workers_.size()); }
+
+ private:
+  using Task = std::function<void()>;
+  struct Worker;
+
+  WorkStealingExecutor(const ThreadOptions& thread_options, int num_threads);
+
+  // Starts the worker loops on the thread pool.
+  void Start();
+  void RunWorker(Worker* worker);
+  // Takes a task from |worker|'s own deque, the shared queue, or another
+  // worker, in that order. Returns nullptr if none was found.
+  Task* FindTask(Worker* worker);
+  Task* StealTask(Worker* worker);
+  // Wakes up a sleeping worker, if any.
+  void NotifyWorker();
+
+  // The worker running on the calling thread, if any.
+  static Worker*& CurrentWorker();
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  // Tasks scheduled but not taken yet, in any queue.
+  std::atomic<int64_t> num_pending_{0};
+  // Tasks in shared_tasks_.
+  std::atomic<int64_t> num_shared_{0};
+  // Workers blocked in sleep_condition_.
+  std::atomic<int> num_sleeping_{0};
+  std::atomic<bool> stopped_{false};
+
+  absl::Mutex mutex_;
+  absl::CondVar sleep_condition_;
+  // Tasks scheduled from threads that are not workers of this executor.
+  std::deque<Task*> shared_tasks_ ABSL_GUARDED_BY(mutex_);
+
+  // Provides the threads; every thread runs one worker loop. Declared last so
+  // that it joins the threads before anything they use is destroyed.
+  ::mediapipe::ThreadPool thread_pool_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_WORK_STEALING_EXECUTOR_H_
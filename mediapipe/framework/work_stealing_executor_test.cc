@@ -0,0 +1,211 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "mediapipe/framework/work_stealing_executor.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/thread_pool_executor.h"
+#include "mediapipe/framework/thread_pool_executor.pb.h"
+
+namespace mediapipe {
+namespace {
+
+// Runs a task that schedules |fan_out| tasks, each of which schedules
+// |fan_out| more, down to |depth| levels, and counts them all in |count|.
+void ScheduleTree(Executor* executor, int fan_out, int depth,
+                  std::atomic<int>* count) {
+  count->fetch_add(1);
+  if (depth == 0) return;
+  for (int i = 0; i < fan_out; ++i) {
+    executor->Schedule([executor, fan_out, depth, count] {
+      ScheduleTree(executor, fan_out, depth - 1, count);
+    });
+  }
+}
+
+int TreeSize(int fan_out, int depth) {
+  int size = 1;
+  int level = 1;
+  for (int i = 0; i < depth; ++i) {
+    level *= fan_out;
+    size += level;
+  }
+  return size;
+}
+
+TEST(WorkStealingExecutorTest, RunsTasksFromOtherThreads) {
+  std::atomic<int> count(0);
+  {
+    WorkStealingExecutor executor(4);
+    ASSERT_EQ(4, executor.num_threads());
+    for (int i = 0; i < 1000; ++i) {
+      executor.Schedule([&count] { count.fetch_add(1); });
+    }
+  }
+  EXPECT_EQ(1000, count.load());
+}
+
+TEST(WorkStealingExecutorTest, RunsTasksFromWorkers) {
+  std::atomic<int> count(0);
+  {
+    WorkStealingExecutor executor(4);
+    executor.Schedule(
+        [&executor, &count] { ScheduleTree(&executor, 4, 5, &count); });
+  }
+  EXPECT_EQ(TreeSize(4, 5), count.load());
+}
+
+TEST(WorkStealingExecutorTest, SingleThread) {
+  std::atomic<int> count(0);
+  {
+    WorkStealingExecutor executor(1);
+    executor.Schedule(
+        [&executor, &count] { ScheduleTree(&executor, 3, 4, &count); });
+  }
+  EXPECT_EQ(TreeSize(3, 4), count.load());
+}
+
+TEST(WorkStealingExecutorTest, WakesUpAfterIdling) {
+  WorkStealingExecutor executor(2);
+  for (int i = 0; i < 100; ++i) {
+    absl::Notification done;
+    executor.Schedule([&done] { done.Notify(); });
+    done.WaitForNotification();
+  }
+}
+
+TEST(WorkStealingExecutorTest, CreateRequiresNumThreads) {
+  MediaPipeOptions options;
+  EXPECT_FALSE(WorkStealingExecutor::Create(options).ok());
+  options.MutableExtension(ThreadPoolExecutorOptions::ext)->set_num_threads(0);
+  EXPECT_FALSE(WorkStealingExecutor::Create(options).ok());
+  options.MutableExtension(ThreadPoolExecutorOptions::ext)->set_num_threads(3);
+  auto status_or_executor = WorkStealingExecutor::Create(options);
+  MP_ASSERT_OK(status_or_executor);
+  std::unique_ptr<Executor> executor(status_or_executor.ValueOrDie());
+  EXPECT_EQ(3, static_cast<WorkStealingExecutor*>(executor.get())
+                   ->num_threads());
+}
+
+// A graph in which every packet on "input" fans out to |width|
+// PassThroughCalculators, running on an executor of type |executor_type|.
+CalculatorGraphConfig FanOutGraphConfig(const std::string& executor_type,
+                                        int num_threads, int width) {
+  CalculatorGraphConfig config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(absl::StrCat(
+          R"(
+            input_stream: "input"
+            executor {
+              name: ""
+              type: ")",
+          executor_type, R"("
+              options {
+                [mediapipe.ThreadPoolExecutorOptions.ext] { num_threads: )",
+          num_threads, R"( }
+              }
+            }
+          )"));
+  for (int i = 0; i < width; ++i) {
+    auto* node = config.add_node();
+    node->set_calculator("PassThroughCalculator");
+    node->add_input_stream("input");
+    node->add_output_stream(absl::StrCat("output_", i));
+  }
+  return config;
+}
+
+TEST(WorkStealingExecutorTest, RunsFanOutGraph) {
+  constexpr int kWidth = 16;
+  constexpr int kNumPackets = 100;
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(
+      FanOutGraphConfig("WorkStealingExecutor", 4, kWidth)));
+  std::atomic<int> count(0);
+  for (int i = 0; i < kWidth; ++i) {
+    MP_ASSERT_OK(graph.ObserveOutputStream(
+        absl::StrCat("output_", i), [&count](const Packet&) {
+          count.fetch_add(1);
+          return ::mediapipe::OkStatus();
+        }));
+  }
+  MP_ASSERT_OK(graph.StartRun({}));
+  for (int i = 0; i < kNumPackets; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "input", MakePacket<int>(i).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+  EXPECT_EQ(kWidth * kNumPackets, count.load());
+}
+
+template <typename ExecutorType>
+void BM_ScheduleTree(benchmark::State& state) {
+  const int num_threads = state.range(0);
+  ExecutorType executor(num_threads);
+  for (auto _ : state) {
+    std::atomic<int> count(0);
+    const int expected = TreeSize(8, 4);
+    executor.Schedule(
+        [&executor, &count] { ScheduleTree(&executor, 8, 4, &count); });
+    while (count.load() < expected) {
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * TreeSize(8, 4));
+}
+BENCHMARK_TEMPLATE(BM_ScheduleTree, ThreadPoolExecutor)->Range(1, 32);
+BENCHMARK_TEMPLATE(BM_ScheduleTree, WorkStealingExecutor)->Range(1, 32);
+
+// Sends packets through a graph with 64 nodes reading the same stream.
+void BM_FanOutGraph(benchmark::State& state, const std::string& executor_type) {
+  constexpr int kWidth = 64;
+  constexpr int kNumPackets = 100;
+  const CalculatorGraphConfig config =
+      FanOutGraphConfig(executor_type, state.range(0), kWidth);
+  for (auto _ : state) {
+    CalculatorGraph graph;
+    CHECK(graph.Initialize(config).ok());
+    CHECK(graph.StartRun({}).ok());
+    for (int i = 0; i < kNumPackets; ++i) {
+      CHECK(graph
+                .AddPacketToInputStream("input",
+                                        MakePacket<int>(i).At(Timestamp(i)))
+                .ok());
+    }
+    CHECK(graph.CloseAllInputStreams().ok());
+    CHECK(graph.WaitUntilDone().ok());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPackets * kWidth);
+}
+BENCHMARK_CAPTURE(BM_FanOutGraph, ThreadPoolExecutor,
+                  std::string("ThreadPoolExecutor"))
+    ->Range(1, 32);
+BENCHMARK_CAPTURE(BM_FanOutGraph, WorkStealingExecutor,
+                  std::string("WorkStealingExecutor"))
+    ->Range(1, 32);
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,306 @@
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "src/calculators/background_loop_cache_calculator.pb.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kFramesTag[] = "FRAMES";
+constexpr char kTickTag[] = "TICK";
+constexpr char kVideoTag[] = "VIDEO";
+constexpr char kBudgetTag[] = "BUDGET_MB";
+
+// Scaled frames of a loop too long to keep in memory, written back to back to
+// an unlinked file that is mapped read-only once the loop is complete. Shared
+// with the deleters of the frames in flight, which keep the mapping alive.
+class SpillFile {
+ public:
+  ~SpillFile() {
+    if (data_ != nullptr) munmap(data_, size_);
+    if (fd_ >= 0) close(fd_);
+  }
+
+  ::mediapipe::Status Create(const std::string& directory) {
+    std::string path = directory + "/background_loop_XXXXXX";
+    fd_ = mkstemp(&path[0]);
+    if (fd_ < 0) {
+      return ::mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+             << "Failed to create a spill file in " << directory << ": "
+             << std::strerror(errno);
+    }
+    unlink(path.c_str());
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Append(const ImageFrame& frame) {
+    const int row_bytes = frame.Width() * frame.NumberOfChannels();
+    for (int y = 0; y < frame.Height(); ++y) {
+      const uint8* row = frame.PixelData() + y * frame.WidthStep();
+      int written = 0;
+      while (written < row_bytes) {
+        const ssize_t result = write(fd_, row + written, row_bytes - written);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) {
+          return ::mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+                 << "Failed to write the spill file: " << std::strerror(errno);
+        }
+        written += result;
+      }
+    }
+    size_ += row_bytes * frame.Height();
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Map() {
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (data == MAP_FAILED) {
+      return ::mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+             << "Failed to map the spill file: " << std::strerror(errno);
+    }
+    data_ = static_cast<uint8*>(data);
+    return ::mediapipe::OkStatus();
+  }
+
+  // Hints the kernel about the pages of [offset, offset + length).
+  void Advise(size_t offset, size_t length, int advice) {
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t begin = offset / page_size * page_size;
+    madvise(data_ + begin, std::min(offset + length, size_) - begin, advice);
+  }
+
+  uint8* data() const { return data_; }
+
+ private:
+  int fd_ = -1;
+  uint8* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace
+
+// Plays a decoded video as a looping background.
+//
+// The frames of the loop arrive once on FRAMES, typically straight from an
+// OpenCvVideoDecoderCalculator, and are scaled to the configured size as they
+// arrive. For every packet on TICK the calculator then sends the loop frame
+// for the time elapsed since the first tick, at the timestamp of the tick. The
+// output packets share the cached pixels, so once the loop is cached no frame
+// is decoded, scaled or copied again.
+//
+// Loops up to the memory budget are kept in memory. Longer loops are written
+// to an unlinked file and played from a read-only mapping of it, prefetching a
+// few frames ahead, so that only the frames around the playback position need
+// to be resident. Until the whole loop has been decoded, the most recently
+// decoded frame is sent.
+//
+// Inputs:
+//   FRAMES: Frames of the loop (ImageFrame), in presentation order.
+//   TICK: Any packet; one output frame is sent per tick.
+// Input side packets:
+//   BUDGET_MB (optional): int, overrides options.max_resident_mb.
+// Outputs:
+//   VIDEO: Background frames (ImageFrame), at the timestamps of TICK.
+//
+// Example config:
+// node {
+//   calculator: "OpenCvVideoDecoderCalculator"
+//   input_side_packet: "INPUT_FILE_PATH:background_video"
+//   output_stream: "VIDEO:background_loop"
+// }
+// node {
+//   calculator: "BackgroundLoopCacheCalculator"
+//   input_stream: "FRAMES:background_loop"
+//   input_stream: "TICK:input_video"
+//   output_stream: "VIDEO:background_video"
+// }
+class BackgroundLoopCacheCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Tag(kFramesTag).Set<ImageFrame>();
+    cc->Inputs().Tag(kTickTag).SetAny();
+    if (cc->InputSidePackets().HasTag(kBudgetTag)) {
+      cc->InputSidePackets().Tag(kBudgetTag).Set<int>();
+    }
+    cc->Outputs().Tag(kVideoTag).Set<ImageFrame>();
+    // The loop is decoded far faster than real time, with timestamps that
+    // have nothing to do with those of the ticks.
+    cc->SetInputStreamHandler("ImmediateInputStreamHandler");
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Open(CalculatorContext* cc) override;
+  ::mediapipe::Status Process(CalculatorContext* cc) override;
+
+ private:
+  ::mediapipe::Status AddFrame(const Packet& packet);
+  ::mediapipe::Status FinishLoop();
+  // Returns the index of the loop frame to show at |elapsed|.
+  int FrameIndexAt(int64 elapsed) const;
+  Packet FrameAt(int index);
+
+  BackgroundLoopCacheCalculatorOptions options_;
+  int64 max_resident_bytes_ = 0;
+
+  // Presentation time of each cached frame, relative to the first one.
+  std::vector<int64> frame_times_;
+  int64 loop_duration_ = 0;
+  bool loop_complete_ = false;
+  Timestamp first_frame_timestamp_ = Timestamp::Unset();
+  Timestamp first_tick_ = Timestamp::Unset();
+  Packet latest_frame_;
+
+  ImageFormat::Format format_ = ImageFormat::UNKNOWN;
+  int64 frame_bytes_ = 0;
+  // Either the frames are resident, or they are in spill_.
+  std::vector<Packet> resident_frames_;
+  std::shared_ptr<SpillFile> spill_;
+};
+REGISTER_CALCULATOR(BackgroundLoopCacheCalculator);
+
+::mediapipe::Status BackgroundLoopCacheCalculator::Open(CalculatorContext* cc) {
+  options_ = cc->Options<BackgroundLoopCacheCalculatorOptions>();
+  RET_CHECK_GT(options_.width(), 0);
+  RET_CHECK_GT(options_.height(), 0);
+  const int budget_mb = cc->InputSidePackets().HasTag(kBudgetTag)
+                            ? cc->InputSidePackets().Tag(kBudgetTag).Get<int>()
+                            : options_.max_resident_mb();
+  max_resident_bytes_ = static_cast<int64>(budget_mb) << 20;
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status BackgroundLoopCacheCalculator::AddFrame(
+    const Packet& packet) {
+  const auto& input = packet.Get<ImageFrame>();
+  if (format_ == ImageFormat::UNKNOWN) {
+    format_ = input.Format();
+    first_frame_timestamp_ = packet.Timestamp();
+  }
+  RET_CHECK_EQ(input.Format(), format_) << "Loop frames change format.";
+
+  Packet scaled = packet;
+  if (input.Width() != options_.width() ||
+      input.Height() != options_.height()) {
+    auto frame = absl::make_unique<ImageFrame>(
+        format_, options_.width(), options_.height(),
+        ImageFrame::kDefaultAlignmentBoundary);
+    cv::Mat frame_mat = formats::MatView(frame.get());
+    cv::resize(formats::MatView(&input), frame_mat, frame_mat.size(), 0, 0,
+               cv::INTER_AREA);
+    scaled = Adopt(frame.release()).At(packet.Timestamp());
+  }
+  frame_bytes_ = static_cast<int64>(options_.width()) * options_.height() *
+                 input.NumberOfChannels() * input.ByteDepth();
+  frame_times_.push_back((packet.Timestamp() - first_frame_timestamp_).Value());
+  latest_frame_ = scaled;
+
+  if (!spill_ && static_cast<int64>(frame_times_.size()) * frame_bytes_ >
+                     max_resident_bytes_) {
+    LOG(INFO) << "Background loop exceeds " << (max_resident_bytes_ >> 20)
+              << " MB, streaming it from " << options_.spill_directory();
+    spill_ = std::make_shared<SpillFile>();
+    MP_RETURN_IF_ERROR(spill_->Create(options_.spill_directory()));
+    for (const Packet& resident : resident_frames_) {
+      MP_RETURN_IF_ERROR(spill_->Append(resident.Get<ImageFrame>()));
+    }
+    resident_frames_.clear();
+  }
+  if (spill_) {
+    return spill_->Append(scaled.Get<ImageFrame>());
+  }
+  resident_frames_.push_back(scaled);
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status BackgroundLoopCacheCalculator::FinishLoop() {
+  loop_complete_ = true;
+  RET_CHECK(!frame_times_.empty()) << "The background video has no frames.";
+  // The last frame is shown for as long as the average frame.
+  const int num_frames = frame_times_.size();
+  loop_duration_ = num_frames > 1 ? frame_times_.back() +
+                                        frame_times_.back() / (num_frames - 1)
+                                  : 1;
+  if (spill_) {
+    MP_RETURN_IF_ERROR(spill_->Map());
+  }
+  LOG(INFO) << "Cached a background loop of " << num_frames << " frames ("
+            << ((num_frames * frame_bytes_) >> 20) << " MB, "
+            << (spill_ ? "mapped" : "resident") << ").";
+  return ::mediapipe::OkStatus();
+}
+
+int BackgroundLoopCacheCalculator::FrameIndexAt(int64 elapsed) const {
+  const int64 position = elapsed % loop_duration_;
+  const auto it =
+      std::upper_bound(frame_times_.begin(), frame_times_.end(), position);
+  return std::max<int>(0, it - frame_times_.begin() - 1);
+}
+
+Packet BackgroundLoopCacheCalculator::FrameAt(int index) {
+  if (!spill_) return resident_frames_[index];
+
+  const int num_frames = frame_times_.size();
+  for (int i = 1; i <= options_.readahead_frames(); ++i) {
+    spill_->Advise(((index + i) % num_frames) * frame_bytes_, frame_bytes_,
+                   MADV_WILLNEED);
+  }
+  // Frames well behind the playback position are not needed before the next
+  // round; dropping them keeps the resident set bounded. They are still in
+  // the file, so a frame in flight just faults its pages back in.
+  if (num_frames > 2 * options_.readahead_frames() + 1) {
+    const int behind =
+        (index - options_.readahead_frames() - 1 + num_frames) % num_frames;
+    spill_->Advise(behind * frame_bytes_, frame_bytes_, MADV_DONTNEED);
+  }
+
+  std::shared_ptr<SpillFile> spill = spill_;
+  const int channels = frame_bytes_ / (options_.width() * options_.height());
+  return Adopt(new ImageFrame(format_, options_.width(), options_.height(),
+                              options_.width() * channels,
+                              spill->data() + index * frame_bytes_,
+                              [spill](uint8*) {}));
+}
+
+::mediapipe::Status BackgroundLoopCacheCalculator::Process(
+    CalculatorContext* cc) {
+  const auto& frames = cc->Inputs().Tag(kFramesTag);
+  if (!frames.IsEmpty()) {
+    MP_RETURN_IF_ERROR(AddFrame(frames.Value()));
+  }
+  if (!loop_complete_ && frames.IsDone() && !frame_times_.empty()) {
+    MP_RETURN_IF_ERROR(FinishLoop());
+  }
+
+  const auto& tick = cc->Inputs().Tag(kTickTag);
+  if (tick.IsEmpty()) return ::mediapipe::OkStatus();
+  const Timestamp timestamp = tick.Value().Timestamp();
+  if (first_tick_ == Timestamp::Unset()) first_tick_ = timestamp;
+
+  Packet frame;
+  if (loop_complete_) {
+    frame = FrameAt(FrameIndexAt((timestamp - first_tick_).Value()));
+  } else {
+    frame = latest_frame_;
+  }
+  if (!frame.IsEmpty()) {
+    cc->Outputs().Tag(kVideoTag).AddPacket(frame.At(timestamp));
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace mediapipe
@@ -1,18 +1,24 @@
 #include <vector>
 
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/blocking_counter.h"
 #include "absl/types/span.h"
 #include "mediapipe/calculators/tflite/util.h"
 #include "mediapipe/framework/calculator_context.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/image_frame_pool.h"
 #include "mediapipe/framework/port/opencv_imgcodecs_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/threadpool.h"
 #include "mediapipe/util/resource_util.h"
+#include "src/calculators/deeplab_tensors_to_segmentation_calculator.pb.h"
+#include "src/calculators/segmentation_mask_kernel.h"
 #include "tensorflow/lite/interpreter.h"
 
+#if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
 #include "mediapipe/gpu/gl_calculator_helper.h"
 #include "mediapipe/gpu/gl_simple_shaders.h"
 #include "mediapipe/gpu/shader_util.h"
@@ -21,6 +27,7 @@
 #include "tensorflow/lite/delegates/gpu/gl/gl_shader.h"
 #include "tensorflow/lite/delegates/gpu/gl/gl_texture.h"
 #include "tensorflow/lite/delegates/gpu/gl_delegate.h"
+#endif //  !MEDIAPIPE_DISABLE_GPU
 
 namespace
 {
@@ -41,7 +48,9 @@ float Clamp(float val, float min, float max)
     return std::min(std::max(val, min), max);
 }
 
+constexpr char kTensorsTag[] = "TENSORS";
 constexpr char kTensorsGpuTag[] = "TENSORS_GPU";
+constexpr char kMaskTag[] = "OUTPUT";
 constexpr char kMaskGpuTag[] = "OUTPUT_GPU";
 
 } // namespace
@@ -58,6 +67,40 @@ using ::tflite::gpu::gl::GlProgram;
 using ::tflite::gpu::gl::GlShader;
 #endif //  !MEDIAPIPE_DISABLE_GPU
 
+// Converts the [257][257][21] class score tensor of a DeepLab v3 model into a
+// foreground mask. By default every pixel whose arg-max class is not the
+// background class is foreground.
+//
+// Produces the mask as an RGBA image, with the mask in both R & A channels,
+// at the tensor resolution. Consumers are expected to upsample it.
+//
+// On CPU the mask can be hard (arg-max) or soft (softmax probability), and the
+// rows of the tensor can be decoded on several threads.
+//
+// Inputs:
+//   One of the following TENSORS tags:
+//   TENSORS: Vector of TfLiteTensor of type kTfLiteFloat32.
+//   TENSORS_GPU: Vector of GlBuffer.
+// Output:
+//   One of the following OUTPUT tags:
+//   OUTPUT: An ImageFrame output mask, RGBA.
+//   OUTPUT_GPU: A GpuBuffer output mask, RGBA.
+//
+// Options:
+//   See deeplab_tensors_to_segmentation_calculator.proto
+//
+// Usage example:
+// node {
+//   calculator: "DeeplabTensorsToSegmentationCalculator"
+//   input_stream: "TENSORS:segmentation_tensor"
+//   output_stream: "OUTPUT:human_mask"
+//   node_options: {
+//     [type.googleapis.com/mediapipe.DeeplabTensorsToSegmentationCalculatorOptions] {
+//       output_type: SOFT_MASK
+//       num_threads: 4
+//     }
+//   }
+// }
 class DeeplabTensorsToSegmentationCalculator : public CalculatorBase
 {
 public:
@@ -70,6 +113,9 @@ public:
 private:
     ::mediapipe::Status InitGpu(CalculatorContext *cc);
     ::mediapipe::Status ProcessGpu(CalculatorContext *cc);
+    ::mediapipe::Status ProcessCpu(CalculatorContext *cc);
+    void DecodeRows(const float *scores, int row_begin, int row_end,
+                    ImageFrame *output_mask);
     void GlRender();
 
     int tensor_width_ = 257;
@@ -77,10 +123,18 @@ private:
     int tensor_channels_ = 3;
     int num_classes_ = 21;
 
+    ::mediapipe::DeeplabTensorsToSegmentationCalculatorOptions options_;
+    int target_class_ = 0;
+    bool invert_mask_ = true;
+    std::unique_ptr<ThreadPool> thread_pool_;
+
+    bool use_gpu_ = false;
+#if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
     mediapipe::GlCalculatorHelper gpu_helper_;
     std::unique_ptr<GlProgram> mask_program_;
     std::unique_ptr<GlBuffer> tensor_buffer_;
     GLuint upsample_program_;
+#endif //  !MEDIAPIPE_DISABLE_GPU
 };
 REGISTER_CALCULATOR(DeeplabTensorsToSegmentationCalculator);
 
@@ -91,11 +145,37 @@ REGISTER_CALCULATOR(DeeplabTensorsToSegmentationCalculator);
     RET_CHECK(!cc->Inputs().GetTags().empty());
     RET_CHECK(!cc->Outputs().GetTags().empty());
 
-    cc->Inputs().Tag(kTensorsGpuTag).Set<std::vector<GlBuffer>>();
+    bool use_gpu = false;
+
+    if (cc->Inputs().HasTag(kTensorsTag))
+    {
+        cc->Inputs().Tag(kTensorsTag).Set<std::vector<TfLiteTensor>>();
+    }
+    if (cc->Outputs().HasTag(kMaskTag))
+    {
+        cc->Outputs().Tag(kMaskTag).Set<ImageFrame>();
+        cc->UseService(kImageFramePoolService).Optional();
+    }
 
-    cc->Outputs().Tag(kMaskGpuTag).Set<mediapipe::GpuBuffer>();
+#if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
+    if (cc->Inputs().HasTag(kTensorsGpuTag))
+    {
+        cc->Inputs().Tag(kTensorsGpuTag).Set<std::vector<GlBuffer>>();
+        use_gpu |= true;
+    }
+    if (cc->Outputs().HasTag(kMaskGpuTag))
+    {
+        cc->Outputs().Tag(kMaskGpuTag).Set<mediapipe::GpuBuffer>();
+        use_gpu |= true;
+    }
+#endif //  !MEDIAPIPE_DISABLE_GPU
 
-    MP_RETURN_IF_ERROR(mediapipe::GlCalculatorHelper::UpdateContract(cc));
+    if (use_gpu)
+    {
+#if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
+        MP_RETURN_IF_ERROR(mediapipe::GlCalculatorHelper::UpdateContract(cc));
+#endif //  !MEDIAPIPE_DISABLE_GPU
+    }
 
     return ::mediapipe::OkStatus();
 }
@@ -105,12 +185,42 @@ REGISTER_CALCULATOR(DeeplabTensorsToSegmentationCalculator);
 {
     cc->SetOffset(TimestampDiff(0));
 
-    MP_RETURN_IF_ERROR(gpu_helper_.Open(cc));
+    if (cc->Inputs().HasTag(kTensorsGpuTag))
+    {
+        use_gpu_ = true;
+    }
 
-    gpu_helper_.RunInGlContext([this, cc]() -> ::mediapipe::Status {
-        MP_RETURN_IF_ERROR(InitGpu(cc));
-        return ::mediapipe::OkStatus();
-    });
+    options_ =
+        cc->Options<::mediapipe::DeeplabTensorsToSegmentationCalculatorOptions>();
+    // The foreground is either one class, or everything but the background
+    // class, i.e. the inverted mask of the background class.
+    invert_mask_ = options_.foreground_class() < 0;
+    target_class_ = invert_mask_ ? options_.background_class()
+                                 : options_.foreground_class();
+    RET_CHECK(target_class_ >= 0 && target_class_ < num_classes_)
+        << "Class index out of range: " << target_class_;
+
+    if (!use_gpu_ && options_.num_threads() > 1)
+    {
+        // The calling thread decodes one of the row bands itself.
+        thread_pool_ = absl::make_unique<ThreadPool>(
+            "deeplab_decode", options_.num_threads() - 1);
+        thread_pool_->StartWorkers();
+    }
+
+    if (use_gpu_)
+    {
+#if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
+        MP_RETURN_IF_ERROR(gpu_helper_.Open(cc));
+
+        gpu_helper_.RunInGlContext([this, cc]() -> ::mediapipe::Status {
+            MP_RETURN_IF_ERROR(InitGpu(cc));
+            return ::mediapipe::OkStatus();
+        });
+#else
+        RET_CHECK_FAIL() << "GPU processing not enabled.";
+#endif //  !MEDIAPIPE_DISABLE_GPU
+    }
 
     return ::mediapipe::OkStatus();
 }
@@ -118,12 +228,20 @@ REGISTER_CALCULATOR(DeeplabTensorsToSegmentationCalculator);
 ::mediapipe::Status DeeplabTensorsToSegmentationCalculator::Process(
     CalculatorContext *cc)
 {
-
-    MP_RETURN_IF_ERROR(
-        gpu_helper_.RunInGlContext([this, cc]() -> ::mediapipe::Status {
-            MP_RETURN_IF_ERROR(ProcessGpu(cc));
-            return ::mediapipe::OkStatus();
-        }));
+    if (use_gpu_)
+    {
+#if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
+        MP_RETURN_IF_ERROR(
+            gpu_helper_.RunInGlContext([this, cc]() -> ::mediapipe::Status {
+                MP_RETURN_IF_ERROR(ProcessGpu(cc));
+                return ::mediapipe::OkStatus();
+            }));
+#endif //  !MEDIAPIPE_DISABLE_GPU
+    }
+    else
+    {
+        MP_RETURN_IF_ERROR(ProcessCpu(cc));
+    }
 
     return ::mediapipe::OkStatus();
 }
@@ -131,20 +249,97 @@ REGISTER_CALCULATOR(DeeplabTensorsToSegmentationCalculator);
 ::mediapipe::Status DeeplabTensorsToSegmentationCalculator::Close(
     CalculatorContext *cc)
 {
-    gpu_helper_.RunInGlContext([this] {
-        if (upsample_program_)
-            glDeleteProgram(upsample_program_);
-        upsample_program_ = 0;
-        mask_program_.reset();
-        tensor_buffer_.reset();
-    });
+#if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
+    if (use_gpu_)
+    {
+        gpu_helper_.RunInGlContext([this] {
+            if (upsample_program_)
+                glDeleteProgram(upsample_program_);
+            upsample_program_ = 0;
+            mask_program_.reset();
+            tensor_buffer_.reset();
+        });
+    }
+#endif //  !MEDIAPIPE_DISABLE_GPU
+
+    // Joins the worker threads.
+    thread_pool_.reset();
 
     return ::mediapipe::OkStatus();
 }
 
+::mediapipe::Status DeeplabTensorsToSegmentationCalculator::ProcessCpu(
+    CalculatorContext *cc)
+{
+    if (cc->Inputs().Tag(kTensorsTag).IsEmpty())
+    {
+        return ::mediapipe::OkStatus();
+    }
+
+    // Get input streams.
+    const auto &input_tensors =
+        cc->Inputs().Tag(kTensorsTag).Get<std::vector<TfLiteTensor>>();
+    RET_CHECK_EQ(input_tensors.size(), 1);
+
+    const TfLiteTensor *raw_input_tensor = &input_tensors[0];
+    RET_CHECK_EQ(raw_input_tensor->type, kTfLiteFloat32);
+    RET_CHECK_EQ(raw_input_tensor->bytes,
+                 tensor_width_ * tensor_height_ * num_classes_ * sizeof(float));
+    const float *raw_input_data = raw_input_tensor->data.f;
+
+    auto output_mask =
+        GetImageFrame(cc, ImageFormat::SRGBA, tensor_width_, tensor_height_);
+    if (!thread_pool_)
+    {
+        DecodeRows(raw_input_data, 0, tensor_height_, output_mask.get());
+    }
+    else
+    {
+        // Split the rows into one contiguous band per thread.
+        const int num_bands = thread_pool_->num_threads() + 1;
+        const int band_height = (tensor_height_ + num_bands - 1) / num_bands;
+        absl::BlockingCounter bands_done(num_bands - 1);
+        for (int band = 1; band < num_bands; ++band)
+        {
+            const int row_begin = std::min(band * band_height, tensor_height_);
+            const int row_end = std::min(row_begin + band_height, tensor_height_);
+            ImageFrame *mask = output_mask.get();
+            thread_pool_->Schedule(
+                [this, raw_input_data, row_begin, row_end, mask, &bands_done] {
+                    DecodeRows(raw_input_data, row_begin, row_end, mask);
+                    bands_done.DecrementCount();
+                });
+        }
+        DecodeRows(raw_input_data, 0, std::min(band_height, tensor_height_),
+                   output_mask.get());
+        bands_done.Wait();
+    }
+
+    // Send out image as CPU packet.
+    cc->Outputs().Tag(kMaskTag).Add(output_mask.release(), cc->InputTimestamp());
+
+    return ::mediapipe::OkStatus();
+}
+
+void DeeplabTensorsToSegmentationCalculator::DecodeRows(
+    const float *scores, int row_begin, int row_end, ImageFrame *output_mask)
+{
+    const bool soft = options_.output_type() ==
+                      DeeplabTensorsToSegmentationCalculatorOptions::SOFT_MASK;
+    for (int i = row_begin; i < row_end; ++i)
+    {
+        DecodeClassMaskRow(scores + i * tensor_width_ * num_classes_,
+                           tensor_width_, num_classes_, target_class_, soft,
+                           invert_mask_,
+                           output_mask->MutablePixelData() +
+                               i * output_mask->WidthStep());
+    }
+}
+
 ::mediapipe::Status DeeplabTensorsToSegmentationCalculator::ProcessGpu(
     CalculatorContext *cc)
 {
+#if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
     // Get input streams.
     const auto &input_tensors =
         cc->Inputs().Tag(kTensorsGpuTag).Get<std::vector<GlBuffer>>();
@@ -189,12 +384,14 @@ REGISTER_CALCULATOR(DeeplabTensorsToSegmentationCalculator);
     cc->Outputs()
         .Tag(kMaskGpuTag)
         .Add(output_image.release(), cc->InputTimestamp());
+#endif //  !MEDIAPIPE_DISABLE_GPU
 
     return ::mediapipe::OkStatus();
 }
 
 void DeeplabTensorsToSegmentationCalculator::GlRender()
 {
+#if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
     static const GLfloat square_vertices[] = {
         1.0f, -1.0f,  // bottom right
         -1.0f, -1.0f, // bottom left
@@ -242,11 +439,13 @@ void DeeplabTensorsToSegmentationCalculator::GlRender()
     glBindVertexArray(0);
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(2, vbo);
+#endif //  !MEDIAPIPE_DISABLE_GPU
 }
 
 ::mediapipe::Status DeeplabTensorsToSegmentationCalculator::InitGpu(
     CalculatorContext *cc)
 {
+#if !defined(MEDIAPIPE_DISABLE_GL_COMPUTE)
     MP_RETURN_IF_ERROR(gpu_helper_.RunInGlContext([this]() -> ::mediapipe::Status {
         // Create shader
         const std::string shader_src_template =
@@ -345,6 +544,7 @@ void main() {
         glUniform1i(glGetUniformLocation(upsample_program_, "input_data"), 1);
         return ::mediapipe::OkStatus();
     }));
+#endif //  !MEDIAPIPE_DISABLE_GPU
 
     return ::mediapipe::OkStatus();
 }
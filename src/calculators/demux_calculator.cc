@@ -1,46 +1,180 @@
 #include "src/calculators/demux_calculator.pb.h"
+#include "mediapipe/calculators/util/latency.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/stream_handler/sync_set_input_stream_handler.pb.h"
 
 namespace mediapipe {
 
+// Routes each packet of its single input stream to one of the "OUTPUT:i"
+// streams, and reports the chosen index on "SELECT" so that a MuxCalculator
+// can join the branches again.
+//
+// The route starts at options.output_data_stream_index and can be changed
+// while the graph runs by a packet on the optional SELECT input stream; it
+// applies to every packet processed after it. The idle branches stay open
+// and their timestamp bounds keep advancing, so switching needs no graph
+// restart and MuxCalculator output stays in timestamp order.
+//
+// With options.latency_budget_us set, the optional LATENCY input (a back edge
+// from a PacketLatencyCalculator measuring the end-to-end latency) makes the
+// calculator switch to options.fallback_data_stream_index once the latency
+// has been over budget for options.over_budget_samples samples in a row. The
+// fallback holds until the next SELECT packet.
+//
+// A packet N on the optional SKIP input routes only one packet out of N to
+// the selected output and the others to options.skip_data_stream_index, e.g.
+// to reuse the previous result for them. The first packet is never skipped.
+// SELECT, SKIP and LATENCY packets are sparse; each is in its own sync set so that
+// they never hold back the data.
+//
+// Example config:
+// node {
+//   calculator: "DemuxCalculator"
+//   input_stream: "input_video"
+//   input_stream: "SELECT:model_select"
+//   input_stream: "LATENCY:output_latency"
+//   input_stream_info: { tag_index: "LATENCY" back_edge: true }
+//   output_stream: "OUTPUT:0:input_video_small"
+//   output_stream: "OUTPUT:1:input_video_large"
+//   output_stream: "SELECT:select"
+//   node_options: {
+//     [type.googleapis.com/mediapipe.DemuxCalculatorOptions] {
+//       output_data_stream_index: 1
+//       latency_budget_us: 100000
+//       fallback_data_stream_index: 0
+//     }
+//   }
+// }
 class DemuxCalculator : public CalculatorBase {
  public:
   static ::mediapipe::Status GetContract(CalculatorContract* cc) {
-    RET_CHECK_EQ(cc->Inputs().NumEntries(), 1);
-    cc->Inputs().Index(0).SetAny();
+    RET_CHECK_EQ(cc->Inputs().NumEntries(""), 1);
+    cc->Inputs().Get("", 0).SetAny();
+    MediaPipeOptions handler_options;
+    auto* sync_sets =
+        handler_options.MutableExtension(SyncSetInputStreamHandlerOptions::ext);
+    if (cc->Inputs().HasTag("SELECT")) {
+      cc->Inputs().Tag("SELECT").Set<int>();
+      sync_sets->add_sync_set()->add_tag_index("SELECT");
+    }
+    if (cc->Inputs().HasTag("SKIP")) {
+      cc->Inputs().Tag("SKIP").Set<int>();
+      sync_sets->add_sync_set()->add_tag_index("SKIP");
+    }
+    if (cc->Inputs().HasTag("LATENCY")) {
+      cc->Inputs().Tag("LATENCY").Set<PacketLatency>();
+      sync_sets->add_sync_set()->add_tag_index("LATENCY");
+    }
+    if (sync_sets->sync_set_size() > 0) {
+      cc->SetInputStreamHandler("SyncSetInputStreamHandler");
+      cc->SetInputStreamHandlerOptions(handler_options);
+    }
     if (cc->Outputs().HasTag("SELECT")) {
       cc->Outputs().Tag("SELECT").Set<int>();
     }
     for (CollectionItemId id = cc->Outputs().BeginId("OUTPUT");
          id < cc->Outputs().EndId("OUTPUT"); ++id) {
-      cc->Outputs().Get(id).SetSameAs(&cc->Inputs().Index(0));
+      cc->Outputs().Get(id).SetSameAs(&cc->Inputs().Get("", 0));
     }
     return ::mediapipe::OkStatus();
   }
 
   ::mediapipe::Status Open(CalculatorContext* cc) override {
     select_output_ = cc->Outputs().GetId("SELECT", 0);
-    const auto& options = cc->Options<::mediapipe::DemuxCalculatorOptions>();
-    output_data_stream_index_ = options.output_data_stream_index();
+    options_ = cc->Options<::mediapipe::DemuxCalculatorOptions>();
+    num_outputs_ = cc->Outputs().NumEntries("OUTPUT");
+    output_data_stream_index_ = options_.output_data_stream_index();
+    RET_CHECK(0 <= output_data_stream_index_ &&
+              output_data_stream_index_ < num_outputs_);
+    if (options_.latency_budget_us() > 0) {
+      RET_CHECK(cc->Inputs().HasTag("LATENCY"))
+          << "latency_budget_us needs the LATENCY input.";
+      RET_CHECK(0 <= options_.fallback_data_stream_index() &&
+                options_.fallback_data_stream_index() < num_outputs_);
+    }
+    if (cc->Inputs().HasTag("SKIP")) {
+      RET_CHECK(0 <= options_.skip_data_stream_index() &&
+                options_.skip_data_stream_index() < num_outputs_)
+          << "The SKIP input needs skip_data_stream_index.";
+    }
     return ::mediapipe::OkStatus();
   }
 
   ::mediapipe::Status Process(CalculatorContext* cc) override {
-    cc->Outputs()
-        .Get("OUTPUT", output_data_stream_index_)
-        .AddPacket(cc->Inputs().Index(0).Value());
+    if (cc->Inputs().HasTag("SELECT") &&
+        !cc->Inputs().Tag("SELECT").IsEmpty()) {
+      const int select = cc->Inputs().Tag("SELECT").Get<int>();
+      RET_CHECK(0 <= select && select < num_outputs_)
+          << "Invalid SELECT value " << select;
+      if (select != output_data_stream_index_) {
+        LOG(INFO) << "Switching to output " << select << ".";
+      }
+      output_data_stream_index_ = select;
+      over_budget_samples_ = 0;
+    }
+    if (cc->Inputs().HasTag("SKIP") && !cc->Inputs().Tag("SKIP").IsEmpty()) {
+      const int skip_interval = cc->Inputs().Tag("SKIP").Get<int>();
+      RET_CHECK_GE(skip_interval, 1) << "Invalid SKIP value " << skip_interval;
+      skip_interval_ = skip_interval;
+    }
+    if (cc->Inputs().HasTag("LATENCY") &&
+        !cc->Inputs().Tag("LATENCY").IsEmpty()) {
+      UpdateLatency(cc->Inputs().Tag("LATENCY").Get<PacketLatency>());
+    }
+
+    const auto& input = cc->Inputs().Get("", 0);
+    if (input.IsEmpty()) return ::mediapipe::OkStatus();
+    int output_index = output_data_stream_index_;
+    if (routed_any_ && skipped_in_row_ + 1 < skip_interval_) {
+      output_index = options_.skip_data_stream_index();
+      ++skipped_in_row_;
+    } else {
+      routed_any_ = true;
+      skipped_in_row_ = 0;
+    }
+    cc->Outputs().Get("OUTPUT", output_index).AddPacket(input.Value());
+    // Lets the idle branches, and a MuxCalculator waiting on them, move on.
+    const Timestamp next = cc->InputTimestamp().NextAllowedInStream();
+    for (int i = 0; i < num_outputs_; ++i) {
+      if (i != output_index) {
+        cc->Outputs().Get("OUTPUT", i).SetNextTimestampBound(next);
+      }
+    }
     if (select_output_.IsValid()) {
-      cc->Outputs()
-          .Get(select_output_)
-          .Add(new int(output_data_stream_index_), cc->InputTimestamp());
+      cc->Outputs().Get(select_output_).Add(new int(output_index),
+                                            cc->InputTimestamp());
     }
     return ::mediapipe::OkStatus();
   }
 
  private:
+  void UpdateLatency(const PacketLatency& latency) {
+    if (options_.latency_budget_us() <= 0) return;
+    const int fallback = options_.fallback_data_stream_index();
+    if (output_data_stream_index_ == fallback) return;
+    if (latency.current_latency_usec() <= options_.latency_budget_us()) {
+      over_budget_samples_ = 0;
+      return;
+    }
+    if (++over_budget_samples_ >= options_.over_budget_samples()) {
+      LOG(WARNING) << "Latency " << latency.current_latency_usec()
+                   << " us is over the budget of "
+                   << options_.latency_budget_us()
+                   << " us, falling back to output " << fallback << ".";
+      output_data_stream_index_ = fallback;
+      over_budget_samples_ = 0;
+    }
+  }
+
+  DemuxCalculatorOptions options_;
   CollectionItemId select_output_;
+  int num_outputs_ = 0;
   int32 output_data_stream_index_;
+  int over_budget_samples_ = 0;
+  int skip_interval_ = 1;
+  int skipped_in_row_ = 0;
+  bool routed_any_ = false;
 };
 
 REGISTER_CALCULATOR(DemuxCalculator);
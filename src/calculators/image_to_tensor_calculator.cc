@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "mediapipe/calculators/tflite/tflite_tensor_pool.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "src/calculators/image_to_tensor_calculator.pb.h"
+#include "src/calculators/image_to_tensor_kernel.h"
+#include "tensorflow/lite/interpreter.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kImageFrameTag[] = "IMAGE";
+constexpr char kTensorsTag[] = "TENSORS";
+constexpr char kLetterboxPaddingTag[] = "LETTERBOX_PADDING";
+
+int RotationModeToDegrees(RotationMode::Mode rotation) {
+  switch (rotation) {
+    case RotationMode::ROTATION_90:
+      return 90;
+    case RotationMode::ROTATION_180:
+      return 180;
+    case RotationMode::ROTATION_270:
+      return 270;
+    default:
+      return 0;
+  }
+}
+
+TensorScaleMode ToTensorScaleMode(ScaleMode::Mode scale_mode) {
+  switch (scale_mode) {
+    case ScaleMode::FIT:
+      return TensorScaleMode::kFit;
+    case ScaleMode::FILL_AND_CROP:
+      return TensorScaleMode::kFillAndCrop;
+    default:
+      return TensorScaleMode::kStretch;
+  }
+}
+
+}  // namespace
+
+// Converts a CPU image into the input tensor of a TfLite model in a single
+// pass, replacing an ImageTransformationCalculator followed by a
+// TfLiteConverterCalculator.
+//
+// Every tensor value is sampled straight from the input image: the bilinear
+// scaling, the rotation by a multiple of 90 degrees, the flips, the channel
+// selection and the normalization are fused, so no intermediate images are
+// allocated or written. The tensor rows can be split across several threads.
+// The tensor is written into a pooled buffer that TfLiteInferenceCalculator
+// can read in place, and that is only reused once its packet is released.
+//
+// Input Streams:
+//   IMAGE: 8-bit ImageFrame (SRGB, SRGBA or GRAY8).
+//
+// Output Streams:
+//   TENSORS: Vector holding one [height][width][channels] TfLiteTensor, of
+//            type kTfLiteFloat32, or kTfLiteUInt8 with use_quantized_tensors.
+//   LETTERBOX_PADDING (optional): The padding of the FIT scale mode, as
+//                                 fractions of the tensor size
+//                                 (std::array<float, 4>: left, top, right,
+//                                 bottom).
+//
+// Example config:
+// node {
+//   calculator: "ImageToTensorCalculator"
+//   input_stream: "IMAGE:input_video"
+//   output_stream: "TENSORS:image_tensor"
+//   node_options: {
+//     [type.googleapis.com/mediapipe.ImageToTensorCalculatorOptions] {
+//       output_width: 512
+//       output_height: 512
+//       zero_center: false
+//       num_threads: 2
+//     }
+//   }
+// }
+class ImageToTensorCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc);
+
+  ::mediapipe::Status Open(CalculatorContext* cc) override;
+  ::mediapipe::Status Process(CalculatorContext* cc) override;
+  ::mediapipe::Status Close(CalculatorContext* cc) override;
+
+ private:
+  ::mediapipe::Status ConfigureTensor(const ImageFrame& image);
+  void ConvertRows(const uint8_t* pixels, int row_begin, int row_end,
+                   TfLiteTensor* tensor);
+
+  ImageToTensorCalculatorOptions options_;
+  ImageToTensorSpec spec_;
+  ImageToTensorKernel kernel_;
+  TfLiteTensorSpec tensor_spec_;
+  TfLiteTensorPool tensor_pool_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+};
+REGISTER_CALCULATOR(ImageToTensorCalculator);
+
+// static
+::mediapipe::Status ImageToTensorCalculator::GetContract(
+    CalculatorContract* cc) {
+  cc->Inputs().Tag(kImageFrameTag).Set<ImageFrame>();
+  cc->Outputs().Tag(kTensorsTag).Set<std::vector<TfLiteTensor>>();
+  if (cc->Outputs().HasTag(kLetterboxPaddingTag)) {
+    cc->Outputs().Tag(kLetterboxPaddingTag).Set<std::array<float, 4>>();
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ImageToTensorCalculator::Open(CalculatorContext* cc) {
+  cc->SetOffset(TimestampDiff(0));
+  options_ = cc->Options<ImageToTensorCalculatorOptions>();
+  RET_CHECK(options_.output_width() > 0 && options_.output_height() > 0)
+      << "output_width and output_height must be set.";
+  RET_CHECK_GT(options_.max_num_channels(), 0);
+
+  spec_.tensor_width = options_.output_width();
+  spec_.tensor_height = options_.output_height();
+  spec_.max_num_channels = options_.max_num_channels();
+  spec_.scale_mode = ToTensorScaleMode(options_.scale_mode());
+  spec_.rotation_degrees = RotationModeToDegrees(options_.rotation_mode());
+  spec_.flip_horizontally = options_.flip_horizontally();
+  spec_.flip_vertically = options_.flip_vertically();
+  if (options_.zero_center()) {
+    spec_.scale = 1.0f / 127.5f;
+    spec_.offset = -1.0f;
+  } else {
+    spec_.scale = 1.0f / 255.0f;
+    spec_.offset = 0.0f;
+  }
+
+  if (options_.num_threads() > 1) {
+    // The calling thread converts one of the row bands itself.
+    thread_pool_ = absl::make_unique<ThreadPool>("image_to_tensor",
+                                                 options_.num_threads() - 1);
+    thread_pool_->StartWorkers();
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ImageToTensorCalculator::Process(CalculatorContext* cc) {
+  if (cc->Inputs().Tag(kImageFrameTag).IsEmpty()) {
+    return ::mediapipe::OkStatus();
+  }
+  const auto& image = cc->Inputs().Tag(kImageFrameTag).Get<ImageFrame>();
+  RET_CHECK_EQ(image.ByteDepth(), 1) << "Only 8-bit images are supported.";
+  if (!kernel_.IsConfiguredFor(image.Width(), image.Height(),
+                               image.NumberOfChannels(), image.WidthStep())) {
+    MP_RETURN_IF_ERROR(ConfigureTensor(image));
+  }
+
+  auto output_tensors = tensor_pool_.GetTensors({tensor_spec_});
+  TfLiteTensor* tensor = &output_tensors->at(0);
+  const uint8_t* pixels = image.PixelData();
+  const int height = spec_.tensor_height;
+  if (!thread_pool_) {
+    ConvertRows(pixels, 0, height, tensor);
+  } else {
+    // Split the rows into one contiguous band per thread.
+    const int num_bands = thread_pool_->num_threads() + 1;
+    const int band_height = (height + num_bands - 1) / num_bands;
+    absl::BlockingCounter bands_done(num_bands - 1);
+    for (int band = 1; band < num_bands; ++band) {
+      const int row_begin = std::min(band * band_height, height);
+      const int row_end = std::min(row_begin + band_height, height);
+      thread_pool_->Schedule(
+          [this, pixels, row_begin, row_end, tensor, &bands_done] {
+            ConvertRows(pixels, row_begin, row_end, tensor);
+            bands_done.DecrementCount();
+          });
+    }
+    ConvertRows(pixels, 0, std::min(band_height, height), tensor);
+    bands_done.Wait();
+  }
+
+  cc->Outputs().Tag(kTensorsTag).AddPacket(
+      PointToShared(std::move(output_tensors)).At(cc->InputTimestamp()));
+  if (cc->Outputs().HasTag(kLetterboxPaddingTag)) {
+    cc->Outputs()
+        .Tag(kLetterboxPaddingTag)
+        .Add(new std::array<float, 4>(kernel_.letterbox_padding()),
+             cc->InputTimestamp());
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ImageToTensorCalculator::Close(CalculatorContext* cc) {
+  // Joins the worker threads.
+  thread_pool_.reset();
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ImageToTensorCalculator::ConfigureTensor(
+    const ImageFrame& image) {
+  RET_CHECK(kernel_.Configure(spec_, image.Width(), image.Height(),
+                              image.NumberOfChannels(), image.WidthStep()))
+      << "Unsupported image of " << image.Width() << "x" << image.Height()
+      << " pixels with " << image.NumberOfChannels() << " channels.";
+
+  // The number of tensor channels depends on the image.
+  tensor_spec_.type =
+      options_.use_quantized_tensors() ? kTfLiteUInt8 : kTfLiteFloat32;
+  tensor_spec_.dims = {spec_.tensor_height, spec_.tensor_width,
+                       kernel_.tensor_channels()};
+  return ::mediapipe::OkStatus();
+}
+
+void ImageToTensorCalculator::ConvertRows(const uint8_t* pixels, int row_begin,
+                                          int row_end, TfLiteTensor* tensor) {
+  if (options_.use_quantized_tensors()) {
+    kernel_.ConvertRows(pixels, row_begin, row_end, tensor->data.uint8);
+  } else {
+    kernel_.ConvertRows(pixels, row_begin, row_end, tensor->data.f);
+  }
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,185 @@
+#include "src/calculators/image_to_tensor_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace mediapipe {
+
+namespace {
+
+inline void StoreValue(float value, float scale, float offset, float* out) {
+  *out = value * scale + offset;
+}
+
+inline void StoreValue(float value, float scale, float offset, uint8_t* out) {
+  *out = static_cast<uint8_t>(value + 0.5f);
+}
+
+inline float PaddingValue(float scale, float offset, float*) { return offset; }
+
+inline uint8_t PaddingValue(float scale, float offset, uint8_t*) { return 0; }
+
+// Writes one tensor row. kChannels is the number of tensor channels, or 0 to
+// read it from |channels|, which lets the common cases unroll.
+template <int kChannels, typename T, typename Tap>
+void ConvertRow(const uint8_t* image, const Tap& row, const Tap* column_taps,
+                int width, int channels, float scale, float offset, T* out) {
+  const int num_channels = kChannels > 0 ? kChannels : channels;
+  const T padding = PaddingValue(scale, offset, out);
+  if (!row.inside) {
+    std::fill(out, out + width * num_channels, padding);
+    return;
+  }
+  const uint8_t* row0 = image + row.offset0;
+  const uint8_t* row1 = image + row.offset1;
+  const float row_weight = row.weight;
+  for (int x = 0; x < width; ++x, out += num_channels) {
+    const Tap& column = column_taps[x];
+    if (!column.inside) {
+      std::fill(out, out + num_channels, padding);
+      continue;
+    }
+    const uint8_t* p00 = row0 + column.offset0;
+    const uint8_t* p01 = row0 + column.offset1;
+    const uint8_t* p10 = row1 + column.offset0;
+    const uint8_t* p11 = row1 + column.offset1;
+    const float column_weight = column.weight;
+    for (int c = 0; c < num_channels; ++c) {
+      const float top = p00[c] + column_weight * (p01[c] - p00[c]);
+      const float bottom = p10[c] + column_weight * (p11[c] - p10[c]);
+      StoreValue(top + row_weight * (bottom - top), scale, offset, out + c);
+    }
+  }
+}
+
+}  // namespace
+
+bool ImageToTensorKernel::Configure(const ImageToTensorSpec& spec,
+                                    int image_width, int image_height,
+                                    int image_channels, int image_row_bytes) {
+  image_width_ = -1;
+  if (spec.tensor_width <= 0 || spec.tensor_height <= 0 ||
+      spec.max_num_channels <= 0 || spec.rotation_degrees % 90 != 0 ||
+      image_width <= 0 || image_height <= 0 || image_channels <= 0 ||
+      image_row_bytes < image_width * image_channels) {
+    return false;
+  }
+  spec_ = spec;
+  tensor_channels_ = std::min(image_channels, spec.max_num_channels);
+  letterbox_padding_ = {};
+
+  // The rotated image, and how its columns (u) and rows (v) run through the
+  // source image. A counterclockwise rotation by 90 degrees moves the right
+  // column of the image to the top row.
+  const int rotation = ((spec.rotation_degrees % 360) + 360) % 360;
+  const bool transposed = rotation == 90 || rotation == 270;
+  const int rotated_width = transposed ? image_height : image_width;
+  const int rotated_height = transposed ? image_width : image_height;
+  const int u_stride = transposed ? image_row_bytes : image_channels;
+  const int v_stride = transposed ? image_channels : image_row_bytes;
+  const bool u_reversed = rotation == 180 || rotation == 270;
+  const bool v_reversed = rotation == 90 || rotation == 180;
+
+  // The size and position of the scaled image within the tensor.
+  int target_width = spec.tensor_width;
+  int target_height = spec.tensor_height;
+  if (spec.scale_mode != TensorScaleMode::kStretch) {
+    const float scale_x = static_cast<float>(spec.tensor_width) / rotated_width;
+    const float scale_y =
+        static_cast<float>(spec.tensor_height) / rotated_height;
+    const float scale = spec.scale_mode == TensorScaleMode::kFit
+                            ? std::min(scale_x, scale_y)
+                            : std::max(scale_x, scale_y);
+    target_width =
+        std::max(1, static_cast<int>(std::round(rotated_width * scale)));
+    target_height =
+        std::max(1, static_cast<int>(std::round(rotated_height * scale)));
+  }
+  const int left = (spec.tensor_width - target_width) / 2;
+  const int top = (spec.tensor_height - target_height) / 2;
+  if (spec.scale_mode == TensorScaleMode::kFit) {
+    letterbox_padding_ = {
+        static_cast<float>(left) / spec.tensor_width,
+        static_cast<float>(top) / spec.tensor_height,
+        static_cast<float>(spec.tensor_width - left - target_width) /
+            spec.tensor_width,
+        static_cast<float>(spec.tensor_height - top - target_height) /
+            spec.tensor_height};
+  }
+
+  column_taps_ = ComputeTaps(spec.tensor_width, spec.flip_horizontally, left,
+                             target_width, rotated_width, u_stride, u_reversed);
+  row_taps_ = ComputeTaps(spec.tensor_height, spec.flip_vertically, top,
+                          target_height, rotated_height, v_stride, v_reversed);
+  image_width_ = image_width;
+  image_height_ = image_height;
+  image_channels_ = image_channels;
+  image_row_bytes_ = image_row_bytes;
+  return true;
+}
+
+// static
+std::vector<ImageToTensorKernel::Tap> ImageToTensorKernel::ComputeTaps(
+    int tensor_size, bool flipped, int begin, int target_size, int extent,
+    int stride, bool reversed) {
+  std::vector<Tap> taps(tensor_size);
+  const float scale = static_cast<float>(extent) / target_size;
+  for (int i = 0; i < tensor_size; ++i) {
+    const int position = (flipped ? tensor_size - 1 - i : i) - begin;
+    Tap& tap = taps[i];
+    tap.inside = position >= 0 && position < target_size;
+    // Pixel centers are at half-integer coordinates in both images.
+    float source = (position + 0.5f) * scale - 0.5f;
+    source = std::min(std::max(source, 0.0f), static_cast<float>(extent - 1));
+    int index0 = static_cast<int>(source);
+    int index1 = std::min(index0 + 1, extent - 1);
+    tap.weight = source - index0;
+    if (reversed) {
+      index0 = extent - 1 - index0;
+      index1 = extent - 1 - index1;
+    }
+    tap.offset0 = index0 * stride;
+    tap.offset1 = index1 * stride;
+  }
+  return taps;
+}
+
+void ImageToTensorKernel::ConvertRows(const uint8_t* image, int row_begin,
+                                      int row_end, float* tensor) const {
+  ConvertRowsImpl(image, row_begin, row_end, tensor);
+}
+
+void ImageToTensorKernel::ConvertRows(const uint8_t* image, int row_begin,
+                                      int row_end, uint8_t* tensor) const {
+  ConvertRowsImpl(image, row_begin, row_end, tensor);
+}
+
+template <typename T>
+void ImageToTensorKernel::ConvertRowsImpl(const uint8_t* image, int row_begin,
+                                          int row_end, T* tensor) const {
+  const int width = spec_.tensor_width;
+  const int channels = tensor_channels_;
+  for (int y = row_begin; y < row_end; ++y) {
+    T* out = tensor + static_cast<size_t>(y) * width * channels;
+    switch (channels) {
+      case 1:
+        ConvertRow<1>(image, row_taps_[y], column_taps_.data(), width,
+                      channels, spec_.scale, spec_.offset, out);
+        break;
+      case 3:
+        ConvertRow<3>(image, row_taps_[y], column_taps_.data(), width,
+                      channels, spec_.scale, spec_.offset, out);
+        break;
+      case 4:
+        ConvertRow<4>(image, row_taps_[y], column_taps_.data(), width,
+                      channels, spec_.scale, spec_.offset, out);
+        break;
+      default:
+        ConvertRow<0>(image, row_taps_[y], column_taps_.data(), width,
+                      channels, spec_.scale, spec_.offset, out);
+        break;
+    }
+  }
+}
+
+}  // namespace mediapipe
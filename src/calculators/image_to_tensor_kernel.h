@@ -0,0 +1,119 @@
+#ifndef SRC_CALCULATORS_IMAGE_TO_TENSOR_KERNEL_H_
+#define SRC_CALCULATORS_IMAGE_TO_TENSOR_KERNEL_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace mediapipe {
+
+// How an image is scaled to the tensor size.
+enum class TensorScaleMode {
+  // Stretches the image to the tensor size.
+  kStretch,
+  // Scales the image to fit the tensor, preserving the aspect ratio, and pads
+  // the rest of the tensor (letterboxing).
+  kFit,
+  // Scales the image to fill the tensor, preserving the aspect ratio, and
+  // crops the center.
+  kFillAndCrop,
+};
+
+// The transformation from an image to a [height][width][channels] tensor.
+struct ImageToTensorSpec {
+  int tensor_width = 0;
+  int tensor_height = 0;
+  // The number of leading image channels copied to the tensor.
+  int max_num_channels = 3;
+  TensorScaleMode scale_mode = TensorScaleMode::kStretch;
+  // Counterclockwise rotation of the image, in multiples of 90 degrees.
+  int rotation_degrees = 0;
+  // Flips applied after the rotation.
+  bool flip_horizontally = false;
+  bool flip_vertically = false;
+  // Float tensor values are pixel * scale + offset.
+  float scale = 1.0f / 255.0f;
+  float offset = 0.0f;
+};
+
+// Resamples an 8-bit interleaved image into a tensor in a single pass:
+// scaling (bilinear), rotation, flipping, channel selection and
+// normalization happen together, per tensor pixel, without intermediate
+// images.
+//
+// Configure() precomputes the two source taps and the weight of each tensor
+// row and column, since a rotation by a multiple of 90 degrees keeps the
+// sampling separable. ConvertRows() can then be called on disjoint row
+// ranges from several threads.
+class ImageToTensorKernel {
+ public:
+  // Prepares the conversion of |image_width| x |image_height| images with
+  // |image_channels| channels and |image_row_bytes| bytes per row. Returns
+  // false if the spec or the image layout is invalid.
+  bool Configure(const ImageToTensorSpec& spec, int image_width,
+                 int image_height, int image_channels, int image_row_bytes);
+
+  // Returns true if the kernel was configured for this image layout.
+  bool IsConfiguredFor(int image_width, int image_height, int image_channels,
+                       int image_row_bytes) const {
+    return image_width == image_width_ && image_height == image_height_ &&
+           image_channels == image_channels_ &&
+           image_row_bytes == image_row_bytes_;
+  }
+
+  // The number of channels of the tensor.
+  int tensor_channels() const { return tensor_channels_; }
+
+  // The letterbox padding of the kFit mode, as fractions of the tensor size:
+  // left, top, right, bottom.
+  const std::array<float, 4>& letterbox_padding() const {
+    return letterbox_padding_;
+  }
+
+  // Writes tensor rows [row_begin, row_end) of a float tensor, normalized
+  // with the spec's scale and offset. Padding is the value of a black pixel.
+  void ConvertRows(const uint8_t* image, int row_begin, int row_end,
+                   float* tensor) const;
+
+  // Writes tensor rows [row_begin, row_end) of a uint8 tensor holding the
+  // resampled pixel values. Padding is 0.
+  void ConvertRows(const uint8_t* image, int row_begin, int row_end,
+                   uint8_t* tensor) const;
+
+ private:
+  // The two source samples blended into one tensor row or column, as byte
+  // offsets into the image, and the weight of the second one.
+  struct Tap {
+    int offset0 = 0;
+    int offset1 = 0;
+    float weight = 0.0f;
+    // False for the letterbox padding.
+    bool inside = false;
+  };
+
+  // Computes the taps of the |tensor_size| rows or columns of the tensor. The
+  // rotated image axis of |extent| pixels, |stride| bytes apart in the source
+  // image and running backwards if |reversed|, is scaled to |target_size|
+  // pixels starting at tensor index |begin|.
+  static std::vector<Tap> ComputeTaps(int tensor_size, bool flipped, int begin,
+                                      int target_size, int extent, int stride,
+                                      bool reversed);
+
+  template <typename T>
+  void ConvertRowsImpl(const uint8_t* image, int row_begin, int row_end,
+                       T* tensor) const;
+
+  ImageToTensorSpec spec_;
+  int image_width_ = -1;
+  int image_height_ = -1;
+  int image_channels_ = -1;
+  int image_row_bytes_ = -1;
+  int tensor_channels_ = 0;
+  std::array<float, 4> letterbox_padding_ = {};
+  std::vector<Tap> row_taps_;
+  std::vector<Tap> column_taps_;
+};
+
+}  // namespace mediapipe
+
+#endif  // SRC_CALCULATORS_IMAGE_TO_TENSOR_KERNEL_H_
@@ -0,0 +1,257 @@
+#include "mediapipe/calculators/image/mask_overlay_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/image_frame_pool.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/stream_handler/sync_set_input_stream_handler.pb.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kVideoTag[] = "VIDEO";
+constexpr char kBackgroundTag[] = "BACKGROUND";
+constexpr char kMaskTag[] = "MASK";
+constexpr char kConstMaskTag[] = "CONST_MASK";
+constexpr char kOutputTag[] = "OUTPUT";
+
+// Blends one row of interleaved pixels. A mask value of 0 selects |row0|, a
+// value of 255 selects |row1|. Written as a flat loop so that it vectorizes.
+void BlendRow(const uint8* row0, const uint8* row1, const uint8* mask_row,
+              int mask_stride, int width, int channels, uint8* output_row) {
+  for (int x = 0; x < width; ++x) {
+    const int weight1 = mask_row[x * mask_stride];
+    const int weight0 = 255 - weight1;
+    for (int c = 0; c < channels; ++c) {
+      const int i = x * channels + c;
+      // Rounded division by 255.
+      const int mixed = row0[i] * weight0 + row1[i] * weight1 + 128;
+      output_row[i] = static_cast<uint8>((mixed + (mixed >> 8)) >> 8);
+    }
+  }
+}
+
+}  // namespace
+
+// CPU counterpart of MaskOverlayCalculator. Mixes two ImageFrames using a
+// third mask frame or constant value.
+//
+// Inputs:
+//   VIDEO:[0,1] (ImageFrame):
+//     Two inputs should be provided, both SRGB or both SRGBA. VIDEO:0 is
+//     resized to the dimensions of VIDEO:1 if they differ. When the background
+//     comes from BACKGROUND, only the foreground is given, as VIDEO:0.
+//   BACKGROUND (ImageFrame):
+//     Optional, as input side packet and/or input stream. Replaces a static
+//     VIDEO:0. The image is resized to the foreground size once, when it
+//     arrives or when the foreground size changes, and reused for every frame.
+//     The stream is in its own sync set, so it only needs a packet when the
+//     background changes.
+//   MASK (ImageFrame):
+//     Optional. GRAY8, SRGB or SRGBA; resized to VIDEO:1 if needed.
+//     Where the mask is 0, VIDEO:0 will be used. Where it is 255, VIDEO:1.
+//     Intermediate values will blend.
+//     If not specified, CONST_MASK float must be present.
+//   CONST_MASK (float):
+//     Optional.
+//     If not specified, MASK ImageFrame must be present.
+//     Similar to MASK ImageFrame, but applied globally to every pixel.
+//
+// Outputs:
+//   OUTPUT (ImageFrame):
+//     The mix, with the format and dimensions of VIDEO:1.
+//
+// Options:
+//   MaskOverlayCalculatorOptions.mask_channel selects the channel of a color
+//   MASK to use. It is ignored for GRAY8 masks.
+class MaskOverlayCpuCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc);
+
+  ::mediapipe::Status Open(CalculatorContext* cc) override;
+  ::mediapipe::Status Process(CalculatorContext* cc) override;
+
+ private:
+  // Returns the background to blend with a |width| x |height| foreground,
+  // scaling and caching the last BACKGROUND image if needed.
+  const cv::Mat& CachedBackground(int width, int height);
+
+  bool use_mask_image_ = false;  // Otherwise, use constant float value.
+  // True when the background comes from BACKGROUND instead of VIDEO:0.
+  bool use_cached_background_ = false;
+  // The last BACKGROUND image, and the same image at the foreground size.
+  Packet background_packet_;
+  cv::Mat scaled_background_;
+  MaskOverlayCalculatorOptions::MaskChannel mask_channel_;
+};
+REGISTER_CALCULATOR(MaskOverlayCpuCalculator);
+
+// static
+::mediapipe::Status MaskOverlayCpuCalculator::GetContract(
+    CalculatorContract* cc) {
+  if (cc->InputSidePackets().HasTag(kBackgroundTag) ||
+      cc->Inputs().HasTag(kBackgroundTag)) {
+    RET_CHECK_EQ(cc->Inputs().NumEntries(kVideoTag), 1)
+        << "With BACKGROUND, only the foreground VIDEO input is given.";
+    cc->Inputs().Get(kVideoTag, 0).Set<ImageFrame>();
+    if (cc->InputSidePackets().HasTag(kBackgroundTag)) {
+      cc->InputSidePackets().Tag(kBackgroundTag).Set<ImageFrame>();
+    }
+    if (cc->Inputs().HasTag(kBackgroundTag)) {
+      cc->Inputs().Tag(kBackgroundTag).Set<ImageFrame>();
+      // Background updates are sparse and must not hold back the frames.
+      cc->SetInputStreamHandler("SyncSetInputStreamHandler");
+      MediaPipeOptions options;
+      options.MutableExtension(SyncSetInputStreamHandlerOptions::ext)
+          ->add_sync_set()
+          ->add_tag_index(kBackgroundTag);
+      cc->SetInputStreamHandlerOptions(options);
+    }
+  } else {
+    cc->Inputs().Get(kVideoTag, 0).Set<ImageFrame>();
+    cc->Inputs().Get(kVideoTag, 1).Set<ImageFrame>();
+  }
+  if (cc->Inputs().HasTag(kMaskTag))
+    cc->Inputs().Tag(kMaskTag).Set<ImageFrame>();
+  else if (cc->Inputs().HasTag(kConstMaskTag))
+    cc->Inputs().Tag(kConstMaskTag).Set<float>();
+  else
+    return ::mediapipe::Status(
+        ::mediapipe::StatusCode::kNotFound,
+        "At least one mask input stream must be present.");
+  cc->Outputs().Tag(kOutputTag).Set<ImageFrame>();
+  cc->UseService(kImageFramePoolService).Optional();
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status MaskOverlayCpuCalculator::Open(CalculatorContext* cc) {
+  use_cached_background_ = cc->InputSidePackets().HasTag(kBackgroundTag) ||
+                           cc->Inputs().HasTag(kBackgroundTag);
+  // A BACKGROUND packet may be ahead of the frames still being processed, so
+  // the output bound cannot follow the input timestamp there.
+  if (!cc->Inputs().HasTag(kBackgroundTag)) {
+    cc->SetOffset(TimestampDiff(0));
+  }
+  if (cc->InputSidePackets().HasTag(kBackgroundTag)) {
+    background_packet_ = cc->InputSidePackets().Tag(kBackgroundTag);
+  }
+  use_mask_image_ = cc->Inputs().HasTag(kMaskTag);
+  mask_channel_ = cc->Options<MaskOverlayCalculatorOptions>().mask_channel();
+  return ::mediapipe::OkStatus();
+}
+
+const cv::Mat& MaskOverlayCpuCalculator::CachedBackground(int width,
+                                                          int height) {
+  if (scaled_background_.cols != width || scaled_background_.rows != height) {
+    const cv::Mat background_mat =
+        formats::MatView(&background_packet_.Get<ImageFrame>());
+    if (background_mat.cols == width && background_mat.rows == height) {
+      // Shares the pixels of the packet, which is kept alive.
+      scaled_background_ = background_mat;
+    } else {
+      cv::resize(background_mat, scaled_background_, cv::Size(width, height));
+    }
+  }
+  return scaled_background_;
+}
+
+::mediapipe::Status MaskOverlayCpuCalculator::Process(CalculatorContext* cc) {
+  if (cc->Inputs().HasTag(kBackgroundTag) &&
+      !cc->Inputs().Tag(kBackgroundTag).IsEmpty()) {
+    background_packet_ = cc->Inputs().Tag(kBackgroundTag).Value();
+    scaled_background_.release();
+  }
+
+  const Packet& input1_packet =
+      cc->Inputs().Get(kVideoTag, use_cached_background_ ? 0 : 1).Value();
+  if (input1_packet.IsEmpty()) {
+    // Only the background changed.
+    return ::mediapipe::OkStatus();
+  }
+  const Packet& mask_packet = use_mask_image_
+                                  ? cc->Inputs().Tag(kMaskTag).Value()
+                                  : cc->Inputs().Tag(kConstMaskTag).Value();
+  const bool has_background = use_cached_background_
+                                  ? !background_packet_.IsEmpty()
+                                  : !cc->Inputs().Get(kVideoTag, 0).IsEmpty();
+
+  if (mask_packet.IsEmpty() || !has_background) {
+    cc->Outputs().Tag(kOutputTag).AddPacket(input1_packet);
+    return ::mediapipe::OkStatus();
+  }
+
+  const auto& input0_frame =
+      use_cached_background_
+          ? background_packet_.Get<ImageFrame>()
+          : cc->Inputs().Get(kVideoTag, 0).Get<ImageFrame>();
+  const auto& input1_frame = input1_packet.Get<ImageFrame>();
+  RET_CHECK(input0_frame.Format() == input1_frame.Format())
+      << "The background and foreground must have the same image format.";
+  RET_CHECK(input1_frame.Format() == ImageFormat::SRGB ||
+            input1_frame.Format() == ImageFormat::SRGBA)
+      << "Only SRGB and SRGBA frames are supported.";
+
+  const int width = input1_frame.Width();
+  const int height = input1_frame.Height();
+  const int channels = input1_frame.NumberOfChannels();
+
+  cv::Mat input0_mat;
+  if (use_cached_background_) {
+    input0_mat = CachedBackground(width, height);
+  } else {
+    input0_mat = formats::MatView(&input0_frame);
+    if (input0_mat.cols != width || input0_mat.rows != height) {
+      cv::Mat resized_mat;
+      cv::resize(input0_mat, resized_mat, cv::Size(width, height));
+      input0_mat = resized_mat;
+    }
+  }
+  const cv::Mat input1_mat = formats::MatView(&input1_frame);
+
+  // The mask is addressed as a single channel of a possibly interleaved image.
+  cv::Mat mask_mat;
+  int mask_stride = 1;
+  int mask_offset = 0;
+  if (use_mask_image_) {
+    const auto& mask_frame = mask_packet.Get<ImageFrame>();
+    RET_CHECK(mask_frame.ByteDepth() == 1) << "Mask must be 8 bits per channel.";
+    mask_mat = formats::MatView(&mask_frame);
+    if (mask_mat.cols != width || mask_mat.rows != height) {
+      cv::Mat resized_mat;
+      cv::resize(mask_mat, resized_mat, cv::Size(width, height));
+      mask_mat = resized_mat;
+    }
+    mask_stride = mask_mat.channels();
+    if (mask_channel_ == MaskOverlayCalculatorOptions_MaskChannel_ALPHA) {
+      RET_CHECK_EQ(mask_stride, 4)
+          << "mask_channel ALPHA needs a mask with 4 channels.";
+      mask_offset = 3;
+    }
+  } else {
+    const float mask_const = mask_packet.Get<float>();
+    mask_mat = cv::Mat(1, width, CV_8UC1,
+                       cv::Scalar(static_cast<uint8>(
+                           std::min(std::max(mask_const, 0.0f), 1.0f) * 255)));
+  }
+
+  auto output_frame =
+      GetImageFrame(cc, input1_frame.Format(), width, height,
+                    ImageFrame::kGlDefaultAlignmentBoundary);
+  cv::Mat output_mat = formats::MatView(output_frame.get());
+  for (int y = 0; y < height; ++y) {
+    const uint8* mask_row =
+        mask_mat.ptr<uint8>(use_mask_image_ ? y : 0) + mask_offset;
+    BlendRow(input0_mat.ptr<uint8>(y), input1_mat.ptr<uint8>(y), mask_row,
+             mask_stride, width, channels, output_mat.ptr<uint8>(y));
+  }
+
+  cc->Outputs().Tag(kOutputTag).Add(output_frame.release(),
+                                    cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,246 @@
+#include <memory>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/image_frame_pool.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "src/calculators/segmentation_keyframe_calculator.pb.h"
+
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+#include "mediapipe/gpu/gl_calculator_helper.h"
+#include "mediapipe/gpu/gl_simple_shaders.h"
+#include "mediapipe/gpu/shader_util.h"
+#endif  // !MEDIAPIPE_DISABLE_GPU
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kMaskTag[] = "MASK";
+constexpr char kMaskGpuTag[] = "MASK_GPU";
+constexpr char kPrevMaskTag[] = "PREV_MASK";
+constexpr char kPrevMaskGpuTag[] = "PREV_MASK_GPU";
+constexpr char kMotionTag[] = "MOTION";
+
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+enum { ATTRIB_VERTEX, ATTRIB_TEXTURE_POSITION, NUM_ATTRIBUTES };
+#endif  // !MEDIAPIPE_DISABLE_GPU
+
+}  // namespace
+
+// Fills in the masks of the frames the segmentation model did not run on.
+//
+// On keyframes the mask computed by the model arrives on MASK and is passed
+// through. On the other frames the previous mask (from a
+// PreviousLoopbackCalculator fed with the output of this calculator) is moved
+// by the translation on MOTION, as found by a SegmentationKeyframeCalculator,
+// and sent out instead. The pixels uncovered at the border repeat the edge of
+// the mask.
+//
+// Input Streams:
+//   MASK / MASK_GPU: Mask computed by the model, on keyframes only
+//                    (ImageFrame / GpuBuffer).
+//   PREV_MASK / PREV_MASK_GPU: Mask of the previous frame (ImageFrame /
+//                              GpuBuffer).
+//   MOTION: Translation from the previous frame (MaskMotion). Without a packet
+//           the previous mask is reused as it is.
+//
+// Output Streams:
+//   MASK / MASK_GPU: Mask of the current frame (ImageFrame / GpuBuffer).
+//
+// Example config:
+// node {
+//   calculator: "MaskWarpCalculator"
+//   input_stream: "MASK:keyframe_mask"
+//   input_stream: "PREV_MASK:previous_mask"
+//   input_stream: "MOTION:mask_motion"
+//   output_stream: "MASK:mask"
+// }
+class MaskWarpCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc);
+
+  ::mediapipe::Status Open(CalculatorContext* cc) override;
+  ::mediapipe::Status Process(CalculatorContext* cc) override;
+  ::mediapipe::Status Close(CalculatorContext* cc) override;
+
+ private:
+  ::mediapipe::Status WarpCpu(const Packet& previous, const MaskMotion& motion,
+                              CalculatorContext* cc);
+  ::mediapipe::Status WarpGpu(const Packet& previous, const MaskMotion& motion,
+                              CalculatorContext* cc);
+
+  bool use_gpu_ = false;
+  const char* mask_tag_ = kMaskTag;
+  const char* prev_mask_tag_ = kPrevMaskTag;
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+  ::mediapipe::Status GlSetup();
+
+  GlCalculatorHelper gpu_helper_;
+  GLuint program_ = 0;
+#endif  // !MEDIAPIPE_DISABLE_GPU
+};
+REGISTER_CALCULATOR(MaskWarpCalculator);
+
+::mediapipe::Status MaskWarpCalculator::GetContract(CalculatorContract* cc) {
+  RET_CHECK(cc->Inputs().HasTag(kMaskTag) ^ cc->Inputs().HasTag(kMaskGpuTag));
+  if (cc->Inputs().HasTag(kMaskTag)) {
+    cc->Inputs().Tag(kMaskTag).Set<ImageFrame>();
+    cc->Inputs().Tag(kPrevMaskTag).Set<ImageFrame>();
+    cc->Outputs().Tag(kMaskTag).Set<ImageFrame>();
+    cc->UseService(kImageFramePoolService).Optional();
+  }
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+  if (cc->Inputs().HasTag(kMaskGpuTag)) {
+    cc->Inputs().Tag(kMaskGpuTag).Set<GpuBuffer>();
+    cc->Inputs().Tag(kPrevMaskGpuTag).Set<GpuBuffer>();
+    cc->Outputs().Tag(kMaskGpuTag).Set<GpuBuffer>();
+    MP_RETURN_IF_ERROR(GlCalculatorHelper::UpdateContract(cc));
+  }
+#endif  // !MEDIAPIPE_DISABLE_GPU
+  if (cc->Inputs().HasTag(kMotionTag)) {
+    cc->Inputs().Tag(kMotionTag).Set<MaskMotion>();
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status MaskWarpCalculator::Open(CalculatorContext* cc) {
+  cc->SetOffset(TimestampDiff(0));
+  if (cc->Inputs().HasTag(kMaskGpuTag)) {
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+    use_gpu_ = true;
+    mask_tag_ = kMaskGpuTag;
+    prev_mask_tag_ = kPrevMaskGpuTag;
+    MP_RETURN_IF_ERROR(gpu_helper_.Open(cc));
+    MP_RETURN_IF_ERROR(
+        gpu_helper_.RunInGlContext([this] { return GlSetup(); }));
+#else
+    RET_CHECK_FAIL() << "GPU processing not enabled.";
+#endif  // !MEDIAPIPE_DISABLE_GPU
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status MaskWarpCalculator::Process(CalculatorContext* cc) {
+  const auto& mask = cc->Inputs().Tag(mask_tag_);
+  if (!mask.IsEmpty()) {
+    cc->Outputs().Tag(mask_tag_).AddPacket(mask.Value());
+    return ::mediapipe::OkStatus();
+  }
+  const Packet& previous = cc->Inputs().Tag(prev_mask_tag_).Value();
+  if (previous.IsEmpty()) return ::mediapipe::OkStatus();
+
+  MaskMotion motion;
+  if (cc->Inputs().HasTag(kMotionTag) &&
+      !cc->Inputs().Tag(kMotionTag).IsEmpty()) {
+    motion = cc->Inputs().Tag(kMotionTag).Get<MaskMotion>();
+  }
+  if (motion.dx() == 0 && motion.dy() == 0) {
+    cc->Outputs().Tag(mask_tag_).AddPacket(previous);
+    return ::mediapipe::OkStatus();
+  }
+  return use_gpu_ ? WarpGpu(previous, motion, cc)
+                  : WarpCpu(previous, motion, cc);
+}
+
+::mediapipe::Status MaskWarpCalculator::WarpCpu(const Packet& previous,
+                                                const MaskMotion& motion,
+                                                CalculatorContext* cc) {
+  const auto& input = previous.Get<ImageFrame>();
+  auto output = GetImageFrame(cc, input.Format(), input.Width(),
+                              input.Height());
+  const cv::Mat input_mat = formats::MatView(&input);
+  cv::Mat output_mat = formats::MatView(output.get());
+  const cv::Matx23d translation(1, 0, motion.dx() * input.Width(),  //
+                                0, 1, motion.dy() * input.Height());
+  cv::warpAffine(input_mat, output_mat, translation, output_mat.size(),
+                 cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+  cc->Outputs().Tag(kMaskTag).Add(output.release(), cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status MaskWarpCalculator::WarpGpu(const Packet& previous,
+                                                const MaskMotion& motion,
+                                                CalculatorContext* cc) {
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+  return gpu_helper_.RunInGlContext(
+      [this, &previous, &motion, cc]() -> ::mediapipe::Status {
+        const auto& input = previous.Get<GpuBuffer>();
+        auto src = gpu_helper_.CreateSourceTexture(input);
+        auto dst = gpu_helper_.CreateDestinationTexture(
+            src.width(), src.height(), input.format());
+        gpu_helper_.BindFramebuffer(dst);
+
+        // Sampling at the coordinates moved back by the motion moves the
+        // mask forward; the source texture clamps to its edge.
+        const GLfloat dx = motion.dx();
+        const GLfloat dy = motion.dy();
+        const GLfloat texture_vertices[] = {
+            0.0f - dx, 0.0f - dy,  // bottom left
+            1.0f - dx, 0.0f - dy,  // bottom right
+            0.0f - dx, 1.0f - dy,  // top left
+            1.0f - dx, 1.0f - dy,  // top right
+        };
+        glDisable(GL_BLEND);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(src.target(), src.name());
+        glUseProgram(program_);
+        glVertexAttribPointer(ATTRIB_VERTEX, 2, GL_FLOAT, 0, 0,
+                              kBasicSquareVertices);
+        glEnableVertexAttribArray(ATTRIB_VERTEX);
+        glVertexAttribPointer(ATTRIB_TEXTURE_POSITION, 2, GL_FLOAT, 0, 0,
+                              texture_vertices);
+        glEnableVertexAttribArray(ATTRIB_TEXTURE_POSITION);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glDisableVertexAttribArray(ATTRIB_VERTEX);
+        glDisableVertexAttribArray(ATTRIB_TEXTURE_POSITION);
+        glBindTexture(src.target(), 0);
+        glFlush();
+
+        auto output = dst.GetFrame<GpuBuffer>();
+        src.Release();
+        dst.Release();
+        cc->Outputs().Tag(kMaskGpuTag).Add(output.release(),
+                                           cc->InputTimestamp());
+        return ::mediapipe::OkStatus();
+      });
+#else
+  RET_CHECK_FAIL() << "GPU processing not enabled.";
+#endif  // !MEDIAPIPE_DISABLE_GPU
+}
+
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+::mediapipe::Status MaskWarpCalculator::GlSetup() {
+  const GLint attr_location[NUM_ATTRIBUTES] = {
+      ATTRIB_VERTEX,
+      ATTRIB_TEXTURE_POSITION,
+  };
+  const GLchar* attr_name[NUM_ATTRIBUTES] = {
+      "position",
+      "texture_coordinate",
+  };
+  GlhCreateProgram(kBasicVertexShader, kBasicTexturedFragmentShader,
+                   NUM_ATTRIBUTES, &attr_name[0], attr_location, &program_);
+  RET_CHECK(program_) << "Problem initializing the program.";
+  glUseProgram(program_);
+  glUniform1i(glGetUniformLocation(program_, "video_frame"), 1);
+  return ::mediapipe::OkStatus();
+}
+#endif  // !MEDIAPIPE_DISABLE_GPU
+
+::mediapipe::Status MaskWarpCalculator::Close(CalculatorContext* cc) {
+#if !defined(MEDIAPIPE_DISABLE_GPU)
+  if (use_gpu_) {
+    gpu_helper_.RunInGlContext([this] {
+      if (program_) glDeleteProgram(program_);
+      program_ = 0;
+    });
+  }
+#endif  // !MEDIAPIPE_DISABLE_GPU
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace mediapipe
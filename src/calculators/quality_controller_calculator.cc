@@ -0,0 +1,237 @@
+#include <algorithm>
+
+#include "src/calculators/quality_controller_calculator.pb.h"
+#include "mediapipe/calculators/util/latency.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+
+// Holds the output frame rate at a target by trading mask quality for speed.
+//
+// The calculator walks a ladder of quality levels (options.level), each
+// naming a segmentation model and how many frames share one mask. It measures
+// the output frame rate and the mean end-to-end latency over windows of
+// options.window_us from the LATENCY input, a back edge from a
+// PacketLatencyCalculator at the end of the graph. A window that falls short
+// of the target moves one level down at once; moving back up takes
+// options.upgrade_windows good windows in a row, and that number doubles every
+// time a step up has to be undone straight away, so that a machine which can
+// almost hold a level does not flap between two. The window right after a
+// change is not judged, as it still sees frames processed at the old level.
+//
+// The optional VIDEO input takes the frames as captured; the target is capped
+// at their rate. A packet on the optional REQUEST input names the best model
+// the ladder may use (e.g. chosen by the user) and restarts it at the first
+// level with that model.
+//
+// The SELECT and SKIP outputs carry the model and the skip interval of the
+// current level, and feed the matching inputs of a DemuxCalculator. They are
+// sent when they change.
+//
+// Example config:
+// node {
+//   calculator: "QualityControllerCalculator"
+//   input_stream: "LATENCY:output_latency"
+//   input_stream: "VIDEO:input_video"
+//   input_stream: "REQUEST:model_select"
+//   input_stream_info: { tag_index: "LATENCY" back_edge: true }
+//   output_stream: "SELECT:quality_select"
+//   output_stream: "SKIP:quality_skip"
+//   node_options: {
+//     [type.googleapis.com/mediapipe.QualityControllerCalculatorOptions] {
+//       level { model: 1 }
+//       level { model: 0 }
+//       level { model: 0 skip_interval: 2 }
+//     }
+//   }
+// }
+class QualityControllerCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Tag("LATENCY").Set<PacketLatency>();
+    if (cc->Inputs().HasTag("VIDEO")) {
+      cc->Inputs().Tag("VIDEO").SetAny();
+    }
+    if (cc->Inputs().HasTag("REQUEST")) {
+      cc->Inputs().Tag("REQUEST").Set<int>();
+    }
+    if (cc->Outputs().HasTag("SELECT")) {
+      cc->Outputs().Tag("SELECT").Set<int>();
+    }
+    if (cc->Outputs().HasTag("SKIP")) {
+      cc->Outputs().Tag("SKIP").Set<int>();
+    }
+    // The inputs are unrelated; each is handled as soon as it arrives.
+    cc->SetInputStreamHandler("ImmediateInputStreamHandler");
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Open(CalculatorContext* cc) override {
+    options_ = cc->Options<QualityControllerCalculatorOptions>();
+    RET_CHECK_GT(options_.level_size(), 0) << "No quality levels.";
+    for (const auto& level : options_.level()) {
+      RET_CHECK_GE(level.model(), 0);
+      RET_CHECK_GE(level.skip_interval(), 1);
+    }
+    RET_CHECK_GT(options_.target_fps(), 0);
+    RET_CHECK_GT(options_.window_us(), 0);
+    RET_CHECK_GE(options_.upgrade_windows(), 1);
+    upgrade_windows_ = options_.upgrade_windows();
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Process(CalculatorContext* cc) override {
+    const Timestamp timestamp = cc->InputTimestamp();
+    if (!started_) {
+      started_ = true;
+      SetLevel(0, timestamp, cc);
+    }
+    if (cc->Inputs().HasTag("REQUEST") &&
+        !cc->Inputs().Tag("REQUEST").IsEmpty()) {
+      const int model = cc->Inputs().Tag("REQUEST").Get<int>();
+      const auto& levels = options_.level();
+      const auto it =
+          std::find_if(levels.begin(), levels.end(),
+                       [model](const QualityControllerCalculatorOptions::Level&
+                                   level) { return level.model() == model; });
+      if (it == levels.end()) {
+        LOG(WARNING) << "No quality level uses model " << model << ".";
+      } else {
+        best_level_ = it - levels.begin();
+        upgrade_windows_ = options_.upgrade_windows();
+        SetLevel(best_level_, timestamp, cc);
+      }
+    }
+    if (cc->Inputs().HasTag("VIDEO") && !cc->Inputs().Tag("VIDEO").IsEmpty()) {
+      CountCapturedFrame(timestamp);
+    }
+    if (!cc->Inputs().Tag("LATENCY").IsEmpty()) {
+      CountOutputFrame(cc->Inputs().Tag("LATENCY").Get<PacketLatency>(),
+                       timestamp, cc);
+    }
+    return ::mediapipe::OkStatus();
+  }
+
+ private:
+  void CountCapturedFrame(Timestamp timestamp) {
+    if (capture_window_start_ == Timestamp::Unset()) {
+      capture_window_start_ = timestamp;
+      return;
+    }
+    ++capture_window_frames_;
+    const int64 elapsed_us = (timestamp - capture_window_start_).Value();
+    if (elapsed_us < options_.window_us()) return;
+    capture_fps_ = capture_window_frames_ * 1e6 / elapsed_us;
+    capture_window_start_ = timestamp;
+    capture_window_frames_ = 0;
+  }
+
+  void CountOutputFrame(const PacketLatency& latency, Timestamp timestamp,
+                        CalculatorContext* cc) {
+    if (window_start_ == Timestamp::Unset()) {
+      window_start_ = timestamp;
+      return;
+    }
+    ++window_frames_;
+    window_latency_us_ += latency.current_latency_usec();
+    const int64 elapsed_us = (timestamp - window_start_).Value();
+    if (elapsed_us < options_.window_us()) return;
+    const double fps = window_frames_ * 1e6 / elapsed_us;
+    const int64 mean_latency_us = window_latency_us_ / window_frames_;
+    window_start_ = timestamp;
+    window_frames_ = 0;
+    window_latency_us_ = 0;
+    EndWindow(fps, mean_latency_us, timestamp, cc);
+  }
+
+  void EndWindow(double fps, int64 mean_latency_us, Timestamp timestamp,
+                 CalculatorContext* cc) {
+    if (settling_) {
+      settling_ = false;
+      return;
+    }
+    ++windows_at_level_;
+    const double target_fps =
+        capture_fps_ > 0 ? std::min(options_.target_fps(), capture_fps_)
+                         : options_.target_fps();
+    const bool too_slow =
+        fps < target_fps * options_.degrade_fraction() ||
+        (options_.latency_budget_us() > 0 &&
+         mean_latency_us > options_.latency_budget_us());
+    if (too_slow) {
+      good_windows_ = 0;
+      if (level_ + 1 >= options_.level_size()) return;
+      if (stepped_up_ && windows_at_level_ == 1) {
+        upgrade_windows_ =
+            std::min(2 * upgrade_windows_, options_.max_upgrade_windows());
+      }
+      LOG(INFO) << "Output at " << fps << " fps, " << mean_latency_us
+                << " us latency; lowering quality to level " << level_ + 1
+                << ".";
+      SetLevel(level_ + 1, timestamp, cc);
+      return;
+    }
+    if (fps < target_fps * options_.upgrade_fraction()) {
+      good_windows_ = 0;
+      return;
+    }
+    if (++good_windows_ >= upgrade_windows_ && level_ > best_level_) {
+      LOG(INFO) << "Output at " << fps << " fps; raising quality to level "
+                << level_ - 1 << ".";
+      SetLevel(level_ - 1, timestamp, cc);
+      stepped_up_ = true;
+    }
+  }
+
+  void SetLevel(int level, Timestamp timestamp, CalculatorContext* cc) {
+    const auto& previous = options_.level(level_);
+    const auto& next = options_.level(level);
+    // The inputs arrive independently, so the outputs are kept in order here.
+    const Timestamp output_timestamp =
+        last_output_ == Timestamp::Unset()
+            ? timestamp
+            : std::max(timestamp, last_output_.NextAllowedInStream());
+    const bool first = last_output_ == Timestamp::Unset();
+    if (cc->Outputs().HasTag("SELECT") &&
+        (first || next.model() != previous.model())) {
+      cc->Outputs().Tag("SELECT").Add(new int(next.model()), output_timestamp);
+    }
+    if (cc->Outputs().HasTag("SKIP") &&
+        (first || next.skip_interval() != previous.skip_interval())) {
+      cc->Outputs().Tag("SKIP").Add(new int(next.skip_interval()),
+                                    output_timestamp);
+    }
+    last_output_ = output_timestamp;
+    level_ = level;
+    windows_at_level_ = 0;
+    good_windows_ = 0;
+    stepped_up_ = false;
+    settling_ = true;
+  }
+
+  QualityControllerCalculatorOptions options_;
+  bool started_ = false;
+  int level_ = 0;
+  // Best level allowed by the last REQUEST.
+  int best_level_ = 0;
+  int upgrade_windows_ = 0;
+  int windows_at_level_ = 0;
+  int good_windows_ = 0;
+  // Whether the current level was reached by stepping up.
+  bool stepped_up_ = false;
+  // Whether the current window is the first one at the current level.
+  bool settling_ = false;
+  Timestamp last_output_ = Timestamp::Unset();
+
+  Timestamp window_start_ = Timestamp::Unset();
+  int window_frames_ = 0;
+  int64 window_latency_us_ = 0;
+
+  Timestamp capture_window_start_ = Timestamp::Unset();
+  int capture_window_frames_ = 0;
+  double capture_fps_ = 0;
+};
+REGISTER_CALCULATOR(QualityControllerCalculator);
+
+}  // namespace mediapipe
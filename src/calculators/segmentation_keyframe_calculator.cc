@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cmath>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "src/calculators/segmentation_keyframe_calculator.pb.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kVideoTag[] = "VIDEO";
+constexpr char kAllowTag[] = "ALLOW";
+constexpr char kMotionTag[] = "MOTION";
+
+}  // namespace
+
+// Decides which frames the segmentation model has to run on. A frame is a
+// keyframe when it is the first one, when max_keyframe_interval frames have
+// passed since the last keyframe, or when it differs too much from the last
+// keyframe, either in content or by global translation. The frames are
+// compared at a low resolution (options.analysis_width), so that the decision
+// costs a small fraction of an inference.
+//
+// For the frames in between, the translation from the previous frame, found
+// by phase correlation, is sent on MOTION so that a MaskWarpCalculator can move
+// the previous mask along.
+//
+// Input Streams:
+//   VIDEO: Frames to analyze (ImageFrame, SRGB, SRGBA or GRAY8). They may be
+//          scaled down already.
+//
+// Output Streams:
+//   ALLOW: Whether the frame is a keyframe (bool), for a GateCalculator in
+//          front of the model.
+//   MOTION: Translation from the previous frame (MaskMotion), on the frames
+//           that are not keyframes only.
+//
+// Example config:
+// node {
+//   calculator: "SegmentationKeyframeCalculator"
+//   input_stream: "VIDEO:input_video"
+//   output_stream: "ALLOW:segment_frame"
+//   output_stream: "MOTION:mask_motion"
+//   node_options: {
+//     [type.googleapis.com/mediapipe.SegmentationKeyframeCalculatorOptions] {
+//       max_keyframe_interval: 4
+//     }
+//   }
+// }
+class SegmentationKeyframeCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Tag(kVideoTag).Set<ImageFrame>();
+    cc->Outputs().Tag(kAllowTag).Set<bool>();
+    if (cc->Outputs().HasTag(kMotionTag)) {
+      cc->Outputs().Tag(kMotionTag).Set<MaskMotion>();
+    }
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Open(CalculatorContext* cc) override {
+    cc->SetOffset(TimestampDiff(0));
+    options_ = cc->Options<SegmentationKeyframeCalculatorOptions>();
+    RET_CHECK_GT(options_.analysis_width(), 0);
+    RET_CHECK_GE(options_.max_keyframe_interval(), 1);
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Process(CalculatorContext* cc) override;
+
+ private:
+  // Scales |frame| down to analysis_width and converts it to float gray.
+  ::mediapipe::Status Downscale(const ImageFrame& frame, cv::Mat* small);
+
+  SegmentationKeyframeCalculatorOptions options_;
+  cv::Mat previous_;
+  cv::Mat keyframe_;
+  cv::Mat window_;
+  cv::Mat gray_;
+  int frames_since_keyframe_ = 0;
+  // Translation accumulated since the last keyframe, in analysis pixels.
+  cv::Point2d shift_since_keyframe_;
+};
+REGISTER_CALCULATOR(SegmentationKeyframeCalculator);
+
+::mediapipe::Status SegmentationKeyframeCalculator::Downscale(
+    const ImageFrame& frame, cv::Mat* small) {
+  const cv::Mat input = formats::MatView(&frame);
+  switch (input.channels()) {
+    case 1:
+      gray_ = input;
+      break;
+    case 3:
+      cv::cvtColor(input, gray_, cv::COLOR_RGB2GRAY);
+      break;
+    case 4:
+      cv::cvtColor(input, gray_, cv::COLOR_RGBA2GRAY);
+      break;
+    default:
+      return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+             << "Unsupported image format " << frame.Format();
+  }
+  const int width = std::min(options_.analysis_width(), gray_.cols);
+  const int height =
+      std::max(1, static_cast<int>(std::lround(
+                      static_cast<double>(gray_.rows) * width / gray_.cols)));
+  cv::Mat scaled;
+  cv::resize(gray_, scaled, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+  scaled.convertTo(*small, CV_32F);
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status SegmentationKeyframeCalculator::Process(
+    CalculatorContext* cc) {
+  cv::Mat small;
+  MP_RETURN_IF_ERROR(
+      Downscale(cc->Inputs().Tag(kVideoTag).Get<ImageFrame>(), &small));
+
+  bool keyframe = keyframe_.empty() || small.size() != keyframe_.size() ||
+                  frames_since_keyframe_ + 1 >= options_.max_keyframe_interval();
+  cv::Point2d shift;
+  if (!keyframe) {
+    if (window_.size() != small.size()) {
+      cv::createHanningWindow(window_, small.size(), CV_32F);
+    }
+    shift = cv::phaseCorrelate(previous_, small, window_);
+    shift_since_keyframe_ += shift;
+    const double max_shift = options_.max_shift() * small.cols;
+    const double difference = cv::mean(cv::abs(small - keyframe_))[0];
+    keyframe = std::hypot(shift_since_keyframe_.x, shift_since_keyframe_.y) >
+                   max_shift ||
+               difference > options_.difference_threshold();
+  }
+
+  if (keyframe) {
+    keyframe_ = small;
+    frames_since_keyframe_ = 0;
+    shift_since_keyframe_ = cv::Point2d();
+  } else {
+    ++frames_since_keyframe_;
+    if (cc->Outputs().HasTag(kMotionTag)) {
+      auto motion = absl::make_unique<MaskMotion>();
+      motion->set_dx(shift.x / small.cols);
+      motion->set_dy(shift.y / small.rows);
+      cc->Outputs().Tag(kMotionTag).Add(motion.release(), cc->InputTimestamp());
+    }
+  }
+  previous_ = small;
+  cc->Outputs().Tag(kAllowTag).Add(new bool(keyframe), cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace mediapipe
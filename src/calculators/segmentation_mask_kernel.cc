@@ -0,0 +1,237 @@
+#include "src/calculators/segmentation_mask_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace mediapipe {
+
+namespace {
+
+// Range and polynomial of the Cephes expf() approximation, used by the vector
+// paths. Relative error is below 2e-7 over the clamped range.
+constexpr float kExpHi = 88.3762626647949f;
+constexpr float kExpLo = -88.3762626647949f;
+constexpr float kLog2e = 1.44269504088896341f;
+constexpr float kLn2Hi = 0.693359375f;
+constexpr float kLn2Lo = -2.12194440e-4f;
+constexpr float kExpP0 = 1.9875691500E-4f;
+constexpr float kExpP1 = 1.3981999507E-3f;
+constexpr float kExpP2 = 8.3334519073E-3f;
+constexpr float kExpP3 = 4.1665795894E-2f;
+constexpr float kExpP4 = 1.6666665459E-1f;
+constexpr float kExpP5 = 5.0000001201E-1f;
+
+inline uint8_t ToMaskValue(float value, bool invert) {
+  if (invert) value = 1.0f - value;
+  return static_cast<uint8_t>(value * 255.0f + 0.5f);
+}
+
+inline void StoreMaskValue(uint8_t value, uint8_t* rgba) {
+  // Set both R and A channels for convenience.
+  rgba[0] = value;
+  rgba[1] = 0;
+  rgba[2] = 0;
+  rgba[3] = value;
+}
+
+#if defined(__AVX2__)
+
+inline __m256 Exp(__m256 x) {
+  x = _mm256_min_ps(x, _mm256_set1_ps(kExpHi));
+  x = _mm256_max_ps(x, _mm256_set1_ps(kExpLo));
+  const __m256 n = _mm256_floor_ps(
+      _mm256_fmadd_ps(x, _mm256_set1_ps(kLog2e), _mm256_set1_ps(0.5f)));
+  x = _mm256_fnmadd_ps(n, _mm256_set1_ps(kLn2Hi), x);
+  x = _mm256_fnmadd_ps(n, _mm256_set1_ps(kLn2Lo), x);
+  __m256 y = _mm256_set1_ps(kExpP0);
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP1));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP2));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP3));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP4));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kExpP5));
+  y = _mm256_fmadd_ps(y, _mm256_mul_ps(x, x),
+                      _mm256_add_ps(x, _mm256_set1_ps(1.0f)));
+  const __m256i pow2n = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(y, _mm256_castsi256_ps(pow2n));
+}
+
+// Handles 8 pixels per iteration. The class scores of neighbouring pixels are
+// num_classes floats apart, so each class is fetched with one gather.
+int DecodeClassMaskRowAvx2(const float* scores, int width, int num_classes,
+                           int target_class, bool soft, bool invert,
+                           uint8_t* rgba_row) {
+  const __m256i offsets = _mm256_mullo_epi32(
+      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+      _mm256_set1_epi32(num_classes));
+  const __m256 one = _mm256_set1_ps(1.0f);
+  int x = 0;
+  for (; x + 8 <= width; x += 8) {
+    const float* base = scores + x * num_classes;
+    const __m256 target =
+        _mm256_i32gather_ps(base + target_class, offsets, sizeof(float));
+    __m256 value;
+    if (soft) {
+      __m256 sum = one;
+      for (int k = 0; k < num_classes; ++k) {
+        if (k == target_class) continue;
+        const __m256 s = _mm256_i32gather_ps(base + k, offsets, sizeof(float));
+        sum = _mm256_add_ps(sum, Exp(_mm256_sub_ps(s, target)));
+      }
+      value = _mm256_div_ps(one, sum);
+    } else {
+      __m256 is_max = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+      for (int k = 0; k < num_classes; ++k) {
+        if (k == target_class) continue;
+        const __m256 s = _mm256_i32gather_ps(base + k, offsets, sizeof(float));
+        is_max = _mm256_and_ps(
+            is_max, k < target_class ? _mm256_cmp_ps(target, s, _CMP_GT_OQ)
+                                     : _mm256_cmp_ps(target, s, _CMP_GE_OQ));
+      }
+      value = _mm256_and_ps(is_max, one);
+    }
+    if (invert) value = _mm256_sub_ps(one, value);
+    const __m256i mask = _mm256_cvttps_epi32(_mm256_fmadd_ps(
+        value, _mm256_set1_ps(255.0f), _mm256_set1_ps(0.5f)));
+    // R in the low byte and A in the high byte of each little-endian pixel.
+    const __m256i rgba = _mm256_or_si256(mask, _mm256_slli_epi32(mask, 24));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba_row + 4 * x), rgba);
+  }
+  return x;
+}
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+inline float32x4_t Floor(float32x4_t x) {
+  const float32x4_t truncated = vcvtq_f32_s32(vcvtq_s32_f32(x));
+  const uint32x4_t too_large = vcgtq_f32(truncated, x);
+  return vsubq_f32(truncated,
+                   vreinterpretq_f32_u32(vandq_u32(
+                       too_large, vreinterpretq_u32_f32(vdupq_n_f32(1.0f)))));
+}
+
+inline float32x4_t Exp(float32x4_t x) {
+  x = vminq_f32(x, vdupq_n_f32(kExpHi));
+  x = vmaxq_f32(x, vdupq_n_f32(kExpLo));
+  const float32x4_t n =
+      Floor(vmlaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(kLog2e)));
+  x = vmlsq_f32(x, n, vdupq_n_f32(kLn2Hi));
+  x = vmlsq_f32(x, n, vdupq_n_f32(kLn2Lo));
+  float32x4_t y = vdupq_n_f32(kExpP0);
+  y = vmlaq_f32(vdupq_n_f32(kExpP1), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP2), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP3), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP4), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP5), y, x);
+  y = vmlaq_f32(vaddq_f32(x, vdupq_n_f32(1.0f)), y, vmulq_f32(x, x));
+  const int32x4_t pow2n =
+      vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127)), 23);
+  return vmulq_f32(y, vreinterpretq_f32_s32(pow2n));
+}
+
+inline float32x4_t LoadStrided(const float* p, int stride) {
+  float32x4_t v = vld1q_dup_f32(p);
+  v = vld1q_lane_f32(p + stride, v, 1);
+  v = vld1q_lane_f32(p + 2 * stride, v, 2);
+  v = vld1q_lane_f32(p + 3 * stride, v, 3);
+  return v;
+}
+
+inline float32x4_t Reciprocal(float32x4_t x) {
+  float32x4_t r = vrecpeq_f32(x);
+  r = vmulq_f32(vrecpsq_f32(x, r), r);
+  r = vmulq_f32(vrecpsq_f32(x, r), r);
+  return r;
+}
+
+// Handles 4 pixels per iteration, see DecodeClassMaskRowAvx2().
+int DecodeClassMaskRowNeon(const float* scores, int width, int num_classes,
+                           int target_class, bool soft, bool invert,
+                           uint8_t* rgba_row) {
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  int x = 0;
+  for (; x + 4 <= width; x += 4) {
+    const float* base = scores + x * num_classes;
+    const float32x4_t target = LoadStrided(base + target_class, num_classes);
+    float32x4_t value;
+    if (soft) {
+      float32x4_t sum = one;
+      for (int k = 0; k < num_classes; ++k) {
+        if (k == target_class) continue;
+        const float32x4_t s = LoadStrided(base + k, num_classes);
+        sum = vaddq_f32(sum, Exp(vsubq_f32(s, target)));
+      }
+      value = Reciprocal(sum);
+    } else {
+      uint32x4_t is_max = vdupq_n_u32(~0u);
+      for (int k = 0; k < num_classes; ++k) {
+        if (k == target_class) continue;
+        const float32x4_t s = LoadStrided(base + k, num_classes);
+        is_max = vandq_u32(is_max, k < target_class ? vcgtq_f32(target, s)
+                                                    : vcgeq_f32(target, s));
+      }
+      value = vreinterpretq_f32_u32(
+          vandq_u32(is_max, vreinterpretq_u32_f32(one)));
+    }
+    if (invert) value = vsubq_f32(one, value);
+    const uint32x4_t mask = vcvtq_u32_f32(
+        vmlaq_f32(vdupq_n_f32(0.5f), value, vdupq_n_f32(255.0f)));
+    // R in the low byte and A in the high byte of each little-endian pixel.
+    const uint32x4_t rgba = vorrq_u32(mask, vshlq_n_u32(mask, 24));
+    vst1q_u8(rgba_row + 4 * x, vreinterpretq_u8_u32(rgba));
+  }
+  return x;
+}
+
+#endif  // __AVX2__
+
+}  // namespace
+
+void DecodeClassMaskRowScalar(const float* scores, int width, int num_classes,
+                              int target_class, bool soft, bool invert,
+                              uint8_t* rgba_row) {
+  for (int x = 0; x < width; ++x) {
+    const float* pixel_scores = scores + x * num_classes;
+    const float target = pixel_scores[target_class];
+    float value;
+    if (soft) {
+      float sum = 0.0f;
+      for (int k = 0; k < num_classes; ++k) {
+        sum += std::exp(pixel_scores[k] - target);
+      }
+      value = 1.0f / sum;
+    } else {
+      bool is_max = true;
+      for (int k = 0; k < num_classes && is_max; ++k) {
+        if (k < target_class) is_max = target > pixel_scores[k];
+        if (k > target_class) is_max = target >= pixel_scores[k];
+      }
+      value = is_max ? 1.0f : 0.0f;
+    }
+    StoreMaskValue(ToMaskValue(value, invert), rgba_row + 4 * x);
+  }
+}
+
+void DecodeClassMaskRow(const float* scores, int width, int num_classes,
+                        int target_class, bool soft, bool invert,
+                        uint8_t* rgba_row) {
+  int done = 0;
+#if defined(__AVX2__)
+  done = DecodeClassMaskRowAvx2(scores, width, num_classes, target_class, soft,
+                                invert, rgba_row);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  done = DecodeClassMaskRowNeon(scores, width, num_classes, target_class, soft,
+                                invert, rgba_row);
+#endif  // __AVX2__
+  DecodeClassMaskRowScalar(scores + done * num_classes, width - done,
+                           num_classes, target_class, soft, invert,
+                           rgba_row + 4 * done);
+}
+
+}  // namespace mediapipe
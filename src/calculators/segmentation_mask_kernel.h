@@ -0,0 +1,30 @@
+#ifndef SRC_CALCULATORS_SEGMENTATION_MASK_KERNEL_H_
+#define SRC_CALCULATORS_SEGMENTATION_MASK_KERNEL_H_
+
+#include <cstdint>
+
+namespace mediapipe {
+
+// Decodes one row of a [height][width][num_classes] float score tensor into an
+// RGBA row holding the mask of |target_class| in both R & A channels.
+//
+// When |soft| is false the mask is 255 where |target_class| is the arg-max of
+// the pixel (first index wins ties, as in a sequential arg-max) and 0
+// elsewhere. When |soft| is true the mask is the softmax probability of
+// |target_class| scaled to [0, 255]. With |invert| set the mask is inverted,
+// which turns e.g. the background class into a foreground mask.
+//
+// Uses AVX2 or NEON when the translation unit is compiled with them, and a
+// scalar loop otherwise.
+void DecodeClassMaskRow(const float* scores, int width, int num_classes,
+                        int target_class, bool soft, bool invert,
+                        uint8_t* rgba_row);
+
+// Scalar reference implementation of DecodeClassMaskRow().
+void DecodeClassMaskRowScalar(const float* scores, int width, int num_classes,
+                              int target_class, bool soft, bool invert,
+                              uint8_t* rgba_row);
+
+}  // namespace mediapipe
+
+#endif  // SRC_CALCULATORS_SEGMENTATION_MASK_KERNEL_H_
@@ -0,0 +1,110 @@
+#include "src/calculators/segmentation_mask_kernel.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+// Covers rows shorter than one vector, exact multiples of the AVX2 (8) and
+// NEON (4) widths, and rows with a scalar tail.
+constexpr int kWidths[] = {1, 3, 4, 7, 8, 9, 16, 31, 257};
+constexpr int kNumClasses[] = {2, 21};
+
+// Random scores in [-8, 8]. Every other pixel copies its first score into a
+// random class so that the arg-max has ties.
+std::vector<float> RandomScores(int width, int num_classes, std::mt19937* rng) {
+  std::uniform_real_distribution<float> score(-8.0f, 8.0f);
+  std::uniform_int_distribution<int> klass(0, num_classes - 1);
+  std::vector<float> scores(width * num_classes);
+  for (float& s : scores) s = score(*rng);
+  for (int x = 0; x < width; x += 2) {
+    float* pixel_scores = scores.data() + x * num_classes;
+    pixel_scores[klass(*rng)] = pixel_scores[0];
+  }
+  return scores;
+}
+
+struct Rows {
+  std::vector<uint8_t> decoded;
+  std::vector<uint8_t> reference;
+};
+
+Rows DecodeBoth(const std::vector<float>& scores, int width, int num_classes,
+                int target_class, bool soft, bool invert) {
+  Rows rows;
+  rows.decoded.assign(4 * width, 0xAB);
+  rows.reference.assign(4 * width, 0xCD);
+  DecodeClassMaskRow(scores.data(), width, num_classes, target_class, soft,
+                     invert, rows.decoded.data());
+  DecodeClassMaskRowScalar(scores.data(), width, num_classes, target_class,
+                           soft, invert, rows.reference.data());
+  return rows;
+}
+
+TEST(SegmentationMaskKernelTest, ArgMaxMatchesScalar) {
+  std::mt19937 rng(1);
+  for (int num_classes : kNumClasses) {
+    for (int width : kWidths) {
+      const std::vector<float> scores = RandomScores(width, num_classes, &rng);
+      for (int target_class = 0; target_class < num_classes; ++target_class) {
+        for (bool invert : {false, true}) {
+          const Rows rows = DecodeBoth(scores, width, num_classes,
+                                       target_class, /*soft=*/false, invert);
+          ASSERT_EQ(rows.reference, rows.decoded)
+              << "width " << width << " num_classes " << num_classes
+              << " target_class " << target_class << " invert " << invert;
+        }
+      }
+    }
+  }
+}
+
+// Every pixel ties all classes, so only class 0 is the arg-max.
+TEST(SegmentationMaskKernelTest, ArgMaxTiesPickFirstClass) {
+  for (int num_classes : kNumClasses) {
+    for (int width : kWidths) {
+      const std::vector<float> scores(width * num_classes, 0.5f);
+      for (int target_class = 0; target_class < num_classes; ++target_class) {
+        const Rows rows = DecodeBoth(scores, width, num_classes, target_class,
+                                     /*soft=*/false, /*invert=*/false);
+        ASSERT_EQ(rows.reference, rows.decoded);
+        const uint8_t expected = target_class == 0 ? 255 : 0;
+        for (int x = 0; x < width; ++x) {
+          ASSERT_EQ(expected, rows.decoded[4 * x]) << "x " << x;
+          ASSERT_EQ(expected, rows.decoded[4 * x + 3]) << "x " << x;
+        }
+      }
+    }
+  }
+}
+
+// The vector paths approximate exp(), so a probability that lands next to a
+// rounding boundary may come out one step away from the scalar result.
+TEST(SegmentationMaskKernelTest, SoftmaxMatchesScalar) {
+  std::mt19937 rng(2);
+  for (int num_classes : kNumClasses) {
+    for (int width : kWidths) {
+      const std::vector<float> scores = RandomScores(width, num_classes, &rng);
+      for (int target_class = 0; target_class < num_classes; ++target_class) {
+        for (bool invert : {false, true}) {
+          const Rows rows = DecodeBoth(scores, width, num_classes,
+                                       target_class, /*soft=*/true, invert);
+          for (int i = 0; i < 4 * width; ++i) {
+            ASSERT_LE(std::abs(rows.reference[i] - rows.decoded[i]), 1)
+                << "width " << width << " num_classes " << num_classes
+                << " target_class " << target_class << " invert " << invert
+                << " byte " << i;
+          }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+}  // namespace mediapipe
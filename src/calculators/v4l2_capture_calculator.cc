@@ -0,0 +1,249 @@
+#include <libv4l2cpp/V4l2Device.h>
+#include <libv4l2cpp/V4l2MmapDevice.h>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/formats/image_frame_pool.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "src/calculators/v4l2_capture_calculator.pb.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kVideoTag[] = "VIDEO";
+constexpr char kDeviceTag[] = "DEVICE";
+
+// Gives access to the mmap'ed buffers of a libv4l2cpp capture device, so that
+// a dequeued buffer can be sent into the graph and re-queued once the graph is
+// done with it, instead of being copied out by V4l2MmapDevice::read().
+class MmapCaptureDevice : public V4l2MmapDevice {
+ public:
+  explicit MmapCaptureDevice(const V4L2DeviceParameters& params)
+      : V4l2MmapDevice(params, V4L2_BUF_TYPE_VIDEO_CAPTURE) {}
+
+  // Takes the oldest filled buffer from the driver. Returns false with errno
+  // set when there is none.
+  bool Dequeue(v4l2_buffer* buffer) {
+    std::memset(buffer, 0, sizeof(*buffer));
+    buffer->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buffer->memory = V4L2_MEMORY_MMAP;
+    return ioctl(m_fd, VIDIOC_DQBUF, buffer) == 0;
+  }
+
+  // Gives a buffer back to the driver. Safe to call from any thread.
+  void Queue(int index) {
+    v4l2_buffer buffer;
+    std::memset(&buffer, 0, sizeof(buffer));
+    buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buffer.memory = V4L2_MEMORY_MMAP;
+    buffer.index = index;
+    if (ioctl(m_fd, VIDIOC_QBUF, &buffer) != 0) {
+      LOG(ERROR) << "Failed to re-queue V4L2 buffer " << index << ": "
+                 << std::strerror(errno);
+    }
+  }
+
+  uint8* BufferData(int index) {
+    return static_cast<uint8*>(m_buffer[index].start);
+  }
+
+  int NumBuffers() const { return n_buffers; }
+};
+
+}  // namespace
+
+// Captures frames from a V4L2 device through mmap'ed driver buffers.
+//
+// For pixel formats that have an ImageFormat equivalent (RGB3 -> SRGB,
+// GREY -> GRAY8, BGR4 -> SBGRA) the output ImageFrame points straight into the
+// driver buffer; the buffer is given back to the driver when the last packet
+// referencing the frame is destroyed. The number of frames that can be alive
+// at once is thus bounded by the number of driver buffers, so downstream nodes
+// should not hold on to frames (put a FlowLimiterCalculator after this node).
+// YUYV buffers are converted into a new SRGB ImageFrame and re-queued at once.
+//
+// Frames are timestamped with the driver timestamp, in microseconds.
+//
+// Input side packets:
+//   DEVICE (optional): Device path (std::string), overriding the options.
+//
+// Output Streams:
+//   VIDEO: Captured video frames (ImageFrame).
+//
+// Example config:
+// node {
+//   calculator: "V4l2CaptureCalculator"
+//   input_side_packet: "DEVICE:input_device"
+//   output_stream: "VIDEO:input_video"
+//   node_options: {
+//     [type.googleapis.com/mediapipe.V4l2CaptureCalculatorOptions] {
+//       device: "/dev/video0"
+//       width: 640
+//       height: 480
+//     }
+//   }
+// }
+class V4l2CaptureCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    if (cc->InputSidePackets().HasTag(kDeviceTag)) {
+      cc->InputSidePackets().Tag(kDeviceTag).Set<std::string>();
+    }
+    cc->Outputs().Tag(kVideoTag).Set<ImageFrame>();
+    cc->UseService(kImageFramePoolService).Optional();
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Open(CalculatorContext* cc) override;
+  ::mediapipe::Status Process(CalculatorContext* cc) override;
+  ::mediapipe::Status Close(CalculatorContext* cc) override;
+
+ private:
+  ::mediapipe::Status WaitForFrame();
+
+  V4l2CaptureCalculatorOptions options_;
+  std::string device_path_;
+  // Shared with the deleters of the frames in flight, which keep the buffers
+  // mapped until they are released.
+  std::shared_ptr<MmapCaptureDevice> device_;
+  uint32 pixel_format_ = 0;
+  ImageFormat::Format format_ = ImageFormat::UNKNOWN;
+  int width_ = 0;
+  int height_ = 0;
+  int bytes_per_line_ = 0;
+  Timestamp prev_timestamp_ = Timestamp::Unset();
+};
+REGISTER_CALCULATOR(V4l2CaptureCalculator);
+
+::mediapipe::Status V4l2CaptureCalculator::Open(CalculatorContext* cc) {
+  options_ = cc->Options<V4l2CaptureCalculatorOptions>();
+  const std::string& fourcc = options_.fourcc();
+  RET_CHECK_EQ(fourcc.size(), 4) << "Invalid FOURCC: " << fourcc;
+  device_path_ = cc->InputSidePackets().HasTag(kDeviceTag)
+                     ? cc->InputSidePackets().Tag(kDeviceTag).Get<std::string>()
+                     : options_.device();
+
+  V4L2DeviceParameters params(
+      device_path_.c_str(),
+      v4l2_fourcc(fourcc[0], fourcc[1], fourcc[2], fourcc[3]),
+      options_.width(), options_.height(), options_.fps(), /*verbose=*/0);
+  device_ = std::make_shared<MmapCaptureDevice>(params);
+  if (!device_->init(V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_STREAMING)) {
+    return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+           << "Failed to open V4L2 capture device " << device_path_;
+  }
+  if (!device_->isReady()) {
+    RET_CHECK(device_->start()) << "Failed to start streaming.";
+  }
+
+  // Read back what the driver agreed to.
+  v4l2_format format;
+  std::memset(&format, 0, sizeof(format));
+  format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  RET_CHECK_EQ(ioctl(device_->getFd(), VIDIOC_G_FMT, &format), 0);
+  pixel_format_ = format.fmt.pix.pixelformat;
+  width_ = format.fmt.pix.width;
+  height_ = format.fmt.pix.height;
+  bytes_per_line_ = format.fmt.pix.bytesperline;
+  switch (pixel_format_) {
+    case V4L2_PIX_FMT_RGB24:
+      format_ = ImageFormat::SRGB;
+      break;
+    case V4L2_PIX_FMT_GREY:
+      format_ = ImageFormat::GRAY8;
+      break;
+    case V4L2_PIX_FMT_BGR32:
+      format_ = ImageFormat::SBGRA;
+      break;
+    case V4L2_PIX_FMT_YUYV:
+      format_ = ImageFormat::SRGB;
+      break;
+    default:
+      return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+             << "Unsupported V4L2 pixel format "
+             << std::string(reinterpret_cast<const char*>(&pixel_format_), 4);
+  }
+  LOG(INFO) << "Capturing " << width_ << "x" << height_ << " from "
+            << device_path_ << " into " << device_->NumBuffers()
+            << " buffers.";
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status V4l2CaptureCalculator::WaitForFrame() {
+  pollfd poll_fd = {device_->getFd(), POLLIN, 0};
+  while (true) {
+    const int ready = poll(&poll_fd, 1, options_.timeout_ms());
+    if (ready > 0) return ::mediapipe::OkStatus();
+    if (ready == 0) {
+      return ::mediapipe::UnavailableErrorBuilder(MEDIAPIPE_LOC)
+             << "No frame from " << device_path_ << " in "
+             << options_.timeout_ms() << " ms.";
+    }
+    if (errno != EINTR) {
+      return ::mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+             << "poll() failed: " << std::strerror(errno);
+    }
+  }
+}
+
+::mediapipe::Status V4l2CaptureCalculator::Process(CalculatorContext* cc) {
+  v4l2_buffer buffer;
+  while (!device_->Dequeue(&buffer)) {
+    if (errno != EAGAIN) {
+      return ::mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+             << "Failed to dequeue V4L2 buffer: " << std::strerror(errno);
+    }
+    MP_RETURN_IF_ERROR(WaitForFrame());
+  }
+
+  const Timestamp timestamp(static_cast<int64>(buffer.timestamp.tv_sec) *
+                                1000000 +
+                            buffer.timestamp.tv_usec);
+  // Drop corrupted frames and frames that do not move time forward.
+  if ((buffer.flags & V4L2_BUF_FLAG_ERROR) ||
+      buffer.bytesused < bytes_per_line_ * height_ ||
+      timestamp <= prev_timestamp_) {
+    device_->Queue(buffer.index);
+    return ::mediapipe::OkStatus();
+  }
+  prev_timestamp_ = timestamp;
+
+  const int index = buffer.index;
+  uint8* data = device_->BufferData(index);
+  std::unique_ptr<ImageFrame> frame;
+  if (pixel_format_ == V4L2_PIX_FMT_YUYV) {
+    frame = GetImageFrame(cc, format_, width_, height_);
+    const cv::Mat yuyv_mat(height_, width_, CV_8UC2, data, bytes_per_line_);
+    cv::Mat output_mat = formats::MatView(frame.get());
+    cv::cvtColor(yuyv_mat, output_mat, cv::COLOR_YUV2RGB_YUYV);
+    device_->Queue(index);
+  } else {
+    std::shared_ptr<MmapCaptureDevice> device = device_;
+    frame = absl::make_unique<ImageFrame>(
+        format_, width_, height_, bytes_per_line_, data,
+        [device, index](uint8*) { device->Queue(index); });
+  }
+  cc->Outputs().Tag(kVideoTag).Add(frame.release(), timestamp);
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status V4l2CaptureCalculator::Close(CalculatorContext* cc) {
+  // Streaming stops and the buffers are unmapped once the last frame in
+  // flight is released.
+  device_.reset();
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace mediapipe
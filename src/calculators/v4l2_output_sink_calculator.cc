@@ -0,0 +1,267 @@
+#include <libv4l2cpp/V4l2Device.h>
+#include <libv4l2cpp/V4l2Output.h>
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "libyuv/convert.h"
+#include "libyuv/convert_from.h"
+#include "libyuv/scale.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "src/calculators/v4l2_output_sink_calculator.pb.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kVideoTag[] = "VIDEO";
+constexpr char kDeviceTag[] = "DEVICE";
+
+// I420 planes inside a reusable buffer, tightly packed unless a wider luma
+// stride is given.
+struct I420Planes {
+  void Resize(int width, int height, int luma_stride = 0) {
+    y_stride = std::max(width, luma_stride);
+    uv_stride = (y_stride + 1) / 2;
+    const int y_size = y_stride * height;
+    const int uv_size = uv_stride * ((height + 1) / 2);
+    // Only grows, so the steady state does not allocate.
+    if (buffer.size() < y_size + 2 * uv_size) {
+      buffer.resize(y_size + 2 * uv_size);
+    }
+    size = y_size + 2 * uv_size;
+    y = buffer.data();
+    u = y + y_size;
+    v = u + uv_size;
+  }
+
+  std::vector<uint8> buffer;
+  int size = 0;
+  uint8* y = nullptr;
+  uint8* u = nullptr;
+  uint8* v = nullptr;
+  int y_stride = 0;
+  int uv_stride = 0;
+};
+
+}  // namespace
+
+// Writes video frames to a V4L2 output device, such as a v4l2loopback virtual
+// camera.
+//
+// Frames are converted to I420 (or NV12) with libyuv's SIMD row functions at
+// their own resolution, then scaled to the device resolution in YUV, which
+// touches half the bytes of scaling in RGB. All scratch planes are reused
+// across frames.
+//
+// Writing to the device can block on the consumer. To keep that off the
+// threads running the rest of the graph, assign this node to its own
+// single-threaded executor, as in the example below; capture, inference and
+// output then overlap.
+//
+// Inputs:
+//   VIDEO: SRGB or SRGBA ImageFrame.
+// Input side packets:
+//   DEVICE (optional): Device path (std::string), overriding the options.
+//
+// Example config:
+// executor {
+//   name: "output"
+//   type: "ThreadPoolExecutor"
+//   options {
+//     [mediapipe.ThreadPoolExecutorOptions.ext] { num_threads: 1 }
+//   }
+// }
+// node {
+//   calculator: "V4l2OutputSinkCalculator"
+//   input_stream: "VIDEO:output_video"
+//   executor: "output"
+//   node_options: {
+//     [type.googleapis.com/mediapipe.V4l2OutputSinkCalculatorOptions] {
+//       device: "/dev/video4"
+//     }
+//   }
+// }
+class V4l2OutputSinkCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Tag(kVideoTag).Set<ImageFrame>();
+    if (cc->InputSidePackets().HasTag(kDeviceTag)) {
+      cc->InputSidePackets().Tag(kDeviceTag).Set<std::string>();
+    }
+    return ::mediapipe::OkStatus();
+  }
+
+  ::mediapipe::Status Open(CalculatorContext* cc) override;
+  ::mediapipe::Status Process(CalculatorContext* cc) override;
+  ::mediapipe::Status Close(CalculatorContext* cc) override;
+
+ private:
+  // Converts |frame| into |planes|, which must be sized for it.
+  ::mediapipe::Status ConvertToI420(const ImageFrame& frame, I420Planes* planes);
+  ::mediapipe::Status WriteFrame(const uint8* data, int size);
+
+  V4l2OutputSinkCalculatorOptions options_;
+  std::unique_ptr<V4l2Output> output_;
+  // Format negotiated with the driver, which may differ from the options.
+  uint32 pixel_format_ = 0;
+  int width_ = 0;
+  int height_ = 0;
+  int bytes_per_line_ = 0;
+  // Frame at input resolution, frame at device resolution, and NV12 output.
+  I420Planes input_planes_;
+  I420Planes scaled_planes_;
+  std::vector<uint8> nv12_buffer_;
+};
+REGISTER_CALCULATOR(V4l2OutputSinkCalculator);
+
+::mediapipe::Status V4l2OutputSinkCalculator::Open(CalculatorContext* cc) {
+  options_ = cc->Options<V4l2OutputSinkCalculatorOptions>();
+  const std::string device =
+      cc->InputSidePackets().HasTag(kDeviceTag)
+          ? cc->InputSidePackets().Tag(kDeviceTag).Get<std::string>()
+          : options_.device();
+  const unsigned int format =
+      options_.pixel_format() == V4l2OutputSinkCalculatorOptions::NV12
+          ? V4L2_PIX_FMT_NV12
+          : V4L2_PIX_FMT_YUV420;
+  V4L2DeviceParameters params(device.c_str(), format, options_.width(),
+                              options_.height(), options_.fps(),
+                              /*verbose=*/0);
+  output_.reset(V4l2Output::create(params, V4l2Access::IOTYPE_MMAP));
+  if (!output_) {
+    return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+           << "Failed to open V4L2 output device " << device;
+  }
+
+  // Read back what the driver agreed to.
+  v4l2_format negotiated;
+  std::memset(&negotiated, 0, sizeof(negotiated));
+  negotiated.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+  RET_CHECK_EQ(ioctl(output_->getFd(), VIDIOC_G_FMT, &negotiated), 0)
+      << "Failed to query the format of " << device << ": "
+      << std::strerror(errno);
+  pixel_format_ = negotiated.fmt.pix.pixelformat;
+  width_ = negotiated.fmt.pix.width;
+  height_ = negotiated.fmt.pix.height;
+  bytes_per_line_ = negotiated.fmt.pix.bytesperline;
+  if (pixel_format_ != V4L2_PIX_FMT_NV12 &&
+      pixel_format_ != V4L2_PIX_FMT_YUV420) {
+    return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+           << "Unsupported V4L2 pixel format "
+           << std::string(reinterpret_cast<const char*>(&pixel_format_), 4)
+           << " on " << device;
+  }
+  RET_CHECK_GT(width_, 0);
+  RET_CHECK_GT(height_, 0);
+  RET_CHECK_GE(bytes_per_line_, 0);
+  scaled_planes_.Resize(width_, height_, bytes_per_line_);
+  RET_CHECK_LE(scaled_planes_.size,
+               static_cast<int>(negotiated.fmt.pix.sizeimage))
+      << "The buffers of " << device << " cannot hold a frame.";
+  if (width_ != options_.width() || height_ != options_.height() ||
+      pixel_format_ != format) {
+    LOG(WARNING) << device << " uses " << width_ << "x" << height_ << " "
+                 << std::string(reinterpret_cast<const char*>(&pixel_format_),
+                                4)
+                 << " instead of the requested format.";
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status V4l2OutputSinkCalculator::ConvertToI420(
+    const ImageFrame& frame, I420Planes* planes) {
+  int result;
+  switch (frame.Format()) {
+    // libyuv names formats by little-endian word order: RAW is R,G,B in
+    // memory and ABGR is R,G,B,A in memory.
+    case ImageFormat::SRGB:
+      result = libyuv::RAWToI420(frame.PixelData(), frame.WidthStep(),
+                                 planes->y, planes->y_stride, planes->u,
+                                 planes->uv_stride, planes->v,
+                                 planes->uv_stride, frame.Width(),
+                                 frame.Height());
+      break;
+    case ImageFormat::SRGBA:
+      result = libyuv::ABGRToI420(frame.PixelData(), frame.WidthStep(),
+                                  planes->y, planes->y_stride, planes->u,
+                                  planes->uv_stride, planes->v,
+                                  planes->uv_stride, frame.Width(),
+                                  frame.Height());
+      break;
+    default:
+      return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+             << "Unsupported image format: " << frame.Format();
+  }
+  RET_CHECK_EQ(result, 0) << "Conversion to I420 failed.";
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status V4l2OutputSinkCalculator::WriteFrame(const uint8* data,
+                                                         int size) {
+  // libv4l2cpp returns (size_t)-1 on failure and truncates frames larger than
+  // the driver buffer.
+  const size_t written =
+      output_->write(reinterpret_cast<char*>(const_cast<uint8*>(data)), size);
+  if (written != static_cast<size_t>(size)) {
+    return ::mediapipe::InternalErrorBuilder(MEDIAPIPE_LOC)
+           << "Failed to write a frame to the V4L2 device: wrote "
+           << static_cast<ssize_t>(written) << " of " << size << " bytes.";
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status V4l2OutputSinkCalculator::Process(CalculatorContext* cc) {
+  const auto& frame = cc->Inputs().Tag(kVideoTag).Get<ImageFrame>();
+  const int width = width_;
+  const int height = height_;
+
+  I420Planes* i420 = &scaled_planes_;
+  if (frame.Width() == width && frame.Height() == height) {
+    MP_RETURN_IF_ERROR(ConvertToI420(frame, &scaled_planes_));
+  } else {
+    input_planes_.Resize(frame.Width(), frame.Height());
+    MP_RETURN_IF_ERROR(ConvertToI420(frame, &input_planes_));
+    RET_CHECK_EQ(
+        libyuv::I420Scale(input_planes_.y, input_planes_.y_stride,
+                          input_planes_.u, input_planes_.uv_stride,
+                          input_planes_.v, input_planes_.uv_stride,
+                          frame.Width(), frame.Height(), scaled_planes_.y,
+                          scaled_planes_.y_stride, scaled_planes_.u,
+                          scaled_planes_.uv_stride, scaled_planes_.v,
+                          scaled_planes_.uv_stride, width, height,
+                          libyuv::kFilterBilinear),
+        0);
+  }
+
+  if (pixel_format_ == V4L2_PIX_FMT_NV12) {
+    const int y_size = i420->y_stride * height;
+    const int uv_stride = 2 * i420->uv_stride;
+    nv12_buffer_.resize(y_size + uv_stride * ((height + 1) / 2));
+    RET_CHECK_EQ(
+        libyuv::I420ToNV12(i420->y, i420->y_stride, i420->u, i420->uv_stride,
+                           i420->v, i420->uv_stride, nv12_buffer_.data(),
+                           i420->y_stride, nv12_buffer_.data() + y_size,
+                           uv_stride, width, height),
+        0);
+    return WriteFrame(nv12_buffer_.data(), nv12_buffer_.size());
+  }
+  return WriteFrame(i420->y, i420->size);
+}
+
+::mediapipe::Status V4l2OutputSinkCalculator::Close(CalculatorContext* cc) {
+  output_.reset();
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace mediapipe
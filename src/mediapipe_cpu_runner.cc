@@ -0,0 +1,203 @@
+// Copyright 2019 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// CPU-only variant of mediapipe_runner.cc: runs a graph made of ImageFrame
+// calculators, which captures webcam frames from a V4L2 device and writes the
+// result to a V4L2 loopback device. Needs no GL context.
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include "mediapipe/framework/port/opencv_highgui_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/commandlineflags.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+
+constexpr char kInputStream[] = "input_video";
+constexpr char kInputDeviceSidePacket[] = "input_device";
+constexpr char kOutputStream[] = "output_video";
+constexpr char kBackgroundSidePacket[] = "background_image";
+constexpr char kBackgroundVideoSidePacket[] = "background_video";
+constexpr char kBackgroundCacheSidePacket[] = "background_cache_mb";
+constexpr char kThrottledStream[] = "throttled_input_video";
+constexpr char kOutputDeviceSidePacket[] = "output_device";
+constexpr char kMaxInFlightSidePacket[] = "max_in_flight";
+constexpr char kModelSelectStream[] = "model_select";
+constexpr int kOutputWidth = 640;
+constexpr int kOutputHeight = 480;
+DEFINE_string(
+    calculator_graph_config_file, "",
+    "Name of file containing text format CalculatorGraphConfig proto.");
+
+DEFINE_string(background, "backgrounds/this_is_fine.jpg", "Background image");
+DEFINE_string(background_video, "",
+              "Video to loop as the background, instead of --background. "
+              "Needs one of the virtual_background_video graphs.");
+DEFINE_int32(background_cache_mb, 256,
+             "Memory for the decoded background loop. Longer loops are "
+             "streamed from a memory-mapped file instead.");
+DEFINE_string(input_device, "/dev/video0", "V4L2 device from which the graph captures frames");
+DEFINE_string(output_device, "/dev/video4", "V4L2 device to which the output will be written");
+DEFINE_int32(max_in_flight, 2,
+             "Number of frames the graph may work on at once. With more than "
+             "one, capture, segmentation, compositing and output of "
+             "consecutive frames overlap. 1 processes one frame at a time.");
+
+// Set by SIGUSR1, which switches between the SlimNet and DeepLab models
+// without restarting the graph.
+std::atomic<bool> modelSwitchRequested(false);
+void RequestModelSwitch(int) { modelSwitchRequested = true; }
+
+::mediapipe::Status RunMPPGraph()
+{
+    std::string calculator_graph_config_contents;
+    MP_RETURN_IF_ERROR(mediapipe::file::GetContents(
+        FLAGS_calculator_graph_config_file, &calculator_graph_config_contents));
+    LOG(INFO) << "Get calculator graph config contents: "
+              << calculator_graph_config_contents;
+    mediapipe::CalculatorGraphConfig config =
+        mediapipe::ParseTextProtoOrDie<mediapipe::CalculatorGraphConfig>(
+            calculator_graph_config_contents);
+
+    LOG(INFO) << "Initialize the calculator graph.";
+    mediapipe::CalculatorGraph graph;
+    MP_RETURN_IF_ERROR(graph.Initialize(config));
+
+    std::map<std::string, mediapipe::Packet> side_packets = {
+        {kInputDeviceSidePacket, mediapipe::MakePacket<std::string>(FLAGS_input_device)},
+        {kOutputDeviceSidePacket, mediapipe::MakePacket<std::string>(FLAGS_output_device)},
+        {kMaxInFlightSidePacket, mediapipe::MakePacket<int>(FLAGS_max_in_flight)}};
+    if (!FLAGS_background_video.empty())
+    {
+        // For the virtual_background_video graphs, which decode and cache the
+        // loop themselves.
+        side_packets[kBackgroundVideoSidePacket] =
+            mediapipe::MakePacket<std::string>(FLAGS_background_video);
+        side_packets[kBackgroundCacheSidePacket] =
+            mediapipe::MakePacket<int>(FLAGS_background_cache_mb);
+    }
+    else
+    {
+        // The background is scaled to the output resolution once and handed to
+        // the graph as a side packet, so its pixels are never copied per frame.
+        cv::Mat background = cv::imread(FLAGS_background);
+        RET_CHECK(!background.empty()) << "Failed to load " << FLAGS_background;
+        auto background_frame = absl::make_unique<mediapipe::ImageFrame>(
+            mediapipe::ImageFormat::SRGB, kOutputWidth, kOutputHeight,
+            mediapipe::ImageFrame::kDefaultAlignmentBoundary);
+        cv::Mat background_frame_mat = mediapipe::formats::MatView(background_frame.get());
+        cv::resize(background, background, cv::Size(kOutputWidth, kOutputHeight));
+        cv::cvtColor(background, background_frame_mat, cv::COLOR_BGR2RGB);
+        side_packets[kBackgroundSidePacket] = mediapipe::Adopt(background_frame.release());
+    }
+
+    LOG(INFO) << "Start running the calculator graph.";
+    // The graph captures its input from the V4L2 device and writes its output
+    // to the V4L2 loopback device itself, each on its own executor, so the
+    // loop below only has to report progress and forward model switches.
+    std::atomic<long> frameCounter(0);
+    MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+        kOutputStream, [&frameCounter](const mediapipe::Packet &) {
+            frameCounter++;
+            return ::mediapipe::OkStatus();
+        }));
+    // Frames captured by the graph, and the timestamp of the latest one, at
+    // which model switches are sent.
+    std::atomic<long> capturedCounter(0);
+    std::atomic<int64_t> latestTimestamp(0);
+    MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+        kInputStream, [&capturedCounter, &latestTimestamp](const mediapipe::Packet &packet) {
+            capturedCounter++;
+            latestTimestamp = packet.Timestamp().Value();
+            return ::mediapipe::OkStatus();
+        }));
+    // Frames the FlowLimiterCalculator let through; the ones captured but not
+    // let through were dropped because max_in_flight frames were in flight.
+    std::atomic<long> admittedCounter(0);
+    MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+        kThrottledStream, [&admittedCounter](const mediapipe::Packet &) {
+            admittedCounter++;
+            return ::mediapipe::OkStatus();
+        }));
+    MP_RETURN_IF_ERROR(graph.StartRun(side_packets));
+    std::signal(SIGUSR1, RequestModelSwitch);
+    long limiterDropped = 0;
+    printf("\nStart processing frames.\n");
+    bool grab_frames = true;
+    std::time_t timeBegin = std::time(0);
+    int tick = 0;
+    // Best model the graph may use; it steps down to cheaper settings by
+    // itself when the output cannot keep up.
+    int requestedModel = 1;
+    int64_t selectTimestamp = 0;
+    while (grab_frames && !graph.HasError())
+    {
+        if (modelSwitchRequested.exchange(false))
+        {
+            requestedModel = 1 - requestedModel;
+            LOG(INFO) << "Switching to model " << requestedModel << ".";
+            // Timestamps on model_select only have to increase.
+            selectTimestamp = std::max(selectTimestamp + 1, latestTimestamp.load());
+            MP_RETURN_IF_ERROR(graph.AddPacketToInputStream(
+                kModelSelectStream, mediapipe::MakePacket<int>(requestedModel).At(
+                                        mediapipe::Timestamp(selectTimestamp))));
+        }
+        std::time_t timeNow = std::time(0) - timeBegin;
+        if (timeNow - tick >= 1)
+        {
+            tick++;
+            // Counted since the start, as admission lags behind capture.
+            const long dropped = capturedCounter - admittedCounter;
+            LOG(INFO) << "FPS: " << frameCounter.exchange(0)
+                      << ", dropped in flow limiter: " << dropped - limiterDropped;
+            limiterDropped = dropped;
+        }
+        // Press any key to exit.
+        const int pressed_key = cv::waitKey(5);
+        if (pressed_key >= 0 && pressed_key != 255)
+            grab_frames = false;
+    }
+
+    printf("Shutting down.\n");
+    // Stops the capture node as well as the graph input streams.
+    MP_RETURN_IF_ERROR(graph.CloseAllPacketSources());
+    MP_RETURN_IF_ERROR(graph.WaitUntilDone());
+    LOG(INFO) << "Captured " << capturedCounter << " frames, dropped "
+              << capturedCounter - admittedCounter << " in the flow limiter.";
+    return ::mediapipe::OkStatus();
+}
+
+int main(int argc, char **argv)
+{
+    google::InitGoogleLogging(argv[0]);
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+    ::mediapipe::Status run_status = RunMPPGraph();
+    if (!run_status.ok())
+    {
+        LOG(ERROR) << "Failed to run the graph: " << run_status.message();
+        return EXIT_FAILURE;
+    }
+    else
+    {
+        LOG(INFO) << "Success!";
+    }
+    return EXIT_SUCCESS;
+}
@@ -12,13 +12,16 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 //
-// An example of sending OpenCV webcam frames into a MediaPipe graph.
+// An example of running a MediaPipe graph that captures webcam frames from a
+// V4L2 device and writes the result to a V4L2 loopback device.
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdint>
 #include <cstdlib>
-#include <libv4l2cpp/V4l2Output.h>
-#include <libv4l2cpp/V4l2Device.h>
+#include <map>
 #include "mediapipe/framework/port/opencv_highgui_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
-#include "mediapipe/framework/port/opencv_video_inc.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
@@ -26,19 +29,42 @@
 #include "mediapipe/framework/port/file_helpers.h"
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status.h"
-#include "mediapipe/gpu/gl_calculator_helper.h"
-#include "mediapipe/gpu/gpu_buffer.h"
 #include "mediapipe/gpu/gpu_shared_data_internal.h"
-#include <chrono> // for high_resolution_clock
 
 constexpr char kInputStream[] = "input_video";
+constexpr char kInputDeviceSidePacket[] = "input_device";
 constexpr char kOutputStream[] = "output_video";
-using elapsed_resolution = std::chrono::milliseconds;
+constexpr char kThrottledStream[] = "throttled_input_video";
+constexpr char kBackgroundSidePacket[] = "background_image";
+constexpr char kBackgroundVideoSidePacket[] = "background_video";
+constexpr char kBackgroundCacheSidePacket[] = "background_cache_mb";
+constexpr char kOutputDeviceSidePacket[] = "output_device";
+constexpr int kOutputWidth = 640;
+constexpr int kOutputHeight = 480;
+constexpr char kMaxInFlightSidePacket[] = "max_in_flight";
+constexpr char kModelSelectStream[] = "model_select";
 DEFINE_string(
     calculator_graph_config_file, "",
     "Name of file containing text format CalculatorGraphConfig proto.");
 
+DEFINE_string(background, "backgrounds/this_is_fine.jpg", "Background image");
+DEFINE_string(background_video, "",
+              "Video to loop as the background, instead of --background. "
+              "Needs one of the virtual_background_video graphs.");
+DEFINE_int32(background_cache_mb, 256,
+             "Memory for the decoded background loop. Longer loops are "
+             "streamed from a memory-mapped file instead.");
+DEFINE_string(input_device, "/dev/video0", "V4L2 device from which the graph captures frames");
 DEFINE_string(output_device, "/dev/video4", "V4L2 device to which the output will be written");
+DEFINE_int32(max_in_flight, 2,
+             "Number of frames the graph may work on at once. With more than "
+             "one, capture, segmentation, compositing and output of "
+             "consecutive frames overlap. 1 processes one frame at a time.");
+
+// Set by SIGUSR1, which switches between the SlimNet and DeepLab models
+// without restarting the graph.
+std::atomic<bool> modelSwitchRequested(false);
+void RequestModelSwitch(int) { modelSwitchRequested = true; }
 
 ::mediapipe::Status RunMPPGraph()
 {
@@ -58,126 +84,97 @@ DEFINE_string(output_device, "/dev/video4", "V4L2 device to which the output wil
     LOG(INFO) << "Initialize the GPU.";
     ASSIGN_OR_RETURN(auto gpu_resources, mediapipe::GpuResources::Create());
     MP_RETURN_IF_ERROR(graph.SetGpuResources(std::move(gpu_resources)));
-    mediapipe::GlCalculatorHelper gpu_helper;
-    gpu_helper.InitializeForTest(graph.GetGpuResources().get());
-
-    printf("Initialize the camera or load the video.\n");
-    cv::VideoCapture capture;
-    capture.open(0);
-    RET_CHECK(capture.isOpened());
-
-    V4L2DeviceParameters param(FLAGS_output_device.c_str(), V4L2_PIX_FMT_YUV420, 640, 480, capture.get(cv::CAP_PROP_FPS), 1);
-    V4l2Output *video_output = V4l2Output::create(param, V4l2Access::IOTYPE_MMAP);
-    video_output->queryFormat();
 
-#if (CV_MAJOR_VERSION >= 3) && (CV_MINOR_VERSION >= 2)
-    capture.set(cv::CAP_PROP_FRAME_WIDTH, 640);
-    capture.set(cv::CAP_PROP_FRAME_HEIGHT, 480);
-    capture.set(cv::CAP_PROP_FPS, 30);
-#endif
+    std::map<std::string, mediapipe::Packet> side_packets = {
+        {kInputDeviceSidePacket, mediapipe::MakePacket<std::string>(FLAGS_input_device)},
+        {kOutputDeviceSidePacket, mediapipe::MakePacket<std::string>(FLAGS_output_device)},
+        {kMaxInFlightSidePacket, mediapipe::MakePacket<int>(FLAGS_max_in_flight)}};
+    if (!FLAGS_background_video.empty())
+    {
+        // For the virtual_background_video graphs, which decode and cache the
+        // loop themselves.
+        side_packets[kBackgroundVideoSidePacket] =
+            mediapipe::MakePacket<std::string>(FLAGS_background_video);
+        side_packets[kBackgroundCacheSidePacket] =
+            mediapipe::MakePacket<int>(FLAGS_background_cache_mb);
+    }
+    else
+    {
+        // The background is handed to the graph once; MaskOverlayCalculator
+        // uploads it to a texture a single time and reuses it for every frame.
+        // It is scaled to the output resolution here, which sets the size of the
+        // composited frames.
+        cv::Mat background = cv::imread(FLAGS_background);
+        RET_CHECK(!background.empty()) << "Failed to load " << FLAGS_background;
+        auto background_frame = absl::make_unique<mediapipe::ImageFrame>(
+            mediapipe::ImageFormat::SRGB, kOutputWidth, kOutputHeight,
+            mediapipe::ImageFrame::kGlDefaultAlignmentBoundary);
+        cv::Mat background_frame_mat = mediapipe::formats::MatView(background_frame.get());
+        cv::resize(background, background, cv::Size(kOutputWidth, kOutputHeight));
+        cv::cvtColor(background, background_frame_mat, cv::COLOR_BGR2RGB);
+        side_packets[kBackgroundSidePacket] = mediapipe::Adopt(background_frame.release());
+    }
 
     LOG(INFO) << "Start running the calculator graph.";
-    ASSIGN_OR_RETURN(mediapipe::OutputStreamPoller poller,
-                     graph.AddOutputStreamPoller(kOutputStream));
-    graph.StartRun({});
-    printf("\nStart grabbing and processing frames.\n");
+    // The graph captures its input from the V4L2 device and writes its output
+    // to the V4L2 loopback device itself, each on its own executor, so the
+    // loop below only has to report progress and forward model switches.
+    std::atomic<long> frameCounter(0);
+    MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+        kOutputStream, [&frameCounter](const mediapipe::Packet &) {
+            frameCounter++;
+            return ::mediapipe::OkStatus();
+        }));
+    // Frames captured by the graph, and the timestamp of the latest one, at
+    // which model switches are sent.
+    std::atomic<long> capturedCounter(0);
+    std::atomic<int64_t> latestTimestamp(0);
+    MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+        kInputStream, [&capturedCounter, &latestTimestamp](const mediapipe::Packet &packet) {
+            capturedCounter++;
+            latestTimestamp = packet.Timestamp().Value();
+            return ::mediapipe::OkStatus();
+        }));
+    // Frames the FlowLimiterCalculator let through; the ones captured but not
+    // let through were dropped because max_in_flight frames were in flight.
+    std::atomic<long> admittedCounter(0);
+    MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+        kThrottledStream, [&admittedCounter](const mediapipe::Packet &) {
+            admittedCounter++;
+            return ::mediapipe::OkStatus();
+        }));
+    MP_RETURN_IF_ERROR(graph.StartRun(side_packets));
+    std::signal(SIGUSR1, RequestModelSwitch);
+    long limiterDropped = 0;
+    printf("\nStart processing frames.\n");
     bool grab_frames = true;
-    long frameCounter = 0;
     std::time_t timeBegin = std::time(0);
     int tick = 0;
-    cv::Mat background = cv::imread("backgrounds/this_is_fine.jpg");
-    cv::cvtColor(background, background, cv::COLOR_BGR2RGB);
-    auto background_frame = absl::make_unique<mediapipe::ImageFrame>(
-        mediapipe::ImageFormat::SRGB, background.cols, background.rows,
-        mediapipe::ImageFrame::kGlDefaultAlignmentBoundary);
-    cv::Mat background_frame_mat = mediapipe::formats::MatView(background_frame.get());
-    background.copyTo(background_frame_mat);
-    std::chrono::high_resolution_clock clock;
-    while (grab_frames)
+    // Best model the graph may use; it steps down to cheaper settings by
+    // itself when the output cannot keep up.
+    int requestedModel = 1;
+    int64_t selectTimestamp = 0;
+    while (grab_frames && !graph.HasError())
     {
-
-        // Capture opencv camera or video frame.
-        cv::Mat camera_frame_raw;
-        capture >> camera_frame_raw;
-        if (camera_frame_raw.empty())
-            break; // End of video.
-
-        auto preprocessing_time_begin = clock.now();
-        cv::Mat camera_frame;
-        cv::cvtColor(camera_frame_raw, camera_frame, cv::COLOR_BGR2RGB);
-
-        // Wrap Mat into an ImageFrame.
-        auto input_frame = absl::make_unique<mediapipe::ImageFrame>(
-            mediapipe::ImageFormat::SRGB, camera_frame.cols, camera_frame.rows,
-            mediapipe::ImageFrame::kGlDefaultAlignmentBoundary);
-        cv::Mat input_frame_mat = mediapipe::formats::MatView(input_frame.get());
-        camera_frame.copyTo(input_frame_mat);
-        auto preprocessing_time = std::chrono::duration_cast<elapsed_resolution>(clock.now() - preprocessing_time_begin);
-
-        auto graph_time_begin = clock.now();
-        // Send image packet into the graph.
-        size_t frame_timestamp_us =
-            (double)cv::getTickCount() / (double)cv::getTickFrequency() * 1e6;
-        gpu_helper.RunInGlContext([&input_frame, &background_frame, &frame_timestamp_us, &graph,
-                                   &gpu_helper]() -> ::mediapipe::Status {
-            // Convert ImageFrame to GpuBuffer.
-            auto texture = gpu_helper.CreateSourceTexture(*input_frame.get());
-            auto gpu_frame = texture.GetFrame<mediapipe::GpuBuffer>();
-            glFlush();
-            texture.Release();
-            // Send GPU image packet into the graph.
+        if (modelSwitchRequested.exchange(false))
+        {
+            requestedModel = 1 - requestedModel;
+            LOG(INFO) << "Switching to model " << requestedModel << ".";
+            // Timestamps on model_select only have to increase.
+            selectTimestamp = std::max(selectTimestamp + 1, latestTimestamp.load());
             MP_RETURN_IF_ERROR(graph.AddPacketToInputStream(
-                kInputStream, mediapipe::Adopt(gpu_frame.release())
-                                  .At(mediapipe::Timestamp(frame_timestamp_us))));
-
-            auto background_texture = gpu_helper.CreateSourceTexture(*background_frame.get());
-            auto background_gpu_frame = background_texture.GetFrame<mediapipe::GpuBuffer>();
-            graph.AddPacketToInputStream("background_image", mediapipe::Adopt(background_gpu_frame.release()).At(mediapipe::Timestamp(frame_timestamp_us)));
-            return ::mediapipe::OkStatus();
-        });
-        // Get the graph result packet, or stop if that fails.
-        mediapipe::Packet packet;
-        if (!poller.Next(&packet))
-            break;
-        std::unique_ptr<mediapipe::ImageFrame> output_frame;
-
-        // Convert GpuBuffer to ImageFrame.
-        MP_RETURN_IF_ERROR(gpu_helper.RunInGlContext(
-            [&packet, &output_frame, &gpu_helper]() -> ::mediapipe::Status {
-                auto &gpu_frame = packet.Get<mediapipe::GpuBuffer>();
-                auto texture = gpu_helper.CreateSourceTexture(gpu_frame);
-                output_frame = absl::make_unique<mediapipe::ImageFrame>(
-                    mediapipe::ImageFormatForGpuBufferFormat(gpu_frame.format()),
-                    gpu_frame.width(), gpu_frame.height(),
-                    mediapipe::ImageFrame::kGlDefaultAlignmentBoundary);
-                gpu_helper.BindFramebuffer(texture);
-                const auto info =
-                    mediapipe::GlTextureInfoForGpuBufferFormat(gpu_frame.format(), 0);
-                glReadPixels(0, 0, texture.width(), texture.height(), info.gl_format,
-                             info.gl_type, output_frame->MutablePixelData());
-                glFlush();
-                texture.Release();
-                return ::mediapipe::OkStatus();
-            }));
-
-        auto graph_time = std::chrono::duration_cast<elapsed_resolution>(clock.now() - graph_time_begin);
-
-        auto postprocessing_being = clock.now();
-        // Convert back to opencv for display or saving.
-        cv::Mat output_frame_mat = mediapipe::formats::MatView(output_frame.get());
-        cv::resize(output_frame_mat, output_frame_mat, cv::Size(640, 480));
-        cv::cvtColor(output_frame_mat, output_frame_mat, cv::COLOR_RGB2YUV_I420);
-        uchar *buffer = output_frame_mat.isContinuous() ? output_frame_mat.data : output_frame_mat.clone().data;
-        uint buffer_size = output_frame_mat.total() * output_frame_mat.channels();
-        video_output->write((char *)buffer, buffer_size);
-        auto postprocessing_time = std::chrono::duration_cast<elapsed_resolution>(clock.now() - postprocessing_being);
-        frameCounter++;
+                kModelSelectStream, mediapipe::MakePacket<int>(requestedModel).At(
+                                        mediapipe::Timestamp(selectTimestamp))));
+        }
         std::time_t timeNow = std::time(0) - timeBegin;
         if (timeNow - tick >= 1)
         {
             tick++;
-            LOG(INFO) << "FPS: " << frameCounter;
-            frameCounter = 0;
+            // Counted since the start, as admission lags behind capture.
+            const long dropped = capturedCounter - admittedCounter;
+            LOG(INFO) << "FPS: " << frameCounter.exchange(0)
+                      << ", dropped in flow limiter: " << dropped - limiterDropped;
+            limiterDropped = dropped;
         }
         // Press any key to exit.
         const int pressed_key = cv::waitKey(5);
@@ -186,8 +183,12 @@ DEFINE_string(output_device, "/dev/video4", "V4L2 device to which the output wil
     }
 
     printf("Shutting down.\n");
-    MP_RETURN_IF_ERROR(graph.CloseInputStream(kInputStream));
-    return graph.WaitUntilDone();
+    // Stops the capture node as well as the graph input streams.
+    MP_RETURN_IF_ERROR(graph.CloseAllPacketSources());
+    MP_RETURN_IF_ERROR(graph.WaitUntilDone());
+    LOG(INFO) << "Captured " << capturedCounter << " frames, dropped "
+              << capturedCounter - admittedCounter << " in the flow limiter.";
+    return ::mediapipe::OkStatus();
 }
 
 int main(int argc, char **argv)